@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	parameters:
+	r0 - pointer to struct { uint32_t size_in_crc_out, uint32_t addr },
+	     terminated by an entry with size 0
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+BLOCK_SIZE_CRC		= 0
+BLOCK_ADDRESS		= 4
+SIZEOF_STRUCT_BLOCK	= 8
+
+start:
+	ldr		r6, CRC32XOR
+block_loop:
+	ldr		r1, [r0, #BLOCK_SIZE_CRC]	/* get size */
+	tst		r1, r1
+	beq		done
+
+	ldr		r2, [r0, #BLOCK_ADDRESS]	/* get address */
+	movs	r3, #0
+	mvns	r3, r3
+	movs	r4, #0
+	b		ncomp
+nbyte:
+	ldrb	r5, [r2, r4]
+	lsls	r5, r5, #24
+	eors	r3, r3, r5
+	movs	r7, #8
+loop:
+	cmp		r3, #0
+	bge		notset
+	lsls	r3, r3, #1
+	eors	r3, r3, r6
+	b		cont
+notset:
+	lsls	r3, r3, #1
+cont:
+	subs	r7, r7, #1
+	bne		loop
+	adds	r4, r4, #1
+ncomp:
+	cmp		r4, r1
+	bne		nbyte
+
+	str		r3, [r0, #BLOCK_SIZE_CRC]	/* store crc */
+	adds	r0, #SIZEOF_STRUCT_BLOCK
+	b		block_loop
+
+/* Keep the exit point 6 bytes before the end, in front of CRC32XOR */
+	.skip	( . - start + 2) & 2, 0
+
+done:
+	bkpt	#0
+
+	.align	2
+
+CRC32XOR:	.word	0x04c11db7
+
+	.end
@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	parameters:
+	r0 - word aligned address in - crc out
+	r1 - word count
+	r2 - CRC unit base address (STM32 layout: DR at +0, CR at +8)
+
+	Feeds the data to a CRC unit computing the CRC-32 (0x04c11db7,
+	initial value 0xffffffff, no reflection, no final xor) of 32-bit
+	words MSB first. Each word is byte swapped, so the unit sees the
+	bytes in memory order like the other loaders.
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+CRC_DR	= 0
+CRC_CR	= 8
+CRC_CR_RESET	= 1
+
+start:
+	movs	r3, #CRC_CR_RESET
+	str		r3, [r2, #CRC_CR]	/* DR = 0xffffffff */
+	cmp		r1, #0
+	beq		done
+nword:
+	ldmia	r0!, {r3}
+	rev		r3, r3
+	str		r3, [r2, #CRC_DR]
+	subs	r1, r1, #1
+	bne		nword
+done:
+	ldr		r0, [r2, #CRC_DR]
+	bkpt	#0
+
+	.end
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	parameters:
+	r0 - address in - crc out
+	r1 - char count
+	r2 - word aligned 1 KiB area for the lookup table
+
+	The table is built first, then the CRC is computed a byte at a time
+	with one table lookup instead of eight shift/xor steps.
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+start:
+	ldr		r6, CRC32XOR
+	movs	r7, #1
+	lsls	r7, r7, #8			/* 256 table entries */
+	movs	r3, #0
+table_loop:
+	lsls	r4, r3, #24
+	movs	r5, #8
+bit_loop:
+	lsls	r4, r4, #1			/* carry = bit shifted out */
+	bcc		no_xor
+	eors	r4, r4, r6
+no_xor:
+	subs	r5, r5, #1
+	bne		bit_loop
+	lsls	r5, r3, #2
+	str		r4, [r2, r5]
+	adds	r3, r3, #1
+	cmp		r3, r7
+	bne		table_loop
+
+	mov		r3, r0				/* address */
+	movs	r0, #0
+	mvns	r0, r0				/* crc = 0xffffffff */
+	adds	r1, r1, r3			/* end address */
+	b		ncomp
+nbyte:
+	ldrb	r4, [r3]
+	adds	r3, r3, #1
+	lsrs	r5, r0, #24
+	eors	r5, r5, r4
+	lsls	r5, r5, #2
+	ldr		r5, [r2, r5]
+	lsls	r0, r0, #8
+	eors	r0, r0, r5
+ncomp:
+	cmp		r3, r1
+	bne		nbyte
+
+/* Keep the exit point 6 bytes before the end, in front of CRC32XOR */
+	.skip	( . - start + 2) & 2, 0
+
+	bkpt	#0
+
+	.align	2
+
+CRC32XOR:	.word	0x04c11db7
+
+	.end
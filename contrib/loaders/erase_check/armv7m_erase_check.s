@@ -20,8 +20,15 @@
 
 /*
 	parameters:
-	r0 - pointer to struct { uint32_t size_in_result_out, uint32_t addr }
+	r0 - pointer to array of struct { uint32_t size_in_words, uint32_t addr },
+	     terminated by a zero size
 	r1 - value to check
+	r2 - pointer to result: a count of the checked blocks followed by a
+	     bitmap, bit n set when block n is erased. Bits are shifted in from
+	     the top of each word, so a word holding m < 32 results has the one
+	     of its first block at bit 32 - m. The bitmap word is stored before
+	     the count of each block, so the result of an interrupted run can
+	     be used up to the count.
 */
 
 	.text
@@ -32,17 +39,46 @@
 
 	.align	2
 
-BLOCK_SIZE_RESULT	= 0
+BLOCK_SIZE		= 0
 BLOCK_ADDRESS		= 4
 SIZEOF_STRUCT_BLOCK	= 8
 
 start:
+	mov	r8, r2		/* block count */
+	adds	r2, #4
+	movs	r6, #1		/* bits are shifted in from the top, */
+	lsls	r6, #31		/* until this marker drops out */
+
 block_loop:
-	ldr	r2, [r0, #BLOCK_SIZE_RESULT]	/* get size */
-	tst	r2, r2
+	ldr	r5, [r0, #BLOCK_SIZE]	/* get size */
+	tst	r5, r5
 	beq	done
 
 	ldr	r3, [r0, #BLOCK_ADDRESS]	/* get address */
+	adds	r0, #SIZEOF_STRUCT_BLOCK
+
+quad_loop:
+	subs	r5, #4
+	bcc	tail
+
+	ldr	r4, [r3, #0]	/* check four words at once */
+	ldr	r7, [r3, #4]
+	eors	r4, r1
+	eors	r7, r1
+	orrs	r4, r7
+	ldr	r7, [r3, #8]
+	eors	r7, r1
+	orrs	r4, r7
+	ldr	r7, [r3, #12]
+	adds	r3, #16
+	eors	r7, r1
+	orrs	r4, r7
+	bne	not_erased
+	b	quad_loop
+
+tail:
+	adds	r5, #4
+	beq	erased
 
 word_loop:
 	ldr	r4, [r3]	/* read word */
@@ -51,21 +87,36 @@ word_loop:
 	cmp	r4, r1
 	bne	not_erased
 
-	subs	r2, #1
+	subs	r5, #1
 	bne	word_loop
 
+erased:
 	movs	r4, #1		/* block is erased */
-save_result:
-	str	r4, [r0, #BLOCK_SIZE_RESULT]
-	adds	r0, #SIZEOF_STRUCT_BLOCK
-	b	block_loop
+	lsls	r4, #31
+	b	save_result
 
 not_erased:
 	movs	r4, #0
-	b	save_result
+
+save_result:
+	lsrs	r6, #1		/* marker drops into carry after 32 blocks */
+	orrs	r6, r4
+	str	r6, [r2]
+	bcc	count
+
+	adds	r2, #4
+	movs	r6, #1
+	lsls	r6, #31
+
+count:
+	mov	r7, r8
+	ldr	r4, [r7]
+	adds	r4, #1
+	str	r4, [r7]
+	b	block_loop
 
 /* Avoid padding at .text segment end. Otherwise exit point check fails. */
-        .skip   ( . - start + 2) & 2, 0
+	.skip	( . - start + 2) & 2, 0
 
 done:
 	bkpt	#0
@@ -0,0 +1,48 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+ * Common definitions of the CFI write buffer loaders.
+ *
+ * The loaders take their data from a FIFO in the layout used by
+ * target_run_flash_async_algorithm() and program one write buffer per
+ * FIFO block. Flash commands are passed premultiplied for the number of
+ * chips on the bus in a parameter block.
+ */
+
+/* offsets in the parameter block */
+#define P_WORDS			0	/* bus words per write buffer */
+#define P_UNLOCK1_ADDR	4	/* AMD/Spansion unlock addresses */
+#define P_UNLOCK2_ADDR	8
+#define P_UNLOCK1_CMD	12	/* AMD/Spansion unlock commands */
+#define P_UNLOCK2_CMD	16
+#define P_LOAD_CMD		20	/* write to buffer command */
+#define P_COUNT_CMD		24	/* bus words per write buffer - 1 */
+#define P_CONFIRM_CMD	28	/* program buffer to flash command */
+#define P_READY_MASK	32	/* Intel SR.7, AMD DQ7 */
+#define P_ERROR_MASK	36	/* Intel SR.1-6, AMD DQ5 (0 for DQ7 polling only) */
+
+#if BUS_WIDTH == 1
+#define LDRW	ldrb
+#define STRW	strb
+#elif BUS_WIDTH == 2
+#define LDRW	ldrh
+#define STRW	strh
+#elif BUS_WIDTH == 4
+#define LDRW	ldr
+#define STRW	str
+#else
+#error "BUS_WIDTH must be 1, 2 or 4"
+#endif
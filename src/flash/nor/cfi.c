@@ -1970,6 +1970,386 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	return retval;
 }
 
+/* parameter block of the write buffer loaders,
+ * see contrib/loaders/flash/cfi/cfi_buf.h */
+struct cfi_buf_write_params {
+	uint32_t words;
+	uint32_t unlock1_addr;
+	uint32_t unlock2_addr;
+	uint32_t unlock1_cmd;
+	uint32_t unlock2_cmd;
+	uint32_t load_cmd;
+	uint32_t count_cmd;
+	uint32_t confirm_cmd;
+	uint32_t ready_mask;
+	uint32_t error_mask;
+};
+
+/* Size in bytes of the write buffers of all chips on the bus, or 0 if the
+ * chips don't support buffered programming */
+static uint32_t cfi_write_buffer_size(struct flash_bank *bank)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+
+	if (cfi_info->buf_write_timeout_typ == 0 || cfi_info->max_buf_write_size == 0)
+		return 0;
+
+	return (1UL << cfi_info->max_buf_write_size) * (bank->bus_width / bank->chip_width);
+}
+
+/* Programs whole write buffers with a loader fed through a FIFO. On
+ * ARMv7-M the host fills the FIFO while the target programs, ARMv4/5 cores
+ * can't access memory while running, so the FIFO is filled and programmed
+ * alternately there. */
+static int cfi_write_buffers(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct target *target = bank->target;
+	struct reg_param reg_params[5];
+	struct arm_algorithm armv4_5_algo;
+	struct armv7m_algorithm armv7m_algo;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct cfi_buf_write_params params;
+	const uint8_t *target_code_src;
+	uint32_t target_code_size;
+	uint32_t buffersize = cfi_write_buffer_size(bank);
+	uint32_t fifo_size = 32768;
+	int retval;
+
+	static const uint8_t armv7m_span_8_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_buf_8.inc"
+	};
+	static const uint8_t armv7m_span_16_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_buf_16.inc"
+	};
+	static const uint8_t armv7m_span_32_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_span_buf_32.inc"
+	};
+	static const uint8_t armv7m_intel_8_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_intel_buf_8.inc"
+	};
+	static const uint8_t armv7m_intel_16_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_intel_buf_16.inc"
+	};
+	static const uint8_t armv7m_intel_32_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_intel_buf_32.inc"
+	};
+	static const uint8_t armv4_5_span_8_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv4_5_cfi_span_buf_8.inc"
+	};
+	static const uint8_t armv4_5_span_16_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv4_5_cfi_span_buf_16.inc"
+	};
+	static const uint8_t armv4_5_span_32_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv4_5_cfi_span_buf_32.inc"
+	};
+	static const uint8_t armv4_5_intel_8_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv4_5_cfi_intel_buf_8.inc"
+	};
+	static const uint8_t armv4_5_intel_16_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv4_5_cfi_intel_buf_16.inc"
+	};
+	static const uint8_t armv4_5_intel_32_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv4_5_cfi_intel_buf_32.inc"
+	};
+
+	static const uint8_t *const armv7m_codes[2][3] = {
+		{ armv7m_intel_8_code, armv7m_intel_16_code, armv7m_intel_32_code },
+		{ armv7m_span_8_code, armv7m_span_16_code, armv7m_span_32_code },
+	};
+	static const uint32_t armv7m_code_sizes[2][3] = {
+		{ sizeof(armv7m_intel_8_code), sizeof(armv7m_intel_16_code), sizeof(armv7m_intel_32_code) },
+		{ sizeof(armv7m_span_8_code), sizeof(armv7m_span_16_code), sizeof(armv7m_span_32_code) },
+	};
+	static const uint8_t *const armv4_5_codes[2][3] = {
+		{ armv4_5_intel_8_code, armv4_5_intel_16_code, armv4_5_intel_32_code },
+		{ armv4_5_span_8_code, armv4_5_span_16_code, armv4_5_span_32_code },
+	};
+	static const uint32_t armv4_5_code_sizes[2][3] = {
+		{ sizeof(armv4_5_intel_8_code), sizeof(armv4_5_intel_16_code), sizeof(armv4_5_intel_32_code) },
+		{ sizeof(armv4_5_span_8_code), sizeof(armv4_5_span_16_code), sizeof(armv4_5_span_32_code) },
+	};
+
+	if (buffersize == 0 || (address & (buffersize - 1)) || (count & (buffersize - 1)))
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	bool spansion;
+	switch (cfi_info->pri_id) {
+		case 1:
+		case 3:
+			spansion = false;
+			break;
+		case 2:
+			spansion = true;
+			break;
+		default:
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	int width;
+	switch (bank->bus_width) {
+		case 1:
+			width = 0;
+			break;
+		case 2:
+			width = 1;
+			break;
+		case 4:
+			width = 2;
+			break;
+		default:
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	if (strncmp(target_type_name(target), "mips_m4k", 8) == 0)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	bool armv7m = is_armv7m(target_to_armv7m(target));
+	if (armv7m) {
+		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+		armv7m_algo.core_mode = ARM_MODE_THREAD;
+		target_code_src = armv7m_codes[spansion][width];
+		target_code_size = armv7m_code_sizes[spansion][width];
+	} else if (is_arm(target_to_arm(target))) {
+		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+		armv4_5_algo.core_mode = ARM_MODE_SVC;
+		armv4_5_algo.core_state = ARM_STATE_ARM;
+		target_code_src = armv4_5_codes[spansion][width];
+		target_code_size = armv4_5_code_sizes[spansion][width];
+	} else
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* the parameter block follows the code */
+	uint32_t params_offset = (target_code_size + 3) & ~3;
+	uint8_t *target_code = calloc(1, params_offset + sizeof(params));
+	if (target_code == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	if (armv7m) {
+		memcpy(target_code, target_code_src, target_code_size);
+	} else {
+		/* ARM code is stored little endian, convert to target endianness */
+		for (uint32_t i = 0; i < target_code_size; i += 4)
+			target_buffer_set_u32(target, target_code + i, le_to_h_u32(target_code_src + i));
+	}
+
+	uint32_t unlock1 = 0, unlock2 = 0;
+	if (spansion) {
+		struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+		unlock1 = cfi_flash_address(bank, 0, pri_ext->_unlock1);
+		unlock2 = cfi_flash_address(bank, 0, pri_ext->_unlock2);
+	}
+
+	params.words = buffersize / bank->bus_width;
+	params.unlock1_addr = unlock1;
+	params.unlock2_addr = unlock2;
+	params.unlock1_cmd = cfi_command_val(bank, 0xaa);
+	params.unlock2_cmd = cfi_command_val(bank, 0x55);
+	params.load_cmd = cfi_command_val(bank, spansion ? 0x25 : 0xe8);
+	params.count_cmd = cfi_command_val(bank, params.words - 1);
+	params.confirm_cmd = cfi_command_val(bank, spansion ? 0x29 : 0xd0);
+	params.ready_mask = cfi_command_val(bank, 0x80);
+	if (spansion) {
+		/* without DQ5 support, poll DQ7 only */
+		if (cfi_info->status_poll_mask & (1 << 5))
+			params.error_mask = cfi_command_val(bank, 0x20);
+		else
+			params.error_mask = 0;
+	} else
+		params.error_mask = cfi_command_val(bank, 0x7e);
+	target_buffer_set_u32_array(target, target_code + params_offset,
+			sizeof(params) / 4, (uint32_t *)&params);
+
+	retval = target_alloc_working_area(target, params_offset + sizeof(params),
+			&write_algorithm);
+	if (retval != ERROR_OK) {
+		free(target_code);
+		LOG_WARNING("No working area available, can't do buffered flash writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			params_offset + sizeof(params), target_code);
+	free(target_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	/* FIFO of whole write buffers behind the write and read pointers, at
+	 * least two so the host can fill one while the target programs one */
+	while (target_alloc_working_area_try(target, fifo_size + 8, &source) != ERROR_OK) {
+		fifo_size /= 2;
+		if (fifo_size < 2 * buffersize) {
+			LOG_WARNING("no large enough working area available, can't do buffered flash writes");
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto cleanup;
+		}
+	}
+	fifo_size &= ~(buffersize - 1);
+
+	if (!spansion)
+		cfi_intel_clear_status_register(bank);
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + 8 + fifo_size);
+	buf_set_u32(reg_params[4].value, 0, 32, write_algorithm->address + params_offset);
+
+	LOG_DEBUG("Buffered write of 0x%" PRIx32 " bytes at 0x%08" PRIx32
+			", %" PRIu32 " byte buffers, FIFO of 0x%" PRIx32 " bytes",
+			count, address, buffersize, fifo_size);
+
+	if (armv7m) {
+		buf_set_u32(reg_params[0].value, 0, 32, source->address);
+		buf_set_u32(reg_params[2].value, 0, 32, address);
+		buf_set_u32(reg_params[3].value, 0, 32, count / buffersize);
+
+		retval = target_run_flash_async_algorithm(target, buffer, count / buffersize,
+				buffersize, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+				source->address, fifo_size + 8,
+				write_algorithm->address, 0, &armv7m_algo);
+	} else {
+		while (count > 0) {
+			uint32_t thisrun_count = (count > fifo_size) ? fifo_size : count;
+
+			/* fill the FIFO, the loader stops after thisrun_count bytes */
+			retval = target_write_u32(target, source->address,
+					source->address + 8 + thisrun_count);
+			if (retval == ERROR_OK)
+				retval = target_write_u32(target, source->address + 4, source->address + 8);
+			if (retval == ERROR_OK)
+				retval = target_write_buffer(target, source->address + 8,
+						thisrun_count, buffer);
+			if (retval != ERROR_OK)
+				break;
+
+			buf_set_u32(reg_params[0].value, 0, 32, source->address);
+			buf_set_u32(reg_params[2].value, 0, 32, address);
+			buf_set_u32(reg_params[3].value, 0, 32, thisrun_count / buffersize);
+
+			retval = target_run_algorithm(target, 0, NULL,
+					ARRAY_SIZE(reg_params), reg_params,
+					write_algorithm->address,
+					write_algorithm->address + target_code_size - 4,
+					1000 + cfi_info->buf_write_timeout * (thisrun_count / buffersize),
+					&armv4_5_algo);
+			if (retval != ERROR_OK)
+				break;
+
+			uint32_t rp;
+			retval = target_read_u32(target, source->address + 4, &rp);
+			if (retval != ERROR_OK)
+				break;
+			if (rp == 0) {
+				LOG_ERROR("flash write algorithm aborted by target");
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
+			}
+
+			buffer += thisrun_count;
+			address += thisrun_count;
+			count -= thisrun_count;
+
+			keep_alive();
+		}
+	}
+
+	if (retval != ERROR_OK) {
+		uint32_t status = buf_get_u32(reg_params[0].value, 0, 32);
+		LOG_ERROR("flash write buffer programming failed, status 0x%" PRIx32, status);
+		if (spansion) {
+			/* write-to-buffer-abort reset */
+			if (cfi_spansion_unlock_seq(bank) == ERROR_OK)
+				cfi_send_command(bank, 0xf0, unlock1);
+		} else {
+			/* read status register (outputs debug information) */
+			uint8_t intel_status;
+			cfi_intel_wait_status_busy(bank, 100, &intel_status);
+			cfi_intel_clear_status_register(bank);
+		}
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			retval = ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+
+	target_free_working_area(target, source);
+cleanup:
+	target_free_working_area(target, write_algorithm);
+
+	return retval;
+}
+
+/* Programs count bytes, whole write buffers with the buffered loaders and
+ * the unaligned head and tail with the word loaders. *done is set to the
+ * number of bytes programmed, also when a later part failed. */
+static int cfi_write_block(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count, uint32_t *done)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	uint32_t buffersize = cfi_write_buffer_size(bank);
+	int retval;
+
+	*done = 0;
+
+	if (buffersize && count >= buffersize) {
+		uint32_t head = (buffersize - (address & (buffersize - 1))) & (buffersize - 1);
+		uint32_t body = (count - head) & ~(buffersize - 1);
+
+		if (body > 0) {
+			if (head > 0) {
+				retval = cfi_write_block(bank, buffer, address, head, done);
+				if (retval != ERROR_OK)
+					return retval;
+				buffer += head;
+				address += head;
+				count -= head;
+			}
+
+			retval = cfi_write_buffers(bank, buffer, address, body);
+			if (retval == ERROR_OK) {
+				*done += body;
+				buffer += body;
+				address += body;
+				count -= body;
+			} else if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+				return retval;
+		}
+	}
+
+	if (count == 0)
+		return ERROR_OK;
+
+	switch (cfi_info->pri_id) {
+		/* try block writes (fails without working area) */
+		case 1:
+		case 3:
+			retval = cfi_intel_write_block(bank, buffer, address, count);
+			break;
+		case 2:
+			retval = cfi_spansion_write_block(bank, buffer, address, count);
+			break;
+		default:
+			LOG_ERROR("cfi primary command set %i unsupported", cfi_info->pri_id);
+			return ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	if (retval == ERROR_OK)
+		*done += count;
+	return retval;
+}
+
 static int cfi_intel_write_word(struct flash_bank *bank, uint8_t *word, uint32_t address)
 {
 	int retval;
@@ -2302,6 +2682,7 @@ static int cfi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t of
 	uint32_t write_p;
 	int align;	/* number of unaligned bytes */
 	int blk_count;	/* number of bus_width bytes for block copy */
+	uint32_t blk_done;	/* number of bytes the block copy wrote */
 	uint8_t current_word[CFI_MAX_BUS_WIDTH * 4];	/* word (bus_width size) currently being
 							 *programmed */
 	uint8_t *swapped_buffer = NULL;
@@ -2362,26 +2743,12 @@ static int cfi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t of
 
 	/* handle blocks of bus_size aligned bytes */
 	blk_count = count & ~(bank->bus_width - 1);	/* round down, leave tail bytes */
-	switch (cfi_info->pri_id) {
-		/* try block writes (fails without working area) */
-		case 1:
-		case 3:
-			retval = cfi_intel_write_block(bank, buffer, write_p, blk_count);
-			break;
-		case 2:
-			retval = cfi_spansion_write_block(bank, buffer, write_p, blk_count);
-			break;
-		default:
-			LOG_ERROR("cfi primary command set %i unsupported", cfi_info->pri_id);
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-	}
-	if (retval == ERROR_OK) {
-		/* Increment pointers and decrease count on successful block write */
-		buffer += blk_count;
-		write_p += blk_count;
-		count -= blk_count;
-	} else {
+	retval = cfi_write_block(bank, buffer, write_p, blk_count, &blk_done);
+	/* Increment pointers and decrease count by what the block write did */
+	buffer += blk_done;
+	write_p += blk_done;
+	count -= blk_done;
+	if (retval != ERROR_OK) {
 		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 			/* Calculate buffer size and boundary mask
 			 * buffersize is (buffer size per chip) * (number of chips)
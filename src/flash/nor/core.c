@@ -341,11 +341,13 @@ int get_flash_bank_by_addr(struct target *target,
 	return ERROR_OK;
 }
 
+/* Read size of the host side blank check. Large reads let the adapter
+ * queue long block transfers instead of a round trip per KiB */
+#define FLASH_BLANK_CHECK_CHUNK (64 * 1024)
+
 static int default_flash_mem_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
-	const int buffer_size = 1024;
-	uint32_t n_bytes;
 	int retval = ERROR_OK;
 
 	if (bank->target->state != TARGET_HALTED) {
@@ -353,36 +355,44 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	uint8_t *buffer = malloc(buffer_size);
+	uint8_t *buffer = malloc(FLASH_BLANK_CHECK_CHUNK);
+	uint8_t *erased = malloc(FLASH_BLANK_CHECK_CHUNK);
+	if (buffer == NULL || erased == NULL) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	/* compare against a block of erased bytes, memcmp() is vectorized
+	 * by the C library and stops at the first difference */
+	memset(erased, bank->erased_value, FLASH_BLANK_CHECK_CHUNK);
 
 	for (unsigned int i = 0; i < bank->num_sectors; i++) {
 		uint32_t j;
 		bank->sectors[i].is_erased = 1;
 
-		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
+		for (j = 0; j < bank->sectors[i].size; j += FLASH_BLANK_CHECK_CHUNK) {
 			uint32_t chunk;
-			chunk = buffer_size;
+			chunk = FLASH_BLANK_CHECK_CHUNK;
 			if (chunk > (bank->sectors[i].size - j))
 				chunk = (bank->sectors[i].size - j);
 
-			retval = target_read_memory(target,
+			retval = target_read_buffer(target,
 					bank->base + bank->sectors[i].offset + j,
-					4,
-					chunk/4,
+					chunk,
 					buffer);
 			if (retval != ERROR_OK)
 				goto done;
 
-			for (n_bytes = 0; n_bytes < chunk; n_bytes++) {
-				if (buffer[n_bytes] != bank->erased_value) {
-					bank->sectors[i].is_erased = 0;
-					break;
-				}
+			if (memcmp(buffer, erased, chunk) != 0) {
+				bank->sectors[i].is_erased = 0;
+				break;
 			}
 		}
 	}
 
 done:
+	free(erased);
 	free(buffer);
 
 	return retval;
@@ -734,6 +744,197 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* One contiguous region of the image, programmed into a single bank */
+struct flash_write_run {
+	struct flash_bank *bank;
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;
+	bool erase_started;	/* erased with erase_start ... */
+	bool erasing;		/* ... and not completed yet */
+};
+
+/* write chunk size while erases run in the background on other banks */
+#define FLASH_WRITE_CHUNK (64 * 1024)
+
+static int flash_driver_erase_start(struct flash_bank *bank, unsigned int first,
+		unsigned int last)
+{
+	int retval;
+
+	retval = bank->driver->erase_start(bank, first, last);
+	if (retval != ERROR_OK && retval != ERROR_FLASH_OPER_UNSUPPORTED)
+		LOG_ERROR("failed starting erase of sectors %u to %u", first, last);
+
+	return retval;
+}
+
+/* Let erases running in the background move on, without waiting */
+static int flash_write_poll_erases(struct flash_write_run *runs, unsigned int num_runs)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < num_runs; i++) {
+		if (!runs[i].erasing)
+			continue;
+
+		int result = runs[i].bank->driver->erase_poll(runs[i].bank);
+		if (result == ERROR_FLASH_BUSY)
+			continue;
+
+		runs[i].erasing = false;
+		if (result != ERROR_OK) {
+			LOG_ERROR("failed erasing flash bank %s", runs[i].bank->name);
+			retval = result;
+		}
+	}
+
+	return retval;
+}
+
+static bool flash_write_erases_pending(struct flash_write_run *runs, unsigned int num_runs)
+{
+	for (unsigned int i = 0; i < num_runs; i++)
+		if (runs[i].erasing)
+			return true;
+
+	return false;
+}
+
+static int flash_write_wait_erase(struct flash_write_run *runs, unsigned int num_runs,
+		struct flash_write_run *run)
+{
+	while (run->erasing) {
+		int retval = flash_write_poll_erases(runs, num_runs);
+		if (retval != ERROR_OK)
+			return retval;
+		if (run->erasing)
+			alive_sleep(5);
+	}
+
+	return ERROR_OK;
+}
+
+/* Write a run, in chunks ending on sector boundaries while other banks
+ * have erases running, so these are kept going in between */
+static int flash_write_run(struct flash_write_run *runs, unsigned int num_runs,
+		struct flash_write_run *run)
+{
+	struct flash_bank *c = run->bank;
+	uint32_t offset = run->address - c->base;
+	uint32_t done = 0;
+	int retval;
+
+	while (done < run->size) {
+		uint32_t count = run->size - done;
+
+		if (count > FLASH_WRITE_CHUNK && flash_write_erases_pending(runs, num_runs)) {
+			for (unsigned int sector = 0; sector < c->num_sectors; sector++) {
+				uint32_t boundary = c->sectors[sector].offset;
+				if (boundary >= offset + done + FLASH_WRITE_CHUNK &&
+						boundary < offset + run->size) {
+					count = boundary - (offset + done);
+					break;
+				}
+			}
+		}
+
+		retval = flash_driver_write(c, run->buffer + done, offset + done, count);
+		if (retval != ERROR_OK)
+			return retval;
+		done += count;
+
+		retval = flash_write_poll_erases(runs, num_runs);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+/* Unlock, erase, write and verify the collected runs. Banks supporting
+ * erase_start get the erase of their first run started up front, so it
+ * proceeds while the runs of other banks are written. */
+static int flash_write_runs(struct target *target, struct flash_write_run *runs,
+	unsigned int num_runs, uint32_t *written, bool erase, bool unlock, bool write,
+	bool verify)
+{
+	int retval = ERROR_OK;
+
+	if (unlock) {
+		for (unsigned int i = 0; i < num_runs; i++) {
+			retval = flash_unlock_address_range(target, runs[i].address, runs[i].size);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	if (erase && num_runs > 1) {
+		for (unsigned int i = 0; i < num_runs; i++) {
+			struct flash_bank *c = runs[i].bank;
+
+			if (!c->driver->erase_start || !c->driver->erase_poll)
+				continue;
+			/* only the first run of each bank */
+			if (i > 0 && runs[i - 1].bank == c)
+				continue;
+
+			retval = flash_iterate_address_range(target, "erase", runs[i].address,
+					runs[i].size, false, &flash_driver_erase_start);
+			if (retval == ERROR_FLASH_OPER_UNSUPPORTED) {
+				/* declined by the driver in this configuration */
+				retval = ERROR_OK;
+				continue;
+			}
+			if (retval != ERROR_OK)
+				goto done;
+			runs[i].erase_started = true;
+			runs[i].erasing = true;
+		}
+	}
+
+	for (unsigned int i = 0; i < num_runs; i++) {
+		struct flash_write_run *run = &runs[i];
+
+		if (erase) {
+			if (run->erase_started) {
+				retval = flash_write_wait_erase(runs, num_runs, run);
+			} else {
+				/* calculate and erase sectors */
+				retval = flash_erase_address_range(target,
+						true, run->address, run->size);
+			}
+			if (retval != ERROR_OK)
+				goto done;
+		}
+
+		if (write) {
+			/* write flash sectors */
+			retval = flash_write_run(runs, num_runs, run);
+			if (retval != ERROR_OK)
+				goto done;
+		}
+
+		if (verify) {
+			/* verify flash sectors */
+			retval = flash_driver_verify(run->bank, run->buffer,
+					run->address - run->bank->base, run->size);
+			if (retval != ERROR_OK)
+				goto done;
+		}
+
+		if (written != NULL)
+			*written += run->size;	/* add run size to total written counter */
+	}
+
+done:
+	/* don't leave erases running behind */
+	for (unsigned int i = 0; i < num_runs; i++)
+		flash_write_wait_erase(runs, num_runs, &runs[i]);
+
+	return retval;
+}
+
 int flash_write_unlock_verify(struct target *target, struct image *image,
 	uint32_t *written, bool erase, bool unlock, bool write, bool verify)
 {
@@ -743,6 +944,8 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 	uint32_t section_offset;
 	struct flash_bank *c;
 	int *padding;
+	struct flash_write_run *runs = NULL;
+	unsigned int num_runs = 0;
 
 	section = 0;
 	section_offset = 0;
@@ -901,7 +1104,8 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			run_size += delta;
 		}
 
-		/* allocate buffer */
+		/* allocate buffer, always a private copy of the image data:
+		 * drivers may patch it, e.g. lpc2000 inserts the vector checksum */
 		buffer = malloc(run_size);
 		if (buffer == NULL) {
 			LOG_ERROR("Out of memory for flash bank buffer");
@@ -956,44 +1160,29 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			}
 		}
 
-		retval = ERROR_OK;
-
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
-			}
-		}
-
-		if (retval == ERROR_OK) {
-			if (write) {
-				/* write flash sectors */
-				retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
-			}
-		}
-
-		if (retval == ERROR_OK) {
-			if (verify) {
-				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
-			}
-		}
-
-		free(buffer);
-
-		if (retval != ERROR_OK) {
-			/* abort operation */
+		struct flash_write_run *new_runs = realloc(runs, (num_runs + 1) * sizeof(*runs));
+		if (new_runs == NULL) {
+			LOG_ERROR("Out of memory for flash write runs");
+			free(buffer);
+			retval = ERROR_FAIL;
 			goto done;
 		}
-
-		if (written != NULL)
-			*written += run_size;	/* add run size to total written counter */
+		runs = new_runs;
+		runs[num_runs++] = (struct flash_write_run) {
+			.bank = c,
+			.address = run_address,
+			.size = run_size,
+			.buffer = buffer,
+		};
 	}
 
+	retval = flash_write_runs(target, runs, num_runs, written, erase, unlock,
+			write, verify);
+
 done:
+	for (unsigned int i = 0; i < num_runs; i++)
+		free(runs[i].buffer);
+	free(runs);
 	free(sections);
 	free(padding);
 
@@ -107,6 +107,38 @@ struct flash_driver {
 	int (*erase)(struct flash_bank *bank, unsigned int first,
 		unsigned int last);
 
+	/**
+	 * Optional: start erasing the specified sectors like
+	 * flash_driver_s::erase does, but return as soon as the
+	 * erase is running. The erase is driven to completion by
+	 * flash_driver_s::erase_poll, which must be called before
+	 * any other access to this bank.
+	 *
+	 * Other banks may be read, written and erased meanwhile, so
+	 * only provide this if the hardware allows it, e.g. for
+	 * a flash behind its own controller.
+	 *
+	 * @param bank The bank of flash to be erased.
+	 * @param first The number of the first sector to erase.
+	 * @param last The number of the last sector to erase.
+	 * @returns ERROR_OK if the erase has been started,
+	 * ERROR_FLASH_OPER_UNSUPPORTED if it can't run in the background
+	 * in the current configuration (the caller then uses
+	 * flash_driver_s::erase instead); otherwise, an error code.
+	 */
+	int (*erase_start)(struct flash_bank *bank, unsigned int first,
+		unsigned int last);
+
+	/**
+	 * Check on and advance an erase started with
+	 * flash_driver_s::erase_start, without waiting for it.
+	 *
+	 * @param bank The bank being erased.
+	 * @returns ERROR_FLASH_BUSY while the erase is still running,
+	 * ERROR_OK once it completed; otherwise, an error code.
+	 */
+	int (*erase_poll)(struct flash_bank *bank);
+
 	/**
 	 * Bank/sector protection routine (target-specific).
 	 *
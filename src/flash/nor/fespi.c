@@ -124,7 +124,8 @@
 struct fespi_flash_bank {
 	bool probed;
 	target_addr_t ctrl_base;
-	const struct flash_device *dev;
+	unsigned int lanes;		/* data lanes wired to the flash, 0: as set up in ffmt */
+	struct spi_nor nor;
 };
 
 struct fespi_target {
@@ -159,11 +160,21 @@ FLASH_BANK_COMMAND_HANDLER(fespi_flash_bank_command)
 	bank->driver_priv = fespi_info;
 	fespi_info->probed = false;
 	fespi_info->ctrl_base = 0;
+	fespi_info->lanes = 0;
 	if (CMD_ARGC >= 7) {
 		COMMAND_PARSE_ADDRESS(CMD_ARGV[6], fespi_info->ctrl_base);
 		LOG_DEBUG("ASSUMING FESPI device at ctrl_base = " TARGET_ADDR_FMT,
 				fespi_info->ctrl_base);
 	}
+	if (CMD_ARGC >= 8) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[7], fespi_info->lanes);
+		if (fespi_info->lanes != 1 && fespi_info->lanes != 2 && fespi_info->lanes != 4) {
+			LOG_ERROR("data lanes must be 1, 2 or 4");
+			free(fespi_info);
+			bank->driver_priv = NULL;
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
 
 	return ERROR_OK;
 }
@@ -319,6 +330,105 @@ static int fespi_wip(struct flash_bank *bank, int timeout)
 	return ERROR_FAIL;
 }
 
+/* Send 'out_len' bytes and then clock in 'in_len' bytes in SW mode, as a
+ * single transfer with CS held */
+static int fespi_sw_xfer(struct flash_bank *bank, const uint8_t *out,
+		unsigned int out_len, uint8_t *in, unsigned int in_len)
+{
+	int retval = ERROR_OK;
+
+	fespi_set_dir(bank, FESPI_DIR_RX);
+
+	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_HOLD) != ERROR_OK)
+		return ERROR_FAIL;
+
+	/* the command bytes fit in the FIFOs, drop what they clock in */
+	for (unsigned int i = 0; i < out_len; i++) {
+		retval = fespi_tx(bank, out[i]);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+	for (unsigned int i = 0; i < out_len; i++) {
+		retval = fespi_rx(bank, NULL);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+
+	for (unsigned int i = 0; i < in_len; i++) {
+		retval = fespi_tx(bank, 0);
+		if (retval != ERROR_OK)
+			goto done;
+		retval = fespi_rx(bank, &in[i]);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+
+done:
+	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_AUTO) != ERROR_OK)
+		return ERROR_FAIL;
+	fespi_set_dir(bank, FESPI_DIR_TX);
+
+	return retval;
+}
+
+/* SFDP is read single lane, with 3 address bytes and 8 dummy clocks */
+static int fespi_read_sfdp_block(struct flash_bank *bank, uint32_t addr,
+		uint32_t words, uint32_t *buffer)
+{
+	uint8_t cmd[] = { SPIFLASH_READ_SFDP, addr >> 16, addr >> 8, addr, 0 };
+	uint8_t *data = malloc(4 * words);
+	if (data == NULL) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = fespi_sw_xfer(bank, cmd, sizeof(cmd), data, 4 * words);
+	for (uint32_t i = 0; i < words; i++)
+		buffer[i] = le_to_h_u32(data + 4 * i);
+
+	free(data);
+	return retval;
+}
+
+/* Read modes the controller and its wiring support. Quad modes are only
+ * used if the flash has them enabled already, as e.g. by the boot code. */
+static unsigned int fespi_read_modes(struct flash_bank *bank)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+	unsigned int lanes = fespi_info->lanes;
+	unsigned int modes = SPI_MODE_BIT(SPI_MODE_1_1_1);
+	uint32_t ffmt;
+	uint8_t cmd, mask, status;
+
+	if (lanes == 0) {
+		if (fespi_read_reg(bank, &ffmt, FESPI_REG_FFMT) != ERROR_OK)
+			return modes;
+		lanes = 1 << ((ffmt >> 12) & 0x3);
+	}
+
+	if (lanes >= 2)
+		modes |= SPI_MODE_BIT(SPI_MODE_1_1_2) | SPI_MODE_BIT(SPI_MODE_1_2_2);
+
+	if (lanes >= 4) {
+		if (!spi_nor_quad_enable_bit(&fespi_info->nor, &cmd, &mask))
+			status = mask = 0;
+		else if (cmd == 0 || fespi_sw_xfer(bank, &cmd, 1, &status, 1) != ERROR_OK)
+			status = 0;
+
+		if ((status & mask) || mask == 0)
+			modes |= SPI_MODE_BIT(SPI_MODE_1_1_4) | SPI_MODE_BIT(SPI_MODE_1_4_4);
+		else
+			LOG_INFO("quad enable bit not set, no quad reads");
+	}
+
+	/* pad_cnt is only 4 bits wide, 4 byte addresses aren't handled */
+	for (unsigned int mode = 0; mode < SPI_MODE_NUM; mode++)
+		if (fespi_info->nor.read_ops[mode].dummy > 15 || fespi_info->nor.addr_len != 3)
+			modes &= ~SPI_MODE_BIT(mode);
+
+	return modes | SPI_MODE_BIT(SPI_MODE_1_1_1);
+}
+
 static int fespi_erase_sector(struct flash_bank *bank, int sector)
 {
 	struct fespi_flash_bank *fespi_info = bank->driver_priv;
@@ -333,19 +443,16 @@ static int fespi_erase_sector(struct flash_bank *bank, int sector)
 
 	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_HOLD) != ERROR_OK)
 		return ERROR_FAIL;
-	retval = fespi_tx(bank, fespi_info->dev->erase_cmd);
+	retval = fespi_tx(bank, fespi_info->nor.dev.erase_cmd);
 	if (retval != ERROR_OK)
 		return retval;
+	/* the erase instruction takes as many address bytes as the reads */
 	sector = bank->sectors[sector].offset;
-	retval = fespi_tx(bank, sector >> 16);
-	if (retval != ERROR_OK)
-		return retval;
-	retval = fespi_tx(bank, sector >> 8);
-	if (retval != ERROR_OK)
-		return retval;
-	retval = fespi_tx(bank, sector);
-	if (retval != ERROR_OK)
-		return retval;
+	for (int shift = 8 * (fespi_info->nor.addr_len - 1); shift >= 0; shift -= 8) {
+		retval = fespi_tx(bank, sector >> shift);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 	retval = fespi_txwm_wait(bank);
 	if (retval != ERROR_OK)
 		return retval;
@@ -390,7 +497,7 @@ static int fespi_erase(struct flash_bank *bank, unsigned int first,
 		}
 	}
 
-	if (fespi_info->dev->erase_cmd == 0x00)
+	if (fespi_info->nor.dev.erase_cmd == 0x00)
 		return ERROR_FLASH_OPER_UNSUPPORTED;
 
 	if (fespi_write_reg(bank, FESPI_REG_TXCTRL, FESPI_TXWM(1)) != ERROR_OK)
@@ -743,9 +850,9 @@ static int fespi_write(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	if (offset + count > fespi_info->dev->size_in_bytes) {
+	if (offset + count > fespi_info->nor.dev.size_in_bytes) {
 		LOG_WARNING("Write past end of flash. Extra data discarded.");
-		count = fespi_info->dev->size_in_bytes - offset;
+		count = fespi_info->nor.dev.size_in_bytes - offset;
 	}
 
 	/* Check sector protection */
@@ -795,8 +902,8 @@ static int fespi_write(struct flash_bank *bank, const uint8_t *buffer,
 	}
 
 	/* If no valid page_size, use reasonable default. */
-	page_size = fespi_info->dev->pagesize ?
-		fespi_info->dev->pagesize : SPIFLASH_DEF_PAGESIZE;
+	page_size = fespi_info->nor.dev.pagesize ?
+		fespi_info->nor.dev.pagesize : SPIFLASH_DEF_PAGESIZE;
 
 	fespi_txwm_wait(bank);
 
@@ -850,6 +957,59 @@ err:
 	return retval;
 }
 
+/* Reads go through the memory mapped interface, switched to the fastest
+ * read mode for the duration of the read */
+static int fespi_read(struct flash_bank *bank, uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+	const struct spi_read_op *op = &fespi_info->nor.read_ops[fespi_info->nor.read_mode];
+	unsigned int addr_proto = FESPI_PROTO_S, data_proto;
+	uint32_t ffmt;
+	int retval;
+
+	if (!(fespi_info->probed)) {
+		LOG_ERROR("Flash bank not probed");
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	switch (fespi_info->nor.read_mode) {
+	case SPI_MODE_1_2_2:
+		addr_proto = FESPI_PROTO_D;
+		/* fall through */
+	case SPI_MODE_1_1_2:
+		data_proto = FESPI_PROTO_D;
+		break;
+	case SPI_MODE_1_4_4:
+		addr_proto = FESPI_PROTO_Q;
+		/* fall through */
+	case SPI_MODE_1_1_4:
+		data_proto = FESPI_PROTO_Q;
+		break;
+	default:
+		return default_flash_read(bank, buffer, offset, count);
+	}
+
+	retval = fespi_read_reg(bank, &ffmt, FESPI_REG_FFMT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the pad code goes out as mode bits too, zero never selects
+	 * continuous read mode */
+	retval = fespi_write_reg(bank, FESPI_REG_FFMT,
+			FESPI_INSN_CMD_EN | FESPI_INSN_ADDR_LEN(3) |
+			FESPI_INSN_PAD_CNT(op->dummy) | FESPI_INSN_CMD_PROTO(FESPI_PROTO_S) |
+			FESPI_INSN_ADDR_PROTO(addr_proto) | FESPI_INSN_DATA_PROTO(data_proto) |
+			FESPI_INSN_CMD_CODE(op->cmd) | FESPI_INSN_PAD_CODE(0x00));
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = default_flash_read(bank, buffer, offset, count);
+
+	int retval2 = fespi_write_reg(bank, FESPI_REG_FFMT, ffmt);
+	return retval != ERROR_OK ? retval : retval2;
+}
+
 /* Return ID of flash device */
 /* On exit, SW mode is kept */
 static int fespi_read_flash_id(struct flash_bank *bank, uint32_t *id)
@@ -908,14 +1068,14 @@ static int fespi_probe(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
 	struct fespi_flash_bank *fespi_info = bank->driver_priv;
-	struct flash_sector *sectors;
 	uint32_t id = 0; /* silence uninitialized warning */
 	const struct fespi_target *target_device;
 	int retval;
-	uint32_t sectorsize;
 
-	if (fespi_info->probed)
+	if (fespi_info->probed) {
 		free(bank->sectors);
+		bank->sectors = NULL;
+	}
 	fespi_info->probed = false;
 
 	if (fespi_info->ctrl_base == 0) {
@@ -950,55 +1110,28 @@ static int fespi_probe(struct flash_bank *bank)
 		return ERROR_FAIL;
 
 	retval = fespi_read_flash_id(bank, &id);
+	if (retval == ERROR_OK)
+		retval = spi_nor_probe(bank, &fespi_info->nor, id, fespi_read_sfdp_block);
+	if (retval == ERROR_OK)
+		spi_nor_select_read(&fespi_info->nor, fespi_read_modes(bank));
 
 	if (fespi_enable_hw_mode(bank) != ERROR_OK)
 		return ERROR_FAIL;
 	if (retval != ERROR_OK)
 		return retval;
 
-	fespi_info->dev = NULL;
-	for (const struct flash_device *p = flash_devices; p->name ; p++)
-		if (p->device_id == id) {
-			fespi_info->dev = p;
-			break;
-		}
-
-	if (!fespi_info->dev) {
-		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
-		return ERROR_FAIL;
-	}
-
 	LOG_INFO("Found flash device \'%s\' (ID 0x%08" PRIx32 ")",
-			fespi_info->dev->name, fespi_info->dev->device_id);
-
-	/* Set correct size value */
-	bank->size = fespi_info->dev->size_in_bytes;
+			fespi_info->nor.dev.name, fespi_info->nor.dev.device_id);
 
-	if (bank->size <= (1UL << 16))
+	if (fespi_info->nor.dev.size_in_bytes <= (1UL << 16))
 		LOG_WARNING("device needs 2-byte addresses - not implemented");
-	if (bank->size > (1UL << 24))
+	if (fespi_info->nor.dev.size_in_bytes > (1UL << 24))
 		LOG_WARNING("device needs paging or 4-byte addresses - not implemented");
 
-	/* if no sectors, treat whole bank as single sector */
-	sectorsize = fespi_info->dev->sectorsize ?
-		fespi_info->dev->sectorsize : fespi_info->dev->size_in_bytes;
-
-	/* create and fill sectors array */
-	bank->num_sectors = fespi_info->dev->size_in_bytes / sectorsize;
-	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
-	if (sectors == NULL) {
-		LOG_ERROR("not enough memory");
-		return ERROR_FAIL;
-	}
-
-	for (unsigned int sector = 0; sector < bank->num_sectors; sector++) {
-		sectors[sector].offset = sector * sectorsize;
-		sectors[sector].size = sectorsize;
-		sectors[sector].is_erased = -1;
-		sectors[sector].is_protected = 0;
-	}
+	retval = spi_nor_init_sectors(bank, &fespi_info->nor.dev);
+	if (retval != ERROR_OK)
+		return retval;
 
-	bank->sectors = sectors;
 	fespi_info->probed = true;
 	return ERROR_OK;
 }
@@ -1027,8 +1160,10 @@ static int get_fespi_info(struct flash_bank *bank, struct command_invocation *cm
 	}
 
 	command_print_sameline(cmd, "\nFESPI flash information:\n"
-			"  Device \'%s\' (ID 0x%08" PRIx32 ")\n",
-			fespi_info->dev->name, fespi_info->dev->device_id);
+			"  Device \'%s\' (ID 0x%08" PRIx32 ")\n"
+			"  Read mode %s\n",
+			fespi_info->nor.dev.name, fespi_info->nor.dev.device_id,
+			spi_mode_name(fespi_info->nor.read_mode));
 
 	return ERROR_OK;
 }
@@ -1039,7 +1174,7 @@ const struct flash_driver fespi_flash = {
 	.erase = fespi_erase,
 	.protect = fespi_protect,
 	.write = fespi_write,
-	.read = default_flash_read,
+	.read = fespi_read,
 	.probe = fespi_probe,
 	.auto_probe = fespi_auto_probe,
 	.erase_check = default_flash_blank_check,
@@ -26,12 +26,22 @@
 
 #define JTAGSPI_MAX_TIMEOUT 3000
 
+/* Pipelined page programming: number of pages per queue flush, status
+ * polls queued after each page and the bounds of the adaptive delay. */
+#define JTAGSPI_BATCH_PAGES 32
+#define JTAGSPI_POLLS 4
+#define JTAGSPI_PROG_DELAY_US 1000
+#define JTAGSPI_MIN_PROG_DELAY_US 50
+#define JTAGSPI_MAX_PROG_DELAY_US 10000
+
 
 struct jtagspi_flash_bank {
 	struct jtag_tap *tap;
-	const struct flash_device *dev;
+	struct spi_nor nor;
 	bool probed;
 	uint32_t ir;
+	unsigned int addr_len;
+	unsigned int prog_delay_us;
 };
 
 FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
@@ -50,6 +60,8 @@ FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 
 	info->tap = NULL;
 	info->probed = false;
+	info->addr_len = 3;
+	info->prog_delay_us = JTAGSPI_PROG_DELAY_US;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[6], info->ir);
 
 	return ERROR_OK;
@@ -75,15 +87,18 @@ static void flip_u8(uint8_t *in, uint8_t *out, int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+/* Queue a command without executing it. Out values are copied by the JTAG
+ * layer, but for reads (len < 0) the bit-reversed response is only
+ * captured into data once the queue is executed. */
+static int jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
 		uint32_t *addr, uint8_t *data, int len)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	struct scan_field fields[6];
 	uint8_t marker = 1;
 	uint8_t xfer_bits_buf[4];
-	uint8_t addr_buf[3];
-	uint8_t *data_buf;
+	uint8_t addr_buf[4];
+	uint8_t *data_buf = NULL;
 	uint32_t xfer_bits;
 	int is_read, lenb, n;
 
@@ -103,7 +118,7 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	xfer_bits = 8 + len - 1;
 	/* cmd + read/write - 1 due to the counter implementation */
 	if (addr)
-		xfer_bits += 24;
+		xfer_bits += 8 * info->addr_len;
 	h_u32_to_be(xfer_bits_buf, xfer_bits);
 	flip_u8(xfer_bits_buf, xfer_bits_buf, 4);
 	fields[n].num_bits = 32;
@@ -118,21 +133,16 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	n++;
 
 	if (addr) {
-		h_u24_to_be(addr_buf, *addr);
-		flip_u8(addr_buf, addr_buf, 3);
-		fields[n].num_bits = 24;
+		h_u32_to_be(addr_buf, *addr);
+		flip_u8(addr_buf + 4 - info->addr_len, addr_buf, info->addr_len);
+		fields[n].num_bits = 8 * info->addr_len;
 		fields[n].out_value = addr_buf;
 		fields[n].in_value = NULL;
 		n++;
 	}
 
 	lenb = DIV_ROUND_UP(len, 8);
-	data_buf = malloc(lenb);
 	if (lenb > 0) {
-		if (data_buf == NULL) {
-			LOG_ERROR("no memory for spi buffer");
-			return ERROR_FAIL;
-		}
 		if (is_read) {
 			fields[n].num_bits = jtag_tap_count_enabled();
 			fields[n].out_value = NULL;
@@ -140,8 +150,13 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 			n++;
 
 			fields[n].out_value = NULL;
-			fields[n].in_value = data_buf;
+			fields[n].in_value = data;
 		} else {
+			data_buf = malloc(lenb);
+			if (data_buf == NULL) {
+				LOG_ERROR("no memory for spi buffer");
+				return ERROR_FAIL;
+			}
 			flip_u8(data, data_buf, lenb);
 			fields[n].out_value = data_buf;
 			fields[n].in_value = NULL;
@@ -153,23 +168,56 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	jtagspi_set_ir(bank);
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	int retval = jtag_execute_queue();
 
-	if (is_read)
-		flip_u8(data_buf, data, lenb);
 	free(data_buf);
+	return ERROR_OK;
+}
+
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint32_t *addr, uint8_t *data, int len)
+{
+	int lenb = DIV_ROUND_UP(len < 0 ? -len : len, 8);
+
+	int retval = jtagspi_queue_cmd(bank, cmd, addr, data, len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+
+	if (len < 0)
+		flip_u8(data, data, lenb);
+	return retval;
+}
+
+/* SFDP is read with 8 dummy clocks, i.e. one extra leading byte */
+static int jtagspi_read_sfdp_block(struct flash_bank *bank, uint32_t addr,
+	uint32_t words, uint32_t *buffer)
+{
+	uint8_t *buf = malloc(1 + 4 * words);
+	if (buf == NULL) {
+		LOG_ERROR("no memory for spi buffer");
+		return ERROR_FAIL;
+	}
+
+	int retval = jtagspi_cmd(bank, SPIFLASH_READ_SFDP, &addr, buf, -8 * (int)(1 + 4 * words));
+	for (uint32_t i = 0; i < words; i++)
+		buffer[i] = le_to_h_u32(buf + 1 + 4 * i);
+
+	free(buf);
 	return retval;
 }
 
 static int jtagspi_probe(struct flash_bank *bank)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
-	struct flash_sector *sectors;
 	uint8_t in_buf[3];
-	uint32_t id, sectorsize;
+	uint32_t id;
+	int retval;
 
-	if (info->probed)
+	if (info->probed) {
 		free(bank->sectors);
+		bank->sectors = NULL;
+	}
 	info->probed = false;
 
 	if (bank->target->tap == NULL) {
@@ -177,53 +225,33 @@ static int jtagspi_probe(struct flash_bank *bank)
 		return ERROR_FAIL;
 	}
 	info->tap = bank->target->tap;
+	/* ID and SFDP reads always take 3 address bytes */
+	info->addr_len = 3;
 
 	jtagspi_cmd(bank, SPIFLASH_READ_ID, NULL, in_buf, -24);
 	/* the table in spi.c has the manufacturer byte (first) as the lsb */
 	id = le_to_h_u24(in_buf);
 
-	info->dev = NULL;
-	for (const struct flash_device *p = flash_devices; p->name ; p++)
-		if (p->device_id == id) {
-			info->dev = p;
-			break;
-		}
-
-	if (!(info->dev)) {
-		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
-		return ERROR_FAIL;
-	}
+	retval = spi_nor_probe(bank, &info->nor, id, jtagspi_read_sfdp_block);
+	if (retval != ERROR_OK)
+		return retval;
 
 	LOG_INFO("Found flash device \'%s\' (ID 0x%08" PRIx32 ")",
-		info->dev->name, info->dev->device_id);
+		info->nor.dev.name, info->nor.dev.device_id);
 
-	/* Set correct size value */
-	bank->size = info->dev->size_in_bytes;
-	if (bank->size <= (1UL << 16))
+	if (info->nor.dev.size_in_bytes <= (1UL << 16))
 		LOG_WARNING("device needs 2-byte addresses - not implemented");
-	if (bank->size > (1UL << 24))
+	if (info->nor.dev.size_in_bytes > (1UL << 24) && info->nor.addr_len != 4)
 		LOG_WARNING("device needs paging or 4-byte addresses - not implemented");
+	info->addr_len = info->nor.addr_len;
 
-	/* if no sectors, treat whole bank as single sector */
-	sectorsize = info->dev->sectorsize ?
-		info->dev->sectorsize : info->dev->size_in_bytes;
-
-	/* create and fill sectors array */
-	bank->num_sectors = info->dev->size_in_bytes / sectorsize;
-	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
-	if (sectors == NULL) {
-		LOG_ERROR("not enough memory");
-		return ERROR_FAIL;
-	}
+	/* the proxy bitstream only connects a single data lane each way */
+	spi_nor_select_read(&info->nor, SPI_MODE_BIT(SPI_MODE_1_1_1));
 
-	for (unsigned int sector = 0; sector < bank->num_sectors; sector++) {
-		sectors[sector].offset = sector * sectorsize;
-		sectors[sector].size = sectorsize;
-		sectors[sector].is_erased = -1;
-		sectors[sector].is_protected = 0;
-	}
+	retval = spi_nor_init_sectors(bank, &info->nor.dev);
+	if (retval != ERROR_OK)
+		return retval;
 
-	bank->sectors = sectors;
 	info->probed = true;
 	return ERROR_OK;
 }
@@ -287,13 +315,13 @@ static int jtagspi_bulk_erase(struct flash_bank *bank)
 	int retval;
 	int64_t t0 = timeval_ms();
 
-	if (info->dev->chip_erase_cmd == 0x00)
+	if (info->nor.dev.chip_erase_cmd == 0x00)
 		return ERROR_FLASH_OPER_UNSUPPORTED;
 
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, info->dev->chip_erase_cmd, NULL, NULL, 0);
+	jtagspi_cmd(bank, info->nor.dev.chip_erase_cmd, NULL, NULL, 0);
 	retval = jtagspi_wait(bank, bank->num_sectors*JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("took %" PRId64 " ms", timeval_ms() - t0);
 	return retval;
@@ -308,7 +336,7 @@ static int jtagspi_sector_erase(struct flash_bank *bank, unsigned int sector)
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, info->dev->erase_cmd, &bank->sectors[sector].offset, NULL, 0);
+	jtagspi_cmd(bank, info->nor.dev.erase_cmd, &bank->sectors[sector].offset, NULL, 0);
 	retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("sector %u took %" PRId64 " ms", sector, timeval_ms() - t0);
 	return retval;
@@ -340,7 +368,7 @@ static int jtagspi_erase(struct flash_bank *bank, unsigned int first,
 	}
 
 	if (first == 0 && last == (bank->num_sectors - 1)
-		&& info->dev->chip_erase_cmd != info->dev->erase_cmd) {
+		&& info->nor.dev.chip_erase_cmd != info->nor.dev.erase_cmd) {
 		LOG_DEBUG("Trying bulk erase.");
 		retval = jtagspi_bulk_erase(bank);
 		if (retval == ERROR_OK)
@@ -349,7 +377,7 @@ static int jtagspi_erase(struct flash_bank *bank, unsigned int first,
 			LOG_WARNING("Bulk flash erase failed. Falling back to sector erase.");
 	}
 
-	if (info->dev->erase_cmd == 0x00)
+	if (info->nor.dev.erase_cmd == 0x00)
 		return ERROR_FLASH_OPER_UNSUPPORTED;
 
 	for (unsigned int sector = first; sector <= last; sector++) {
@@ -380,26 +408,137 @@ static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offse
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
-	jtagspi_cmd(bank, SPIFLASH_READ, &offset, buffer, -count*8);
+	jtagspi_cmd(bank, info->nor.read_ops[info->nor.read_mode].cmd, &offset, buffer, -count*8);
 	return ERROR_OK;
 }
 
 static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
+	struct jtagspi_flash_bank *info = bank->driver_priv;
 	int retval;
 
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, SPIFLASH_PAGE_PROGRAM, &offset, (uint8_t *) buffer, count*8);
+	jtagspi_cmd(bank, info->nor.dev.pprog_cmd, &offset, (uint8_t *) buffer, count*8);
 	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
 }
 
+/* Queue write enable, a status read, page program, a delay covering tPP
+ * and a few spaced status polls for up to JTAGSPI_BATCH_PAGES pages, then
+ * flush the queue once. A page program is only accepted with the write
+ * enable latch set and the flash not busy, the status read just before it
+ * tells which pages were programmed. Those skipped because the previous
+ * page was still busy are written again one by one afterwards; later pages
+ * may well have been accepted, so they are not written twice. */
+static int jtagspi_write_batch(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, uint32_t pagesize, uint32_t *done)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	uint8_t enabled[JTAGSPI_BATCH_PAGES];
+	uint8_t status[JTAGSPI_BATCH_PAGES][JTAGSPI_POLLS];
+	unsigned int khz = jtag_get_speed_khz();
+	int delay = MAX(DIV_ROUND_UP(info->prog_delay_us * khz, 1000), 1);
+	int poll_delay = MAX(delay / 2, 1);
+	unsigned int pages = MIN(DIV_ROUND_UP(count, pagesize), JTAGSPI_BATCH_PAGES);
+	unsigned int late = 0;
+	int retval;
+
+	*done = 0;
+
+	for (unsigned int i = 0; i < pages; i++) {
+		uint32_t page_offset = offset + i * pagesize;
+		uint32_t len = MIN(count - i * pagesize, pagesize);
+
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL,
+				&enabled[i], -8);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = jtagspi_queue_cmd(bank, info->nor.dev.pprog_cmd, &page_offset,
+				(uint8_t *) buffer + i * pagesize, len * 8);
+		if (retval != ERROR_OK)
+			return retval;
+		jtag_add_runtest(delay, TAP_IDLE);
+
+		for (unsigned int j = 0; j < JTAGSPI_POLLS; j++) {
+			if (j > 0)
+				jtag_add_runtest(poll_delay, TAP_IDLE);
+			retval = jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL,
+					&status[i][j], -8);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	bool slow = false;
+	for (unsigned int i = 0; i < pages; i++) {
+		uint32_t st = flip_u32(enabled[i], 8);
+		unsigned int j;
+
+		/* skipped, the status polls are about the previous page */
+		if ((st & SPIFLASH_BSY_BIT) || !(st & SPIFLASH_WE_BIT))
+			continue;
+
+		for (j = 0; j < JTAGSPI_POLLS; j++)
+			if ((flip_u32(status[i][j], 8) & SPIFLASH_BSY_BIT) == 0)
+				break;
+
+		if (j == JTAGSPI_POLLS)
+			slow = true;
+		else
+			late = MAX(late, j);
+	}
+
+	if (slow) {
+		info->prog_delay_us = MIN(2 * info->prog_delay_us,
+				JTAGSPI_MAX_PROG_DELAY_US);
+		LOG_DEBUG("page still busy, program delay now %u us", info->prog_delay_us);
+	} else if (late == 0) {
+		/* aim for the first or second poll to see the page done */
+		info->prog_delay_us = MAX(info->prog_delay_us - info->prog_delay_us / 8,
+				JTAGSPI_MIN_PROG_DELAY_US);
+	} else if (late > 1) {
+		info->prog_delay_us = MIN(info->prog_delay_us + info->prog_delay_us / 4,
+				JTAGSPI_MAX_PROG_DELAY_US);
+	}
+
+	/* the last page may still be in progress */
+	if (flip_u32(status[pages - 1][JTAGSPI_POLLS - 1], 8) & SPIFLASH_BSY_BIT) {
+		retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (unsigned int i = 0; i < pages; i++) {
+		uint32_t st = flip_u32(enabled[i], 8);
+
+		if (!(st & SPIFLASH_BSY_BIT) && (st & SPIFLASH_WE_BIT))
+			continue;
+
+		LOG_DEBUG("page at 0x%08" PRIx32 " skipped, writing it again",
+				offset + i * pagesize);
+		retval = jtagspi_page_write(bank, buffer + i * pagesize,
+				offset + i * pagesize, MIN(count - i * pagesize, pagesize));
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	*done = MIN(pages * pagesize, count);
+
+	return ERROR_OK;
+}
+
 static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	int retval;
-	uint32_t n, pagesize;
+	uint32_t n, pagesize, done;
 
 	if (!(info->probed)) {
 		LOG_ERROR("Flash bank not yet probed.");
@@ -407,16 +546,25 @@ static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	}
 
 	/* if no write pagesize, use reasonable default */
-	pagesize = info->dev->pagesize ? info->dev->pagesize : SPIFLASH_DEF_PAGESIZE;
-
-	for (n = 0; n < count; n += pagesize) {
-		retval = jtagspi_page_write(bank, buffer + n, offset + n,
-				MIN(count - n, pagesize));
+	pagesize = info->nor.dev.pagesize ? info->nor.dev.pagesize : SPIFLASH_DEF_PAGESIZE;
+
+	/* The first page goes through the fully checked path, which also makes
+	 * sure write enable takes effect. The rest is pipelined unless the TCK
+	 * frequency is unknown (adaptive clocking), as then no delay can be
+	 * derived from a number of clocks. */
+	for (n = 0; n < count; n += done) {
+		if (n == 0 || jtag_get_speed_khz() == 0) {
+			done = MIN(count - n, pagesize);
+			retval = jtagspi_page_write(bank, buffer + n, offset + n, done);
+		} else {
+			retval = jtagspi_write_batch(bank, buffer + n, offset + n,
+					count - n, pagesize, &done);
+		}
 		if (retval != ERROR_OK) {
 			LOG_ERROR("page write error");
 			return retval;
 		}
-		LOG_DEBUG("wrote page at 0x%08" PRIx32, offset + n);
+		LOG_DEBUG("wrote 0x%" PRIx32 " bytes at 0x%08" PRIx32, done, offset + n);
 	}
 	return ERROR_OK;
 }
@@ -432,7 +580,7 @@ static int jtagspi_info(struct flash_bank *bank, struct command_invocation *cmd)
 
 	command_print_sameline(cmd, "\nSPIFI flash information:\n"
 		"  Device \'%s\' (ID 0x%08" PRIx32 ")\n",
-		info->dev->name, info->dev->device_id);
+		info->nor.dev.name, info->nor.dev.device_id);
 
 	return ERROR_OK;
 }
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * Compressed transport for target_run_flash_async_algorithm(): the host
+ * sends an LZ4 block through the usual fifo and a front-end loader on the
+ * target decompresses it and feeds the family flash_write routine. This
+ * pays off on slow debug links, where moving the bytes dominates.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "imp.h"
+#include "lz4_write.h"
+#include <helper/binarybuffer.h>
+#include <helper/lz4.h>
+#include <target/algorithm.h>
+#include <target/armv7m.h>
+
+/* Room for the nested calls of the front-end and the flash_write routine */
+#define LZ4_WRITE_STACK_SIZE	128
+
+static bool lz4_write_on;
+static uint64_t lz4_write_raw_bytes;
+static uint64_t lz4_write_sent_bytes;
+
+void lz4_write_enable(bool enable)
+{
+	lz4_write_on = enable;
+	if (enable) {
+		lz4_write_raw_bytes = 0;
+		lz4_write_sent_bytes = 0;
+	}
+}
+
+bool lz4_write_enabled(void)
+{
+	return lz4_write_on;
+}
+
+void lz4_write_stats(uint64_t *raw_bytes, uint64_t *sent_bytes)
+{
+	*raw_bytes = lz4_write_raw_bytes;
+	*sent_bytes = lz4_write_sent_bytes;
+}
+
+int lz4_write_block(struct flash_bank *bank, const uint8_t *code, size_t code_size,
+		const uint8_t *buffer, uint32_t count, target_addr_t address,
+		uint32_t param0, uint32_t param1, uint32_t *status)
+{
+	struct target *target = bank->target;
+	struct working_area *write_algorithm;
+	struct working_area *window;
+	struct working_area *source;
+	struct reg_param reg_params[8];
+	struct armv7m_algorithm armv7m_info;
+	size_t packed_size;
+	int retval;
+
+	size_t capacity = LZ4_COMPRESS_BOUND(count);
+	uint8_t *packed = malloc(capacity);
+	if (!packed) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	retval = lz4_compress(buffer, count, packed, capacity, LZ4_WRITE_WINDOW_SIZE, &packed_size);
+	if (retval != ERROR_OK)
+		goto err_packed;
+
+	LOG_DEBUG("compressed %" PRIu32 " bytes to %zu", count, packed_size);
+	if (packed_size >= count) {
+		LOG_DEBUG("data does not compress, using plain block write");
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto err_packed;
+	}
+
+	if (target_alloc_working_area(target, code_size, &write_algorithm) != ERROR_OK) {
+		LOG_DEBUG("no working area for the compressed write algorithm");
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto err_packed;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address, code_size, code);
+	if (retval != ERROR_OK)
+		goto err_algorithm;
+
+	/* ring buffer, with the stack on top of it */
+	if (target_alloc_working_area(target, LZ4_WRITE_WINDOW_SIZE + LZ4_WRITE_STACK_SIZE,
+			&window) != ERROR_OK) {
+		LOG_DEBUG("no working area for the decompression buffer");
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto err_algorithm;
+	}
+
+	/* fifo for the compressed stream */
+	uint32_t buffer_size = target_get_working_area_avail(target) & ~3u;
+	if (buffer_size > 16384)
+		buffer_size = 16384;
+	if (buffer_size < 256 || target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
+		LOG_DEBUG("no working area for the compressed data fifo");
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto err_window;
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* buffer start, status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* target address */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* count (bytes, uncompressed) */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* ring buffer */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* family parameter 0 */
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* family parameter 1 */
+	init_reg_param(&reg_params[7], "sp", 32, PARAM_OUT);	/* stack */
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, address);
+	buf_set_u32(reg_params[3].value, 0, 32, count);
+	buf_set_u32(reg_params[4].value, 0, 32, window->address);
+	buf_set_u32(reg_params[5].value, 0, 32, param0);
+	buf_set_u32(reg_params[6].value, 0, 32, param1);
+	buf_set_u32(reg_params[7].value, 0, 32, (window->address + window->size) & ~7u);
+
+	retval = target_run_flash_async_algorithm(target, packed, packed_size, 1,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	*status = buf_get_u32(reg_params[0].value, 0, 32);
+
+	if (retval == ERROR_OK) {
+		lz4_write_raw_bytes += count;
+		lz4_write_sent_bytes += packed_size;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, source);
+err_window:
+	target_free_working_area(target, window);
+err_algorithm:
+	target_free_working_area(target, write_algorithm);
+err_packed:
+	free(packed);
+	return retval;
+}
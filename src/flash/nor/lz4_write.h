@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_FLASH_NOR_LZ4_WRITE_H
+#define OPENOCD_FLASH_NOR_LZ4_WRITE_H
+
+#include "core.h"
+
+/** Ring buffer size of the LZ4 front-end, see contrib/loaders/flash/lz4 */
+#define LZ4_WRITE_WINDOW_SIZE	4096
+
+/** Enable or disable compressed block writes, enabling resets the statistics */
+void lz4_write_enable(bool enable);
+/** @returns true if drivers should try compressed block writes */
+bool lz4_write_enabled(void);
+/** Bytes programmed through compressed block writes and bytes sent for them */
+void lz4_write_stats(uint64_t *raw_bytes, uint64_t *sent_bytes);
+
+/**
+ * Compress @a count bytes of @a buffer and stream them through an LZ4
+ * front-end loader built around a family specific flash_write routine
+ * (see contrib/loaders/flash/lz4/lz4_cortexm.S).
+ *
+ * @param bank flash bank being written, provides the target
+ * @param code the loader binary
+ * @param code_size size of @a code
+ * @param buffer data to program
+ * @param count number of bytes, a multiple of the family programming unit
+ * @param address flash address to program at
+ * @param param0 first family parameter
+ * @param param1 second family parameter
+ * @param status receives r0 of the loader, the flash status on failure
+ * @returns ERROR_OK on success, ERROR_TARGET_RESOURCE_NOT_AVAILABLE if the
+ * caller should use its uncompressed block write instead, or the error of
+ * target_run_flash_async_algorithm()
+ */
+int lz4_write_block(struct flash_bank *bank, const uint8_t *code, size_t code_size,
+		const uint8_t *buffer, uint32_t count, target_addr_t address,
+		uint32_t param0, uint32_t param1, uint32_t *status);
+
+#endif /* OPENOCD_FLASH_NOR_LZ4_WRITE_H */
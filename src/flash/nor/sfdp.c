@@ -67,9 +67,86 @@ struct sfdp_4byte_addr_param {
 	uint32_t			erase_t1234;	/* 02: erase commands */
 };
 
-/* Try to get parameters from flash via SFDP */
-int spi_sfdp(struct flash_bank *bank, struct flash_device *dev,
-	read_sfdp_block_t read_sfdp_block)
+/* decode a fast read instruction, dummy and mode clocks from one half of
+ * a basic flash parameter table word */
+static void sfdp_read_op(struct spi_nor *nor, enum spi_mode mode, uint16_t half)
+{
+	nor->read_ops[mode].cmd = (half >> 8) & 0xFF;
+	nor->read_ops[mode].dummy = (half & 0x1F) + ((half >> 5) & 0x7);
+	nor->read_modes |= SPI_MODE_BIT(mode);
+}
+
+/* read modes from the basic flash parameter table */
+static void sfdp_read_modes(struct spi_nor *nor,
+	const struct sfdp_basic_flash_param *table, unsigned int words)
+{
+	nor->read_ops[SPI_MODE_1_1_1].cmd = SPIFLASH_READ;
+	nor->read_ops[SPI_MODE_1_1_1].dummy = 0;
+	nor->read_modes = SPI_MODE_BIT(SPI_MODE_1_1_1);
+
+	if (table->fast_addr & (1UL << 16))
+		sfdp_read_op(nor, SPI_MODE_1_1_2, table->fast_1x2 & 0xFFFF);
+	if (table->fast_addr & (1UL << 20))
+		sfdp_read_op(nor, SPI_MODE_1_2_2, table->fast_1x2 >> 16);
+	if (table->fast_addr & (1UL << 22))
+		sfdp_read_op(nor, SPI_MODE_1_1_4, table->fast_1x4 >> 16);
+	if (table->fast_addr & (1UL << 21))
+		sfdp_read_op(nor, SPI_MODE_1_4_4, table->fast_1x4 & 0xFFFF);
+	if (table->fast_444 & (1UL << 0))
+		sfdp_read_op(nor, SPI_MODE_2_2_2, table->read_222 >> 16);
+	if (table->fast_444 & (1UL << 4))
+		sfdp_read_op(nor, SPI_MODE_4_4_4, table->read_444 >> 16);
+
+	if ((offsetof(struct sfdp_basic_flash_param, quad_req) >> 2) < words)
+		nor->quad_enable = (table->quad_req >> 20) & 0x7;
+	else if (nor->read_modes & (SPI_MODE_BIT(SPI_MODE_1_1_4) | SPI_MODE_BIT(SPI_MODE_1_4_4)))
+		/* JESD216 rev. 0 tables don't tell, assume the common bit 1 of SR2 */
+		nor->quad_enable = 5;
+
+	/* octal modes have no support bits, an instruction marks them present */
+	if ((offsetof(struct sfdp_basic_flash_param, read_1x8) >> 2) < words) {
+		if (table->read_1x8 >> 24)
+			sfdp_read_op(nor, SPI_MODE_1_1_8, table->read_1x8 >> 16);
+		if ((table->read_1x8 >> 8) & 0xFF)
+			sfdp_read_op(nor, SPI_MODE_1_8_8, table->read_1x8 & 0xFFFF);
+	}
+}
+
+/* switch read instructions to their 4-byte address variants, as flagged in
+ * the 4-byte address instruction table, drop modes without one */
+static void sfdp_read_modes_4byte(struct spi_nor *nor, uint32_t flags)
+{
+	static const struct {
+		enum spi_mode mode;
+		unsigned int bit;
+		uint8_t cmd;
+	} ops_4byte[] = {
+		{ SPI_MODE_1_1_1, 0, 0x13 },
+		{ SPI_MODE_1_1_2, 2, 0x3C },
+		{ SPI_MODE_1_2_2, 3, 0xBC },
+		{ SPI_MODE_1_1_4, 4, 0x6C },
+		{ SPI_MODE_1_4_4, 5, 0xEC },
+		{ SPI_MODE_1_1_8, 20, 0x7C },
+		{ SPI_MODE_1_8_8, 21, 0xCC },
+	};
+	unsigned int modes = 0;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(ops_4byte); i++) {
+		enum spi_mode mode = ops_4byte[i].mode;
+
+		if ((nor->read_modes & SPI_MODE_BIT(mode)) && (flags & (1UL << ops_4byte[i].bit))) {
+			nor->read_ops[mode].cmd = ops_4byte[i].cmd;
+			modes |= SPI_MODE_BIT(mode);
+		}
+	}
+	nor->read_modes = modes;
+	nor->addr_len = 4;
+}
+
+/* Try to get parameters from flash via SFDP, 'nor' may be NULL if only
+ * the basic parameters in 'dev' are wanted */
+static int sfdp_parse(struct flash_bank *bank, struct flash_device *dev,
+	struct spi_nor *nor, read_sfdp_block_t read_sfdp_block)
 {
 	struct sfdp_hdr header;
 	struct sfdp_phdr *pheaders = NULL;
@@ -196,6 +273,9 @@ int spi_sfdp(struct flash_bank *bank, struct flash_device *dev,
 				}
 			}
 
+			if (nor)
+				sfdp_read_modes(nor, table, words);
+
 			if (dev->size_in_bytes > (1UL << 24)) {
 				if (((table->fast_addr >> 17) & 0x3) == 0x0)
 					LOG_ERROR("device needs paging - not implemented");
@@ -211,13 +291,18 @@ int spi_sfdp(struct flash_bank *bank, struct flash_device *dev,
 					dev->erase_cmd = 0xDC;
 					if (dev->qread_cmd != 0)
 						dev->qread_cmd = 0xEC;
+					if (nor)
+						sfdp_read_modes_4byte(nor, (1UL << 0) | (1UL << 5));
 				} else if (((table->fast_addr >> 17) & 0x3) == 0x1)
 					LOG_INFO("device has to be switched to 4-byte addresses");
 			}
 		} else if (id == SFDP_4BYTE_ADDR) {
 			struct sfdp_4byte_addr_param *table = (struct sfdp_4byte_addr_param *)ptable;
 
-			if (words >= (offsetof(struct sfdp_4byte_addr_param, erase_t1234)
+			if (nor && dev->size_in_bytes <= (1UL << 24)) {
+				/* spi_nor users address small devices with 3 bytes */
+				LOG_DEBUG("4-byte address parameter table not needed");
+			} else if (words >= (offsetof(struct sfdp_4byte_addr_param, erase_t1234)
 				+ sizeof(table->erase_t1234)) >> 2) {
 				LOG_INFO("4-byte address parameter table");
 
@@ -228,6 +313,8 @@ int spi_sfdp(struct flash_bank *bank, struct flash_device *dev,
 					dev->qread_cmd = 0xEC;
 				if (table->flags & (1UL << 6))
 					dev->pprog_cmd = 0x12;
+				if (nor)
+					sfdp_read_modes_4byte(nor, table->flags);
 
 				/* erase instructions */
 				if ((erase_type == 1) && (table->flags & (1UL << 9)))
@@ -261,3 +348,25 @@ err:
 
 	return retval;
 }
+
+int spi_sfdp(struct flash_bank *bank, struct flash_device *dev,
+	read_sfdp_block_t read_sfdp_block)
+{
+	return sfdp_parse(bank, dev, NULL, read_sfdp_block);
+}
+
+/* As spi_sfdp(), but also collects the fast read modes, the addressing
+ * and the quad enable requirements */
+int spi_sfdp_nor(struct flash_bank *bank, struct spi_nor *nor,
+	read_sfdp_block_t read_sfdp_block)
+{
+	memset(nor, 0, sizeof(struct spi_nor));
+	nor->addr_len = 3;
+
+	int retval = sfdp_parse(bank, &nor->dev, nor, read_sfdp_block);
+	if (retval != ERROR_OK)
+		return retval;
+
+	nor->sfdp = true;
+	return ERROR_OK;
+}
@@ -28,6 +28,7 @@
 
 #include "imp.h"
 #include "spi.h"
+#include "sfdp.h"
 #include <jtag/jtag.h>
 
  /* Shared table of known SPI flash devices for SPI-based flash drivers. Taken
@@ -150,3 +151,159 @@ const struct flash_device flash_devices[] = {
 
 	FLASH_ID(NULL,                  0,    0,    0,    0,    0,    0,          0,     0,       0)
 };
+
+static const char * const spi_mode_names[SPI_MODE_NUM] = {
+	[SPI_MODE_1_1_1] = "1-1-1",
+	[SPI_MODE_1_1_2] = "1-1-2",
+	[SPI_MODE_1_2_2] = "1-2-2",
+	[SPI_MODE_2_2_2] = "2-2-2",
+	[SPI_MODE_1_1_4] = "1-1-4",
+	[SPI_MODE_1_4_4] = "1-4-4",
+	[SPI_MODE_4_4_4] = "4-4-4",
+	[SPI_MODE_1_1_8] = "1-1-8",
+	[SPI_MODE_1_8_8] = "1-8-8",
+};
+
+/* read modes, fastest first */
+static const enum spi_mode spi_read_order[] = {
+	SPI_MODE_1_8_8, SPI_MODE_1_1_8, SPI_MODE_4_4_4, SPI_MODE_1_4_4, SPI_MODE_1_1_4,
+	SPI_MODE_2_2_2, SPI_MODE_1_2_2, SPI_MODE_1_1_2, SPI_MODE_1_1_1,
+};
+
+const char *spi_mode_name(enum spi_mode mode)
+{
+	return mode < SPI_MODE_NUM ? spi_mode_names[mode] : "?";
+}
+
+/* Identify the device by its ID in the table above and/or by SFDP, if the
+ * controller driver can read it ('read_sfdp_block' may be NULL).
+ * A table entry keeps its name and instructions, SFDP adds the fast read
+ * modes and replaces the erase block by a larger one if it has any. */
+int spi_nor_probe(struct flash_bank *bank, struct spi_nor *nor, uint32_t id,
+	read_sfdp_block_t read_sfdp_block)
+{
+	const struct flash_device *table = NULL;
+	struct spi_nor sfdp;
+	int retval = ERROR_FAIL;
+
+	for (const struct flash_device *p = flash_devices; p->name ; p++)
+		if (p->device_id == id) {
+			table = p;
+			break;
+		}
+
+	/* FRAMs have neither erase blocks nor SFDP */
+	if (read_sfdp_block && !(table && table->sectorsize == 0))
+		retval = spi_sfdp_nor(bank, &sfdp, read_sfdp_block);
+
+	if (table) {
+		memset(nor, 0, sizeof(struct spi_nor));
+		nor->dev = *table;
+		/* most devices above 16 MiB are listed with their 4-byte address
+		 * instructions, the others only reach the first 16 MiB */
+		if (table->size_in_bytes > (1UL << 24) && table->read_cmd != SPIFLASH_READ)
+			nor->addr_len = 4;
+		else
+			nor->addr_len = 3;
+
+		if (retval == ERROR_OK && sfdp.dev.size_in_bytes == table->size_in_bytes) {
+			/* SFDP instructions only fit if they take the same address length */
+			if (sfdp.addr_len == nor->addr_len) {
+				memcpy(nor->read_ops, sfdp.read_ops, sizeof(nor->read_ops));
+				nor->read_modes = sfdp.read_modes;
+			}
+			nor->quad_enable = sfdp.quad_enable;
+			nor->sfdp = true;
+
+			if (sfdp.dev.sectorsize > table->sectorsize && sfdp.addr_len == nor->addr_len) {
+				LOG_DEBUG("using %" PRIu32 " kB erase blocks (cmd 0x%02" PRIx8 ") from SFDP",
+					sfdp.dev.sectorsize >> 10, sfdp.dev.erase_cmd);
+				nor->dev.erase_cmd = sfdp.dev.erase_cmd;
+				nor->dev.sectorsize = sfdp.dev.sectorsize;
+			}
+		}
+	} else if (retval == ERROR_OK) {
+		*nor = sfdp;
+		nor->dev.device_id = id;
+	} else {
+		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
+		return ERROR_FAIL;
+	}
+
+	if (!(nor->read_modes & SPI_MODE_BIT(SPI_MODE_1_1_1))) {
+		nor->read_ops[SPI_MODE_1_1_1].cmd = nor->dev.read_cmd;
+		nor->read_ops[SPI_MODE_1_1_1].dummy = 0;
+		nor->read_modes |= SPI_MODE_BIT(SPI_MODE_1_1_1);
+	}
+	nor->read_mode = SPI_MODE_1_1_1;
+
+	return ERROR_OK;
+}
+
+/* Select the fastest read mode both the device and the controller ('modes',
+ * a set of SPI_MODE_BIT()) support. Single lane read is always possible. */
+enum spi_mode spi_nor_select_read(struct spi_nor *nor, unsigned int modes)
+{
+	modes &= nor->read_modes;
+
+	nor->read_mode = SPI_MODE_1_1_1;
+	for (unsigned int i = 0; i < ARRAY_SIZE(spi_read_order); i++)
+		if (modes & SPI_MODE_BIT(spi_read_order[i])) {
+			nor->read_mode = spi_read_order[i];
+			break;
+		}
+
+	LOG_DEBUG("read mode %s, cmd 0x%02" PRIx8 ", %u dummy clocks",
+		spi_mode_name(nor->read_mode), nor->read_ops[nor->read_mode].cmd,
+		nor->read_ops[nor->read_mode].dummy);
+	return nor->read_mode;
+}
+
+/* Quad data modes may need the quad enable bit set. Returns false if the
+ * device has no such bit, otherwise the read status command and mask to
+ * check it. A zero 'cmd' means the bit can't be read back. */
+bool spi_nor_quad_enable_bit(const struct spi_nor *nor, uint8_t *cmd, uint8_t *mask)
+{
+	switch (nor->quad_enable) {
+	case 0:
+		return false;
+	case 1:
+		*cmd = 0;
+		*mask = 1 << 1;
+		break;
+	case 2:
+		*cmd = SPIFLASH_READ_STATUS;
+		*mask = 1 << 6;
+		break;
+	case 3:
+		*cmd = SPIFLASH_READ_STATUS3F;
+		*mask = 1 << 7;
+		break;
+	default:
+		/* bit 1 of status register 2 */
+		*cmd = SPIFLASH_READ_STATUS2;
+		*mask = 1 << 1;
+		break;
+	}
+	return true;
+}
+
+/* Set up the bank's size and sectors, one sector per erase block */
+int spi_nor_init_sectors(struct flash_bank *bank, const struct flash_device *dev)
+{
+	/* if no sectors, treat whole bank as single sector */
+	uint32_t sectorsize = dev->sectorsize ? dev->sectorsize : dev->size_in_bytes;
+
+	bank->size = dev->size_in_bytes;
+	bank->num_sectors = dev->size_in_bytes / sectorsize;
+	bank->sectors = alloc_block_array(0, sectorsize, bank->num_sectors);
+	if (bank->sectors == NULL) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int sector = 0; sector < bank->num_sectors; sector++)
+		bank->sectors[sector].is_protected = 0;
+
+	return ERROR_OK;
+}
@@ -71,6 +71,62 @@ struct flash_device {
 
 extern const struct flash_device flash_devices[];
 
+/* transfer modes, named after the number of lanes used for
+ * command, address and data phase */
+enum spi_mode {
+	SPI_MODE_1_1_1 = 0,
+	SPI_MODE_1_1_2,
+	SPI_MODE_1_2_2,
+	SPI_MODE_2_2_2,
+	SPI_MODE_1_1_4,
+	SPI_MODE_1_4_4,
+	SPI_MODE_4_4_4,
+	SPI_MODE_1_1_8,
+	SPI_MODE_1_8_8,
+	SPI_MODE_NUM,
+};
+
+#define SPI_MODE_BIT(m)		(1U << (m))
+
+struct spi_read_op {
+	uint8_t cmd;
+	uint8_t dummy;				/* mode plus dummy clocks */
+};
+
+/* Device parameters merged from the table above and from SFDP, shared by
+ * the SPI flash controller drivers. 'read_modes' holds SPI_MODE_BIT() of
+ * each valid entry of 'read_ops', 'read_mode' is the one selected for the
+ * controller by spi_nor_select_read(). */
+struct spi_nor {
+	struct flash_device dev;
+	struct spi_read_op read_ops[SPI_MODE_NUM];
+	unsigned int read_modes;
+	enum spi_mode read_mode;
+	unsigned int addr_len;		/* 3 or 4 address bytes */
+	unsigned int quad_enable;	/* JESD216 quad enable requirements, 0: none */
+	bool sfdp;					/* parameters (partly) from SFDP */
+};
+
+struct flash_bank;
+
+/* per JESD216D 'addr' is *byte* based but must be word aligned,
+ * 'buffer' is word based, word aligned and always little-endian encoded,
+ * in the flash, 'addr_len' is 3 or 4, 'dummy' ***usually*** 8
+ *
+ * the actual number of dummy clocks should be worked out by this function
+ * dynamically, i.e. by scanning the first few bytes for the SFDP signature
+ *
+ * buffer contents is supposed to be returned in ***host*** endianness */
+typedef int (*read_sfdp_block_t)(struct flash_bank *bank, uint32_t addr,
+	uint32_t words, uint32_t *buffer);
+
+int spi_nor_probe(struct flash_bank *bank, struct spi_nor *nor, uint32_t id,
+	read_sfdp_block_t read_sfdp_block);
+enum spi_mode spi_nor_select_read(struct spi_nor *nor, unsigned int modes);
+bool spi_nor_quad_enable_bit(const struct spi_nor *nor, uint8_t *cmd, uint8_t *mask);
+int spi_nor_init_sectors(struct flash_bank *bank, const struct flash_device *dev);
+const char *spi_mode_name(enum spi_mode mode);
+
 #endif
 
 /* fields in SPI flash status register */
@@ -89,6 +145,8 @@ extern const struct flash_device flash_devices[];
 #define SPIFLASH_READ			0x03 /* Normal Read */
 #define SPIFLASH_MASS_ERASE		0xC7 /* Mass Erase */
 #define SPIFLASH_READ_SFDP		0x5A /* Read Serial Flash Discoverable Parameters */
+#define SPIFLASH_READ_STATUS2	0x35 /* Read Status Register 2 */
+#define SPIFLASH_READ_STATUS3F	0x3F /* Read Status Register, QE in bit 7 */
 
 #define SPIFLASH_DEF_PAGESIZE	256  /* default for non-page-oriented devices (FRAMs) */
 
@@ -27,7 +27,9 @@
 #endif
 
 #include "imp.h"
+#include "lz4_write.h"
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include <target/algorithm.h>
 #include <target/cortex_m.h>
 
@@ -146,6 +148,11 @@
 #define STM32_FLASH_OPTCR1  0x40023c18
 #define STM32_FLASH_OPTCR2  0x40023c1c
 
+/* CRC calculation unit, usable by the checksum code */
+#define STM32_CRC_BASE      0x40023000
+#define STM32_RCC_AHB1ENR   0x40023830
+#define STM32_RCC_AHB1ENR_CRCEN	(1 << 12)
+
 /* FLASH_CR register bits */
 #define FLASH_PG       (1 << 0)
 #define FLASH_SER      (1 << 1)
@@ -206,6 +213,9 @@ struct stm32x_flash_bank {
 	bool has_optcr2_pcrop;	/* F72x/73x */
 	unsigned int protection_bits; /* F413/423 */
 	uint32_t user_bank_size;
+	unsigned int erase_sector;	/* sector being erased by erase_start/erase_poll */
+	unsigned int erase_last;	/* last sector to erase by erase_start/erase_poll */
+	int64_t erase_t0;			/* start of current sector erase */
 };
 
 static bool stm32x_is_otp(struct flash_bank *bank)
@@ -281,28 +291,12 @@ static inline int stm32x_get_flash_status(struct flash_bank *bank, uint32_t *sta
 	return target_read_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_SR), status);
 }
 
-static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
+/* Report and clear the error flags of a completed operation */
+static int stm32x_check_status_errors(struct flash_bank *bank, uint32_t status)
 {
 	struct target *target = bank->target;
-	uint32_t status;
 	int retval = ERROR_OK;
 
-	/* wait for busy to clear */
-	for (;;) {
-		retval = stm32x_get_flash_status(bank, &status);
-		if (retval != ERROR_OK)
-			return retval;
-		LOG_DEBUG("status: 0x%" PRIx32, status);
-		if ((status & FLASH_BSY) == 0)
-			break;
-		if (timeout-- <= 0) {
-			LOG_ERROR("timed out waiting for flash");
-			return ERROR_FAIL;
-		}
-		alive_sleep(1);
-	}
-
-
 	if (status & FLASH_WRPERR) {
 		LOG_ERROR("stm32x device protected");
 		retval = ERROR_FAIL;
@@ -321,6 +315,29 @@ static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
 	return retval;
 }
 
+static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
+{
+	uint32_t status;
+	int retval = ERROR_OK;
+
+	/* wait for busy to clear */
+	for (;;) {
+		retval = stm32x_get_flash_status(bank, &status);
+		if (retval != ERROR_OK)
+			return retval;
+		LOG_DEBUG("status: 0x%" PRIx32, status);
+		if ((status & FLASH_BSY) == 0)
+			break;
+		if (timeout-- <= 0) {
+			LOG_ERROR("timed out waiting for flash");
+			return ERROR_FAIL;
+		}
+		alive_sleep(1);
+	}
+
+	return stm32x_check_status_errors(bank, status);
+}
+
 static int stm32x_unlock_reg(struct target *target)
 {
 	uint32_t ctrl;
@@ -600,10 +617,23 @@ static int stm32x_protect_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+static int stm32x_erase_sector_start(struct flash_bank *bank, unsigned int sector)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+	unsigned int snb;
+
+	if (stm32x_info->has_large_mem && sector >= 12)
+		snb = (sector - 12) | 0x10;
+	else
+		snb = sector;
+
+	return target_write_u32(bank->target, stm32x_get_flash_reg(bank, STM32_FLASH_CR),
+			FLASH_SER | FLASH_SNB(snb) | FLASH_STRT);
+}
+
 static int stm32x_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
-	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
 	struct target *target = bank->target;
 
 	if (stm32x_is_otp(bank)) {
@@ -635,14 +665,7 @@ static int stm32x_erase(struct flash_bank *bank, unsigned int first,
 	 */
 
 	for (unsigned int i = first; i <= last; i++) {
-		unsigned int snb;
-		if (stm32x_info->has_large_mem && i >= 12)
-			snb = (i - 12) | 0x10;
-		else
-			snb = i;
-
-		retval = target_write_u32(target,
-				stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_SER | FLASH_SNB(snb) | FLASH_STRT);
+		retval = stm32x_erase_sector_start(bank, i);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -660,6 +683,82 @@ static int stm32x_erase(struct flash_bank *bank, unsigned int first,
 	return ERROR_OK;
 }
 
+/* The OTP bank shares the controller, so no background erase while it
+ * can be written */
+static bool stm32x_controller_shared(struct flash_bank *bank)
+{
+	for (struct flash_bank *b = flash_bank_list(); b; b = b->next)
+		if (b != bank && b->target == bank->target && b->driver == bank->driver &&
+				(!stm32x_is_otp(b) || stm32x_is_otp_unlocked(b)))
+			return true;
+
+	return false;
+}
+
+/* Erase in the background, while the host works on other banks. F42x/43x
+ * and F7 dual bank parts have one control register for both banks, so one
+ * bank can't be programmed while the other erases. */
+static int stm32x_erase_start(struct flash_bank *bank, unsigned int first,
+		unsigned int last)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+	int retval;
+
+	if (stm32x_is_otp(bank) || stm32x_controller_shared(bank))
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	assert((first <= last) && (last < bank->num_sectors));
+
+	if (bank->target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	retval = stm32x_unlock_reg(bank->target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	stm32x_info->erase_sector = first;
+	stm32x_info->erase_last = last;
+	stm32x_info->erase_t0 = timeval_ms();
+
+	return stm32x_erase_sector_start(bank, first);
+}
+
+static int stm32x_erase_poll(struct flash_bank *bank)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t status;
+	int retval;
+
+	retval = stm32x_get_flash_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (status & FLASH_BSY) {
+		if (timeval_ms() - stm32x_info->erase_t0 <= FLASH_ERASE_TIMEOUT)
+			return ERROR_FLASH_BUSY;
+		LOG_ERROR("timed out waiting for flash");
+		return ERROR_FAIL;
+	}
+
+	retval = stm32x_check_status_errors(bank, status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	bank->sectors[stm32x_info->erase_sector].is_erased = 1;
+
+	if (stm32x_info->erase_sector < stm32x_info->erase_last) {
+		stm32x_info->erase_sector++;
+		stm32x_info->erase_t0 = timeval_ms();
+		retval = stm32x_erase_sector_start(bank, stm32x_info->erase_sector);
+		return retval == ERROR_OK ? ERROR_FLASH_BUSY : retval;
+	}
+
+	return target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_LOCK);
+}
+
 static int stm32x_protect(struct flash_bank *bank, int set, unsigned int first,
 		unsigned int last)
 {
@@ -699,6 +798,44 @@ static int stm32x_protect(struct flash_bank *bank, int set, unsigned int first,
 	return ERROR_OK;
 }
 
+static int stm32x_write_block_error(struct target *target, uint32_t status)
+{
+	LOG_ERROR("error executing stm32x flash write algorithm");
+
+	uint32_t error = status & FLASH_ERROR;
+
+	if (error & FLASH_WRPERR)
+		LOG_ERROR("flash memory write protected");
+
+	if (error != 0) {
+		LOG_ERROR("flash write failed = 0x%08" PRIx32, error);
+		/* Clear but report errors */
+		target_write_u32(target, STM32_FLASH_SR, error);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_FLASH_OPERATION_FAILED;
+}
+
+static int stm32x_write_block_lz4(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	uint32_t status;
+
+	static const uint8_t stm32x_flash_write_lz4_code[] = {
+#include "../../../contrib/loaders/flash/stm32/stm32f2x_lz4.inc"
+	};
+
+	int retval = lz4_write_block(bank, stm32x_flash_write_lz4_code,
+			sizeof(stm32x_flash_write_lz4_code), buffer, count * 2,
+			bank->base + offset, STM32_FLASH_BASE, 0, &status);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		retval = stm32x_write_block_error(bank->target, status);
+
+	return retval;
+}
+
 static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t count)
 {
@@ -720,6 +857,12 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_FAIL;
 	}
 
+	if (lz4_write_enabled()) {
+		retval = stm32x_write_block_lz4(bank, buffer, offset, count);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+	}
+
 	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code),
 			&write_algorithm) != ERROR_OK) {
 		LOG_WARNING("no working area available, can't do block memory writes");
@@ -769,21 +912,8 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 			write_algorithm->address, 0,
 			&armv7m_info);
 
-	if (retval == ERROR_FLASH_OPERATION_FAILED) {
-		LOG_ERROR("error executing stm32x flash write algorithm");
-
-		uint32_t error = buf_get_u32(reg_params[0].value, 0, 32) & FLASH_ERROR;
-
-		if (error & FLASH_WRPERR)
-			LOG_ERROR("flash memory write protected");
-
-		if (error != 0) {
-			LOG_ERROR("flash write failed = 0x%08" PRIx32, error);
-			/* Clear but report errors */
-			target_write_u32(target, STM32_FLASH_SR, error);
-			retval = ERROR_FAIL;
-		}
-	}
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		retval = stm32x_write_block_error(target, buf_get_u32(reg_params[0].value, 0, 32));
 
 	target_free_working_area(target, source);
 	target_free_working_area(target, write_algorithm);
@@ -996,6 +1126,7 @@ static int stm32x_probe(struct flash_bank *bank)
 	uint16_t max_flash_size_in_kb;
 	uint32_t device_id;
 	uint32_t base_address = 0x08000000;
+	bool crc_init_pol = false;
 
 	stm32x_info->probed = false;
 	stm32x_info->has_large_mem = false;
@@ -1083,6 +1214,7 @@ static int stm32x_probe(struct flash_bank *bank)
 		break;
 
 	case 0x449:	/* F74x/75x */
+		crc_init_pol = true;
 		max_flash_size_in_kb = 1024;
 		max_sector_size_in_kb = 256;
 		flash_size_reg = 0x1FF0F442;
@@ -1091,6 +1223,7 @@ static int stm32x_probe(struct flash_bank *bank)
 		break;
 
 	case 0x451:	/* F76x/77x */
+		crc_init_pol = true;
 		max_flash_size_in_kb = 2048;
 		max_sector_size_in_kb = 256;
 		flash_size_reg = 0x1FF0F442;
@@ -1099,6 +1232,7 @@ static int stm32x_probe(struct flash_bank *bank)
 		break;
 
 	case 0x452:	/* F72x/73x */
+		crc_init_pol = true;
 		max_flash_size_in_kb = 512;
 		flash_size_reg = 0x1FF07A22;	/* yes, 0x1FF*0*7A22, not 0x1FF*F*7A22 */
 		stm32x_info->has_extra_options = true;
@@ -1118,6 +1252,12 @@ static int stm32x_probe(struct flash_bank *bank)
 		return ERROR_FAIL;
 	}
 
+	/* all F2/F4/F7 parts share the same CRC unit, F7 adds INIT and POL;
+	 * let verify use it */
+	if (is_armv7m(target_to_armv7m(target)))
+		armv7m_set_crc_unit(target, STM32_CRC_BASE, STM32_RCC_AHB1ENR,
+				STM32_RCC_AHB1ENR_CRCEN, crc_init_pol);
+
 	/* get flash size from target. */
 	retval = target_read_u16(target, flash_size_reg, &flash_size_in_kb);
 
@@ -1822,6 +1962,8 @@ const struct flash_driver stm32f2x_flash = {
 	.commands = stm32x_command_handlers,
 	.flash_bank_command = stm32x_flash_bank_command,
 	.erase = stm32x_erase,
+	.erase_start = stm32x_erase_start,
+	.erase_poll = stm32x_erase_poll,
 	.protect = stm32x_protect,
 	.write = stm32x_write,
 	.read = default_flash_read,
@@ -20,6 +20,7 @@
 
 #include "imp.h"
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include <target/algorithm.h>
 #include <target/armv7m.h>
 
@@ -131,6 +132,9 @@ struct stm32h7x_flash_bank {
 	uint32_t user_bank_size;
 	uint32_t flash_regs_base;    /* Address of flash reg controller */
 	const struct stm32h7x_part_info *part_info;
+	unsigned int erase_sector;	/* sector being erased by erase_start/erase_poll */
+	unsigned int erase_last;	/* last sector to erase by erase_start/erase_poll */
+	int64_t erase_t0;			/* start of current sector erase */
 };
 
 enum stm32h7x_opt_rdp {
@@ -266,6 +270,26 @@ static inline int stm32x_get_flash_status(struct flash_bank *bank, uint32_t *sta
 	return stm32x_read_flash_reg(bank, FLASH_SR, status);
 }
 
+/* Report and clear the error flags of a completed operation */
+static int stm32x_check_status_errors(struct flash_bank *bank, uint32_t status)
+{
+	int retval = ERROR_OK;
+
+	if (status & FLASH_WRPERR) {
+		LOG_ERROR("wait_flash_op_queue, WRPERR detected");
+		retval = ERROR_FAIL;
+	}
+
+	/* Clear error + EOP flags but report errors */
+	if (status & FLASH_ERROR) {
+		if (retval == ERROR_OK)
+			retval = ERROR_FAIL;
+		/* If this operation fails, we ignore it and report the original retval */
+		stm32x_write_flash_reg(bank, FLASH_CCR, status);
+	}
+	return retval;
+}
+
 static int stm32x_wait_flash_op_queue(struct flash_bank *bank, int timeout)
 {
 	uint32_t status;
@@ -287,19 +311,7 @@ static int stm32x_wait_flash_op_queue(struct flash_bank *bank, int timeout)
 		alive_sleep(1);
 	}
 
-	if (status & FLASH_WRPERR) {
-		LOG_ERROR("wait_flash_op_queue, WRPERR detected");
-		retval = ERROR_FAIL;
-	}
-
-	/* Clear error + EOP flags but report errors */
-	if (status & FLASH_ERROR) {
-		if (retval == ERROR_OK)
-			retval = ERROR_FAIL;
-		/* If this operation fails, we ignore it and report the original retval */
-		stm32x_write_flash_reg(bank, FLASH_CCR, status);
-	}
-	return retval;
+	return stm32x_check_status_errors(bank, status);
 }
 
 static int stm32x_unlock_reg(struct flash_bank *bank)
@@ -466,10 +478,23 @@ static int stm32x_protect_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+static int stm32x_erase_sector_start(struct flash_bank *bank, unsigned int sector)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+
+	LOG_DEBUG("erase sector %u", sector);
+	int retval = stm32x_write_flash_reg(bank, FLASH_CR,
+			stm32x_info->part_info->compute_flash_cr(FLASH_SER | FLASH_PSIZE_64, sector));
+	if (retval != ERROR_OK)
+		return retval;
+
+	return stm32x_write_flash_reg(bank, FLASH_CR,
+			stm32x_info->part_info->compute_flash_cr(FLASH_SER | FLASH_PSIZE_64 | FLASH_START, sector));
+}
+
 static int stm32x_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
-	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
 	int retval, retval2;
 
 	assert(first < bank->num_sectors);
@@ -493,15 +518,7 @@ static int stm32x_erase(struct flash_bank *bank, unsigned int first,
 	4. Wait for flash operations completion
 	 */
 	for (unsigned int i = first; i <= last; i++) {
-		LOG_DEBUG("erase sector %u", i);
-		retval = stm32x_write_flash_reg(bank, FLASH_CR,
-				stm32x_info->part_info->compute_flash_cr(FLASH_SER | FLASH_PSIZE_64, i));
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error erase sector %u", i);
-			goto flash_lock;
-		}
-		retval = stm32x_write_flash_reg(bank, FLASH_CR,
-				stm32x_info->part_info->compute_flash_cr(FLASH_SER | FLASH_PSIZE_64 | FLASH_START, i));
+		retval = stm32x_erase_sector_start(bank, i);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Error erase sector %u", i);
 			goto flash_lock;
@@ -523,6 +540,87 @@ flash_lock:
 	return (retval == ERROR_OK) ? retval2 : retval;
 }
 
+/* Each bank of the dual bank parts has its own control and status
+ * registers, so one bank can be erased in the background while the other
+ * one is programmed */
+static int stm32x_erase_start(struct flash_bank *bank, unsigned int first,
+		unsigned int last)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+	int retval;
+
+	assert(first < bank->num_sectors);
+	assert(last < bank->num_sectors);
+
+	if (bank->target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	/* two bank definitions on the same registers can't overlap */
+	for (struct flash_bank *b = flash_bank_list(); b; b = b->next) {
+		struct stm32h7x_flash_bank *info = b->driver_priv;
+		if (b != bank && b->target == bank->target && b->driver == bank->driver &&
+				info->flash_regs_base == stm32x_info->flash_regs_base)
+			return ERROR_FLASH_OPER_UNSUPPORTED;
+	}
+
+	retval = stm32x_unlock_reg(bank);
+	if (retval == ERROR_OK) {
+		stm32x_info->erase_sector = first;
+		stm32x_info->erase_last = last;
+		stm32x_info->erase_t0 = timeval_ms();
+		retval = stm32x_erase_sector_start(bank, first);
+	}
+
+	if (retval != ERROR_OK)
+		stm32x_lock_reg(bank);
+
+	return retval;
+}
+
+static int stm32x_erase_poll(struct flash_bank *bank)
+{
+	struct stm32h7x_flash_bank *stm32x_info = bank->driver_priv;
+	uint32_t status;
+	int retval;
+
+	retval = stm32x_get_flash_status(bank, &status);
+	if (retval != ERROR_OK)
+		goto flash_lock;
+
+	if (status & FLASH_QW) {
+		if (timeval_ms() - stm32x_info->erase_t0 <= FLASH_ERASE_TIMEOUT)
+			return ERROR_FLASH_BUSY;
+		LOG_ERROR("wait_flash_op_queue, time out expired, status: 0x%" PRIx32, status);
+		retval = ERROR_FAIL;
+		goto flash_lock;
+	}
+
+	retval = stm32x_check_status_errors(bank, status);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("erase time-out or operation error sector %u", stm32x_info->erase_sector);
+		goto flash_lock;
+	}
+
+	bank->sectors[stm32x_info->erase_sector].is_erased = 1;
+
+	if (stm32x_info->erase_sector < stm32x_info->erase_last) {
+		stm32x_info->erase_sector++;
+		stm32x_info->erase_t0 = timeval_ms();
+		retval = stm32x_erase_sector_start(bank, stm32x_info->erase_sector);
+		if (retval == ERROR_OK)
+			return ERROR_FLASH_BUSY;
+	}
+
+flash_lock:
+	if (stm32x_lock_reg(bank) != ERROR_OK) {
+		LOG_ERROR("error during the lock of flash");
+		if (retval == ERROR_OK)
+			retval = ERROR_FAIL;
+	}
+
+	return retval;
+}
+
 static int stm32x_protect(struct flash_bank *bank, int set, unsigned int first,
 		unsigned int last)
 {
@@ -1202,6 +1300,8 @@ const struct flash_driver stm32h7x_flash = {
 	.commands = stm32x_command_handlers,
 	.flash_bank_command = stm32x_flash_bank_command,
 	.erase = stm32x_erase,
+	.erase_start = stm32x_erase_start,
+	.erase_poll = stm32x_erase_poll,
 	.protect = stm32x_protect,
 	.write = stm32x_write,
 	.read = default_flash_read,
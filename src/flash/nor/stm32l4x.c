@@ -24,7 +24,9 @@
 #endif
 
 #include "imp.h"
+#include "lz4_write.h"
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include <target/algorithm.h>
 #include <target/armv7m.h>
 #include "bits.h"
@@ -208,6 +210,9 @@ struct stm32l4_flash_bank {
 	bool otp_enabled;
 	enum stm32l4_rdp rdp;
 	bool tzen;
+	unsigned int erase_sector;	/* page being erased by erase_start/erase_poll */
+	unsigned int erase_last;	/* last page to erase by erase_start/erase_poll */
+	int64_t erase_t0;			/* start of current page erase */
 };
 
 enum stm32_bank_id {
@@ -685,6 +690,29 @@ static inline int stm32l4_write_flash_reg_by_index(struct flash_bank *bank,
 	return stm32l4_write_flash_reg(bank, stm32l4_info->flash_regs[reg_index], value);
 }
 
+/* Report and clear the error flags of a completed operation */
+static int stm32l4_check_status_errors(struct flash_bank *bank, uint32_t status)
+{
+	int retval = ERROR_OK;
+
+	if (status & FLASH_WRPERR) {
+		LOG_ERROR("stm32x device protected");
+		retval = ERROR_FAIL;
+	}
+
+	/* Clear but report errors */
+	if (status & FLASH_ERROR) {
+		if (retval == ERROR_OK)
+			retval = ERROR_FAIL;
+		/* If this operation fails, we ignore it and report the original
+		 * retval
+		 */
+		stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX, status & FLASH_ERROR);
+	}
+
+	return retval;
+}
+
 static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout)
 {
 	uint32_t status;
@@ -705,22 +733,7 @@ static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout)
 		alive_sleep(1);
 	}
 
-	if (status & FLASH_WRPERR) {
-		LOG_ERROR("stm32x device protected");
-		retval = ERROR_FAIL;
-	}
-
-	/* Clear but report errors */
-	if (status & FLASH_ERROR) {
-		if (retval == ERROR_OK)
-			retval = ERROR_FAIL;
-		/* If this operation fails, we ignore it and report the original
-		 * retval
-		 */
-		stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX, status & FLASH_ERROR);
-	}
-
-	return retval;
+	return stm32l4_check_status_errors(bank, status);
 }
 
 static int stm32l4_unlock_reg(struct flash_bank *bank)
@@ -951,10 +964,25 @@ static int stm32l4_protect_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+static int stm32l4_erase_page_start(struct flash_bank *bank, unsigned int page)
+{
+	struct stm32l4_flash_bank *stm32l4_info = bank->driver_priv;
+	uint32_t erase_flags;
+	erase_flags = FLASH_PER | FLASH_STRT;
+
+	if (page >= stm32l4_info->bank1_sectors) {
+		uint8_t snb;
+		snb = page - stm32l4_info->bank1_sectors;
+		erase_flags |= snb << FLASH_PAGE_SHIFT | FLASH_CR_BKER;
+	} else
+		erase_flags |= page << FLASH_PAGE_SHIFT;
+
+	return stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_CR_INDEX, erase_flags);
+}
+
 static int stm32l4_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
-	struct stm32l4_flash_bank *stm32l4_info = bank->driver_priv;
 	int retval, retval2;
 
 	assert((first <= last) && (last < bank->num_sectors));
@@ -985,16 +1013,7 @@ static int stm32l4_erase(struct flash_bank *bank, unsigned int first,
 	 */
 
 	for (unsigned int i = first; i <= last; i++) {
-		uint32_t erase_flags;
-		erase_flags = FLASH_PER | FLASH_STRT;
-
-		if (i >= stm32l4_info->bank1_sectors) {
-			uint8_t snb;
-			snb = i - stm32l4_info->bank1_sectors;
-			erase_flags |= snb << FLASH_PAGE_SHIFT | FLASH_CR_BKER;
-		} else
-			erase_flags |= i << FLASH_PAGE_SHIFT;
-		retval = stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_CR_INDEX, erase_flags);
+		retval = stm32l4_erase_page_start(bank, i);
 		if (retval != ERROR_OK)
 			break;
 
@@ -1014,6 +1033,85 @@ err_lock:
 	return retval2;
 }
 
+/* Erase in the background, while the host works on other banks. Dual bank
+ * parts have a single control register for both banks, so one bank can't
+ * be programmed while the other erases; an enabled OTP bank shares it too. */
+static int stm32l4_erase_start(struct flash_bank *bank, unsigned int first,
+		unsigned int last)
+{
+	struct stm32l4_flash_bank *stm32l4_info = bank->driver_priv;
+	int retval;
+
+	assert((first <= last) && (last < bank->num_sectors));
+
+	if (stm32l4_is_otp(bank))
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	for (struct flash_bank *b = flash_bank_list(); b; b = b->next)
+		if (b != bank && b->target == bank->target && b->driver == bank->driver &&
+				(!stm32l4_is_otp(b) || stm32l4_otp_is_enabled(b)))
+			return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	if (bank->target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	retval = stm32l4_unlock_reg(bank);
+	if (retval == ERROR_OK) {
+		stm32l4_info->erase_sector = first;
+		stm32l4_info->erase_last = last;
+		stm32l4_info->erase_t0 = timeval_ms();
+		retval = stm32l4_erase_page_start(bank, first);
+	}
+
+	if (retval != ERROR_OK)
+		stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_CR_INDEX, FLASH_LOCK);
+
+	return retval;
+}
+
+static int stm32l4_erase_poll(struct flash_bank *bank)
+{
+	struct stm32l4_flash_bank *stm32l4_info = bank->driver_priv;
+	uint32_t status;
+	int retval, retval2;
+
+	retval = stm32l4_read_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX, &status);
+	if (retval != ERROR_OK)
+		goto err_lock;
+
+	if (status & FLASH_BSY) {
+		if (timeval_ms() - stm32l4_info->erase_t0 <= FLASH_ERASE_TIMEOUT)
+			return ERROR_FLASH_BUSY;
+		LOG_ERROR("timed out waiting for flash");
+		retval = ERROR_FAIL;
+		goto err_lock;
+	}
+
+	retval = stm32l4_check_status_errors(bank, status);
+	if (retval != ERROR_OK)
+		goto err_lock;
+
+	bank->sectors[stm32l4_info->erase_sector].is_erased = 1;
+
+	if (stm32l4_info->erase_sector < stm32l4_info->erase_last) {
+		stm32l4_info->erase_sector++;
+		stm32l4_info->erase_t0 = timeval_ms();
+		retval = stm32l4_erase_page_start(bank, stm32l4_info->erase_sector);
+		if (retval == ERROR_OK)
+			return ERROR_FLASH_BUSY;
+	}
+
+err_lock:
+	retval2 = stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_CR_INDEX, FLASH_LOCK);
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	return retval2;
+}
+
 static int stm32l4_protect(struct flash_bank *bank, int set, unsigned int first, unsigned int last)
 {
 	struct target *target = bank->target;
@@ -1143,6 +1241,46 @@ static int stm32l4_protect(struct flash_bank *bank, int set, unsigned int first,
 	return stm32l4_write_all_wrpxy(bank, wrpxy, n_wrp);
 }
 
+/* Report the errors a failed flash write algorithm left in the status */
+static int stm32l4_write_block_error(struct flash_bank *bank, uint32_t status)
+{
+	LOG_ERROR("error executing stm32l4 flash write algorithm");
+
+	uint32_t error = status & FLASH_ERROR;
+
+	if (error & FLASH_WRPERR)
+		LOG_ERROR("flash memory write protected");
+
+	if (error != 0) {
+		LOG_ERROR("flash write failed = %08" PRIx32, error);
+		/* Clear but report errors */
+		stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX, error);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_FLASH_OPERATION_FAILED;
+}
+
+static int stm32l4_write_block_lz4(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	uint32_t status;
+
+	static const uint8_t stm32l4_flash_write_lz4_code[] = {
+#include "../../../contrib/loaders/flash/stm32/stm32l4x_lz4.inc"
+	};
+
+	int retval = lz4_write_block(bank, stm32l4_flash_write_lz4_code,
+			sizeof(stm32l4_flash_write_lz4_code), buffer, count * 8, bank->base + offset,
+			stm32l4_get_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX),
+			stm32l4_get_flash_reg_by_index(bank, STM32_FLASH_CR_INDEX), &status);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		retval = stm32l4_write_block_error(bank, status);
+
+	return retval;
+}
+
 /* Count is in double-words */
 static int stm32l4_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t offset, uint32_t count)
@@ -1160,6 +1298,12 @@ static int stm32l4_write_block(struct flash_bank *bank, const uint8_t *buffer,
 #include "../../../contrib/loaders/flash/stm32/stm32l4x.inc"
 	};
 
+	if (lz4_write_enabled()) {
+		retval = stm32l4_write_block_lz4(bank, buffer, offset, count);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+	}
+
 	if (target_alloc_working_area(target, sizeof(stm32l4_flash_write_code),
 			&write_algorithm) != ERROR_OK) {
 		LOG_WARNING("no working area available, can't do block memory writes");
@@ -1213,21 +1357,8 @@ static int stm32l4_write_block(struct flash_bank *bank, const uint8_t *buffer,
 			write_algorithm->address, 0,
 			&armv7m_info);
 
-	if (retval == ERROR_FLASH_OPERATION_FAILED) {
-		LOG_ERROR("error executing stm32l4 flash write algorithm");
-
-		uint32_t error = buf_get_u32(reg_params[0].value, 0, 32) & FLASH_ERROR;
-
-		if (error & FLASH_WRPERR)
-			LOG_ERROR("flash memory write protected");
-
-		if (error != 0) {
-			LOG_ERROR("flash write failed = %08" PRIx32, error);
-			/* Clear but report errors */
-			stm32l4_write_flash_reg_by_index(bank, STM32_FLASH_SR_INDEX, error);
-			retval = ERROR_FAIL;
-		}
-	}
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		retval = stm32l4_write_block_error(bank, buf_get_u32(reg_params[0].value, 0, 32));
 
 	target_free_working_area(target, source);
 	target_free_working_area(target, write_algorithm);
@@ -2059,6 +2190,8 @@ const struct flash_driver stm32l4x_flash = {
 	.commands = stm32l4_command_handlers,
 	.flash_bank_command = stm32l4_flash_bank_command,
 	.erase = stm32l4_erase,
+	.erase_start = stm32l4_erase_start,
+	.erase_poll = stm32l4_erase_poll,
 	.protect = stm32l4_protect,
 	.write = stm32l4_write,
 	.read = default_flash_read,
@@ -181,6 +181,9 @@ struct stmqspi_flash_bank {
 	uint32_t saved_ir;	/* only for OCTOSPI */
 	unsigned int sfdp_dummy1;	/* number of dummy bytes for SFDP read for flash1 and octo */
 	unsigned int sfdp_dummy2;	/* number of dummy bytes for SFDP read for flash2 */
+	unsigned int erase_sector;	/* sector being erased by erase_start/erase_poll */
+	unsigned int erase_last;	/* last sector to erase by erase_start/erase_poll */
+	int64_t erase_t0;			/* start of current sector erase */
 };
 
 static inline int octospi_cmd(struct flash_bank *bank, uint32_t mode,
@@ -939,7 +942,8 @@ err:
 	return retval;
 }
 
-static int qspi_erase_sector(struct flash_bank *bank, unsigned int sector)
+/* Send sector erase command, without waiting for the erase to complete */
+static int qspi_erase_sector_start(struct flash_bank *bank, unsigned int sector)
 {
 	struct target *target = bank->target;
 	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
@@ -1003,21 +1007,26 @@ static int qspi_erase_sector(struct flash_bank *bank, unsigned int sector)
 	/* Erase takes a long time, so some sort of progress message is a good idea */
 	LOG_DEBUG("erasing sector %4u", sector);
 
-	/* Poll WIP for end of self timed Sector Erase cycle */
-	retval = wait_till_ready(bank, SPI_MAX_TIMEOUT);
-
 err:
 	return retval;
 }
 
-static int stmqspi_erase(struct flash_bank *bank, unsigned int first, unsigned int last)
+static int qspi_erase_sector(struct flash_bank *bank, unsigned int sector)
+{
+	int retval = qspi_erase_sector_start(bank, sector);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Poll WIP for end of self timed Sector Erase cycle */
+	return wait_till_ready(bank, SPI_MAX_TIMEOUT);
+}
+
+static int stmqspi_erase_check_args(struct flash_bank *bank, unsigned int first,
+	unsigned int last)
 {
 	struct target *target = bank->target;
 	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
 	unsigned int sector;
-	int retval = ERROR_OK;
-
-	LOG_DEBUG("%s: from sector %u to sector %u", __func__, first, last);
 
 	if (target->state != TARGET_HALTED) {
 		LOG_ERROR("Target not halted");
@@ -1046,6 +1055,20 @@ static int stmqspi_erase(struct flash_bank *bank, unsigned int first, unsigned i
 		}
 	}
 
+	return ERROR_OK;
+}
+
+static int stmqspi_erase(struct flash_bank *bank, unsigned int first, unsigned int last)
+{
+	unsigned int sector;
+	int retval;
+
+	LOG_DEBUG("%s: from sector %u to sector %u", __func__, first, last);
+
+	retval = stmqspi_erase_check_args(bank, first, last);
+	if (retval != ERROR_OK)
+		return retval;
+
 	for (sector = first; sector <= last; sector++) {
 		retval = qspi_erase_sector(bank, sector);
 		if (retval != ERROR_OK)
@@ -1063,6 +1086,70 @@ static int stmqspi_erase(struct flash_bank *bank, unsigned int first, unsigned i
 	return retval;
 }
 
+/* Erase in the background: the QSPI/OCTOSPI peripheral and the flash are
+ * independent of the target's other flash, which may be written meanwhile */
+static int stmqspi_erase_start(struct flash_bank *bank, unsigned int first,
+	unsigned int last)
+{
+	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
+	int retval;
+
+	LOG_DEBUG("%s: from sector %u to sector %u", __func__, first, last);
+
+	retval = stmqspi_erase_check_args(bank, first, last);
+	if (retval != ERROR_OK)
+		return retval;
+
+	stmqspi_info->erase_sector = first;
+	stmqspi_info->erase_last = last;
+	stmqspi_info->erase_t0 = timeval_ms();
+
+	retval = qspi_erase_sector_start(bank, first);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Flash sector_erase failed on sector %u", first);
+		set_mm_mode(bank);
+	}
+
+	return retval;
+}
+
+static int stmqspi_erase_poll(struct flash_bank *bank)
+{
+	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
+	uint16_t status;
+	int retval;
+
+	retval = read_status_reg(bank, &status);
+	if (retval != ERROR_OK)
+		goto err;
+
+	if (status & ((SPIFLASH_BSY_BIT << 8) | SPIFLASH_BSY_BIT)) {
+		if (timeval_ms() - stmqspi_info->erase_t0 <= SPI_MAX_TIMEOUT)
+			return ERROR_FLASH_BUSY;
+
+		LOG_ERROR("timeout");
+		retval = ERROR_FLASH_OPERATION_FAILED;
+		goto err;
+	}
+
+	if (stmqspi_info->erase_sector < stmqspi_info->erase_last) {
+		stmqspi_info->erase_sector++;
+		stmqspi_info->erase_t0 = timeval_ms();
+		retval = qspi_erase_sector_start(bank, stmqspi_info->erase_sector);
+		if (retval == ERROR_OK)
+			return ERROR_FLASH_BUSY;
+	}
+
+err:
+	if (retval != ERROR_OK)
+		LOG_ERROR("Flash sector_erase failed on sector %u", stmqspi_info->erase_sector);
+
+	/* Switch to memory mapped mode before return to prompt */
+	set_mm_mode(bank);
+
+	return retval;
+}
+
 static int stmqspi_protect(struct flash_bank *bank, int set,
 	unsigned int first, unsigned int last)
 {
@@ -2470,6 +2557,8 @@ struct flash_driver stmqspi_flash = {
 	.commands = stmqspi_command_handlers,
 	.flash_bank_command = stmqspi_flash_bank_command,
 	.erase = stmqspi_erase,
+	.erase_start = stmqspi_erase_start,
+	.erase_poll = stmqspi_erase_poll,
 	.protect = stmqspi_protect,
 	.write = stmqspi_write,
 	.read = stmqspi_read,
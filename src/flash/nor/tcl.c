@@ -22,6 +22,7 @@
 #include "config.h"
 #endif
 #include "imp.h"
+#include "lz4_write.h"
 #include <helper/time_support.h>
 #include <target/image.h>
 
@@ -412,6 +413,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	/* flash auto-erase is disabled by default*/
 	int auto_erase = 0;
 	bool auto_unlock = false;
+	bool compress = false;
 
 	while (CMD_ARGC) {
 		if (strcmp(CMD_ARGV[0], "erase") == 0) {
@@ -424,6 +426,11 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "compress") == 0) {
+			compress = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+			command_print(CMD, "compressed download enabled");
 		} else
 			break;
 	}
@@ -453,8 +460,10 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	if (retval != ERROR_OK)
 		return retval;
 
+	lz4_write_enable(compress);
 	retval = flash_write_unlock_verify(target, &image, &written, auto_erase,
 		auto_unlock, true, false);
+	lz4_write_enable(false);
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -466,6 +475,16 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			duration_elapsed(&bench), duration_kbps(&bench, written));
 	}
 
+	if (compress) {
+		uint64_t raw_bytes, sent_bytes;
+		lz4_write_stats(&raw_bytes, &sent_bytes);
+		if (raw_bytes)
+			command_print(CMD, "compressed %" PRIu64 " of them to %" PRIu64 " bytes (%0.1f%%)",
+				raw_bytes, sent_bytes, 100.0 * sent_bytes / raw_bytes);
+		else
+			command_print(CMD, "no flash driver used compressed download");
+	}
+
 	image_close(&image);
 
 	return retval;
@@ -1192,10 +1211,11 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] [compress] filename [offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
 			"and/or erase the region to be used. Allow optional "
-			"offset from beginning of bank (defaults to zero)",
+			"offset from beginning of bank (defaults to zero). "
+			"Optionally compress the data sent to the target",
 	},
 	{
 		.name = "verify_image",
@@ -31,12 +31,17 @@
 #include "fileio.h"
 #include "replacements.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 struct fileio {
 	char *url;
 	size_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	void *mapping;		/* see fileio_map() */
 };
 
 static inline int fileio_close_local(struct fileio *fileio)
@@ -128,6 +133,7 @@ int fileio_open(struct fileio **fileio, const char *url,
 	tmp->type = type;
 	tmp->access = access_type;
 	tmp->url = strdup(url);
+	tmp->mapping = NULL;
 
 	retval = fileio_open_local(tmp);
 
@@ -146,6 +152,11 @@ int fileio_close(struct fileio *fileio)
 {
 	int retval;
 
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->mapping)
+		munmap(fileio->mapping, fileio->size);
+#endif
+
 	retval = fileio_close_local(fileio);
 
 	free(fileio->url);
@@ -273,3 +284,25 @@ int fileio_size(struct fileio *fileio, size_t *size)
 
 	return ERROR_OK;
 }
+
+const uint8_t *fileio_map(struct fileio *fileio)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->mapping)
+		return fileio->mapping;
+
+	if (fileio->access != FILEIO_READ || fileio->type != FILEIO_BINARY || fileio->size == 0)
+		return NULL;
+
+	void *mapping = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE, fileno(fileio->file), 0);
+	if (mapping == MAP_FAILED) {
+		LOG_DEBUG("couldn't map %s: %s", fileio->url, strerror(errno));
+		return NULL;
+	}
+
+	fileio->mapping = mapping;
+	return mapping;
+#else
+	return NULL;
+#endif
+}
@@ -62,6 +62,14 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data);
 int fileio_write_u32(struct fileio *fileio, uint32_t data);
 int fileio_size(struct fileio *fileio, size_t *size);
 
+/**
+ * Map a binary file opened for reading into memory. The mapping is read-only
+ * and stays valid until the file is closed.
+ * @returns the file contents, or NULL where files can't be mapped; the file
+ * is then read with fileio_read() as usual.
+ */
+const uint8_t *fileio_map(struct fileio *fileio);
+
 #define ERROR_FILEIO_LOCATION_UNKNOWN			(-1200)
 #define ERROR_FILEIO_NOT_FOUND					(-1201)
 #define ERROR_FILEIO_OPERATION_FAILED			(-1202)
@@ -32,6 +32,7 @@
 #include "time_support.h"
 
 #include <stdarg.h>
+#include <signal.h>
 
 #ifdef _DEBUG_FREE_SPACE_
 #ifdef HAVE_MALLOC_H
@@ -49,7 +50,36 @@ static struct log_callback *log_callbacks;
 static int64_t last_time;
 static int64_t current_time;
 
-static int64_t start;
+static int64_t start_us;
+
+/* Debug messages are formatted straight into this buffer, their headers are
+ * formatted and everything is written out in one block when it fills up,
+ * when a more important message is logged, when the server loop goes idle
+ * and at exit. Logging a debug message then costs a vsnprintf() instead of
+ * an allocation, a fprintf() and a fflush() per line.
+ */
+#define LOG_BUFFER_SIZE		(256 * 1024)
+/* Don't keep debug messages for longer than this in the buffer */
+#define LOG_BUFFER_MAX_AGE_US	(100 * 1000)
+
+struct log_record {
+	enum log_levels level;
+	int count;
+	int64_t time_us;
+	/* string literals from the LOG_* macros */
+	const char *file;
+	const char *function;
+	unsigned line;
+	unsigned len;
+	char string[];
+};
+
+/* records are 8 byte aligned */
+#define LOG_RECORD_SIZE(len)	((sizeof(struct log_record) + (len) + 1 + 7) & ~(size_t)7)
+
+static uint64_t log_buffer_words[LOG_BUFFER_SIZE / sizeof(uint64_t)];
+static char * const log_buffer = (char *)log_buffer_words;
+static size_t log_buffer_used;
 
 static const char * const log_strings[6] = {
 	"User : ",
@@ -62,6 +92,130 @@ static const char * const log_strings[6] = {
 
 static int count;
 
+static int64_t log_time_us(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static const char *log_basename(const char *file)
+{
+	const char *f = strrchr(file, '/');
+	return f ? f + 1 : file;
+}
+
+static void log_write_header(enum log_levels level, int cnt, int64_t t_us,
+		const char *file, unsigned line, const char *function)
+{
+#ifdef _DEBUG_FREE_SPACE_
+	struct mallinfo info;
+	info = mallinfo();
+#endif
+	fprintf(log_output, "%s%d %" PRId64 ".%03d %s:%u %s()"
+#ifdef _DEBUG_FREE_SPACE_
+		" %d"
+#endif
+		": ", log_strings[level + 1], cnt, t_us / 1000, (int)(t_us % 1000),
+		log_basename(file), line, function
+#ifdef _DEBUG_FREE_SPACE_
+		, info.fordblks
+#endif
+		);
+}
+
+void log_flush(void)
+{
+	size_t offset = 0;
+
+	while (offset < log_buffer_used) {
+		struct log_record *rec = (struct log_record *)(log_buffer + offset);
+
+		log_write_header(rec->level, rec->count, rec->time_us, rec->file,
+				rec->line, rec->function);
+		fwrite(rec->string, 1, rec->len, log_output);
+
+		offset += LOG_RECORD_SIZE(rec->len);
+	}
+
+	if (log_buffer_used) {
+		log_buffer_used = 0;
+		fflush(log_output);
+	}
+}
+
+static void log_flush_aged_at(int64_t t_us)
+{
+	if (log_buffer_used) {
+		struct log_record *first = (struct log_record *)log_buffer;
+		if (t_us - first->time_us > LOG_BUFFER_MAX_AGE_US)
+			log_flush();
+	}
+}
+
+void log_flush_aged(void)
+{
+	if (log_buffer_used)
+		log_flush_aged_at(log_time_us() - start_us);
+}
+
+/* Write out what the crashing process logged last. The buffer may be
+ * inconsistent if the fault hit while logging, the handler is reset
+ * first so that a second fault still ends the process. */
+static void log_fatal_signal(int sig)
+{
+	signal(sig, SIG_DFL);
+	log_flush();
+	raise(sig);
+}
+
+/* Append a debug message to the log buffer, returns false if it was not
+ * logged and must be written out directly */
+static bool log_buffer_vprintf(enum log_levels level, const char *file,
+		unsigned line, const char *function, bool lf,
+		const char *format, va_list args)
+{
+	int64_t t_us = log_time_us() - start_us;
+
+	log_flush_aged_at(t_us);
+
+	for (int i = 0; i < 2; i++) {
+		struct log_record *rec = (struct log_record *)(log_buffer + log_buffer_used);
+		size_t space = LOG_BUFFER_SIZE - log_buffer_used;
+
+		if (space > sizeof(*rec) + 2) {
+			/* keep room for the line feed */
+			size_t room = space - sizeof(*rec) - 1;
+			va_list ap;
+			va_copy(ap, args);
+			int len = vsnprintf(rec->string, room, format, ap);
+			va_end(ap);
+
+			if (len >= 0 && (size_t)len < room) {
+				if (lf)
+					rec->string[len++] = '\n';
+				rec->string[len] = '\0';
+				rec->level = level;
+				rec->count = count;
+				rec->time_us = t_us;
+				rec->file = file;
+				rec->function = function;
+				rec->line = line;
+				rec->len = len;
+				log_buffer_used += LOG_RECORD_SIZE(len);
+				return true;
+			}
+		}
+
+		/* too long for the space left, retry with an empty buffer */
+		if (!log_buffer_used)
+			break;
+		log_flush();
+	}
+
+	return false;
+}
+
 /* forward the log to the listeners */
 static void log_forward(const char *file, unsigned line, const char *function, const char *string)
 {
@@ -91,8 +245,6 @@ static void log_puts(enum log_levels level,
 	const char *function,
 	const char *string)
 {
-	char *f;
-
 	if (!log_output) {
 		/* log_init() not called yet; print on stderr */
 		fputs(string, stderr);
@@ -100,6 +252,9 @@ static void log_puts(enum log_levels level,
 		return;
 	}
 
+	/* keep the order of buffered debug messages */
+	log_flush();
+
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
 		fputs(string, log_output);
@@ -107,27 +262,13 @@ static void log_puts(enum log_levels level,
 		return;
 	}
 
-	f = strrchr(file, '/');
-	if (f != NULL)
-		file = f + 1;
+	file = log_basename(file);
 
 	if (strlen(string) > 0) {
 		if (debug_level >= LOG_LVL_DEBUG) {
 			/* print with count and time information */
-			int64_t t = timeval_ms() - start;
-#ifdef _DEBUG_FREE_SPACE_
-			struct mallinfo info;
-			info = mallinfo();
-#endif
-			fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
-#ifdef _DEBUG_FREE_SPACE_
-				" %d"
-#endif
-				": %s", log_strings[level + 1], count, t, file, line, function,
-#ifdef _DEBUG_FREE_SPACE_
-				info.fordblks,
-#endif
-				string);
+			log_write_header(level, count, log_time_us() - start_us, file, line, function);
+			fputs(string, log_output);
 		} else {
 			/* if we are using gdb through pipes then we do not want any output
 			 * to the pipe otherwise we get repeated strings */
@@ -162,6 +303,12 @@ void log_printf(enum log_levels level,
 
 	va_start(ap, format);
 
+	if (level >= LOG_LVL_DEBUG && log_output &&
+			log_buffer_vprintf(level, file, line, function, false, format, ap)) {
+		va_end(ap);
+		return;
+	}
+
 	string = alloc_vprintf(format, ap);
 	if (string != NULL) {
 		log_puts(level, file, line, function, string);
@@ -181,6 +328,10 @@ void log_vprintf_lf(enum log_levels level, const char *file, unsigned line,
 	if (level > debug_level)
 		return;
 
+	if (level >= LOG_LVL_DEBUG && log_output &&
+			log_buffer_vprintf(level, file, line, function, true, format, args))
+		return;
+
 	tmp = alloc_vprintf(format, args);
 
 	if (!tmp)
@@ -229,6 +380,9 @@ COMMAND_HANDLER(handle_debug_level_command)
 
 COMMAND_HANDLER(handle_log_output_command)
 {
+	if (log_output)
+		log_flush();
+
 	if (CMD_ARGC == 0 || (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "default") == 0)) {
 		if (log_output != stderr && log_output != NULL) {
 			/* Close previous log file, if it was open and wasn't stderr. */
@@ -299,11 +453,23 @@ void log_init(void)
 	if (log_output == NULL)
 		log_output = stderr;
 
-	start = last_time = timeval_ms();
+	last_time = timeval_ms();
+	start_us = log_time_us();
+
+	/* keep the tail of the log on exit and on a crash */
+	atexit(log_flush);
+	signal(SIGSEGV, log_fatal_signal);
+	signal(SIGILL, log_fatal_signal);
+	signal(SIGFPE, log_fatal_signal);
+#ifdef SIGBUS
+	signal(SIGBUS, log_fatal_signal);
+#endif
 }
 
 int set_log_output(struct command_context *cmd_ctx, FILE *output)
 {
+	if (log_output)
+		log_flush();
 	log_output = output;
 	return ERROR_OK;
 }
@@ -431,6 +597,9 @@ static void gdb_timeout_warning(int64_t delta_time)
 
 void keep_alive(void)
 {
+	/* long operations don't reach the server loop, don't hold the log */
+	log_flush_aged();
+
 	current_time = timeval_ms();
 
 	int64_t delta_time = current_time - last_time;
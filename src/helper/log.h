@@ -73,6 +73,16 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 5, 6)));
  */
 void log_init(void);
 int set_log_output(struct command_context *cmd_ctx, FILE *output);
+/**
+ * Write out the buffered debug messages. Called when the server loop goes
+ * idle, before other messages are logged and at exit.
+ */
+void log_flush(void);
+/**
+ * Write out the buffered debug messages if they are older than 100 ms.
+ * Called from the server loop and while long operations keep alive.
+ */
+void log_flush_aged(void);
 
 int log_register_commands(struct command_context *cmd_ctx);
 
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * Minimal greedy compressor for the LZ4 block format, used to shrink data
+ * before it is sent to a decompressing loader on the target. Compression
+ * ratio is traded for simplicity; decoders only have to follow the format.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz4.h"
+#include "log.h"
+
+#define LZ4_HASH_BITS		12
+#define LZ4_MIN_MATCH		4
+/* The format requires the last match to start at least 12 bytes before the
+ * end of the block and the last 5 bytes to be literals */
+#define LZ4_MFLIMIT			12
+#define LZ4_LASTLITERALS	5
+
+static uint32_t lz4_read32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static unsigned int lz4_hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+static int lz4_put_length(uint8_t **op, const uint8_t *oend, size_t length)
+{
+	for (; length >= 255; length -= 255) {
+		if (*op >= oend)
+			return ERROR_FAIL;
+		*(*op)++ = 255;
+	}
+	if (*op >= oend)
+		return ERROR_FAIL;
+	*(*op)++ = length;
+	return ERROR_OK;
+}
+
+/* Emit one sequence; a zero match_length marks the final literal run */
+static int lz4_put_sequence(uint8_t **op, const uint8_t *oend,
+		const uint8_t *literals, size_t literal_length,
+		size_t offset, size_t match_length)
+{
+	uint8_t *token = *op;
+
+	if (*op >= oend)
+		return ERROR_FAIL;
+	(*op)++;
+
+	*token = (literal_length < 15 ? literal_length : 15) << 4;
+	if (literal_length >= 15 && lz4_put_length(op, oend, literal_length - 15) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if ((size_t)(oend - *op) < literal_length)
+		return ERROR_FAIL;
+	memcpy(*op, literals, literal_length);
+	*op += literal_length;
+
+	if (match_length == 0)
+		return ERROR_OK;
+
+	if (oend - *op < 2)
+		return ERROR_FAIL;
+	*(*op)++ = offset & 0xff;
+	*(*op)++ = offset >> 8;
+
+	match_length -= LZ4_MIN_MATCH;
+	*token |= match_length < 15 ? match_length : 15;
+	if (match_length >= 15)
+		return lz4_put_length(op, oend, match_length - 15);
+
+	return ERROR_OK;
+}
+
+int lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity,
+		size_t window, size_t *out_size)
+{
+	const uint8_t *oend = dst + capacity;
+	uint8_t *op = dst;
+	size_t anchor = 0;
+	size_t i = 0;
+	int retval;
+
+	if (window > LZ4_MAX_OFFSET)
+		window = LZ4_MAX_OFFSET;
+
+	/* Positions are stored off by one, zero means empty */
+	size_t *table = calloc(1 << LZ4_HASH_BITS, sizeof(*table));
+	if (!table) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	if (size > LZ4_MFLIMIT) {
+		size_t match_limit = size - LZ4_LASTLITERALS;
+
+		while (i < size - LZ4_MFLIMIT) {
+			uint32_t sequence = lz4_read32(src + i);
+			unsigned int h = lz4_hash(sequence);
+			size_t candidate = table[h];
+			table[h] = i + 1;
+
+			if (!candidate || i - (candidate - 1) > window
+					|| lz4_read32(src + candidate - 1) != sequence) {
+				i++;
+				continue;
+			}
+			candidate--;
+
+			size_t length = LZ4_MIN_MATCH;
+			while (i + length < match_limit && src[candidate + length] == src[i + length])
+				length++;
+
+			retval = lz4_put_sequence(&op, oend, src + anchor, i - anchor,
+					i - candidate, length);
+			if (retval != ERROR_OK)
+				goto out;
+
+			i += length;
+			anchor = i;
+		}
+	}
+
+	retval = lz4_put_sequence(&op, oend, src + anchor, size - anchor, 0, 0);
+	if (retval == ERROR_OK)
+		*out_size = op - dst;
+
+out:
+	free(table);
+	return retval;
+}
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_LZ4_H
+#define OPENOCD_HELPER_LZ4_H
+
+#include "types.h"
+
+/** Worst case size of an LZ4 block holding @a n bytes of incompressible data */
+#define LZ4_COMPRESS_BOUND(n)	((n) + (n) / 255 + 16)
+
+/** Largest back-reference distance the LZ4 block format can encode */
+#define LZ4_MAX_OFFSET			65535
+
+/**
+ * Compress @a size bytes of @a src into a raw LZ4 block (no frame header).
+ *
+ * Back-references never reach further than @a window bytes, so a decoder can
+ * work with a ring buffer of that size instead of the whole output.
+ *
+ * @param src data to compress
+ * @param size number of bytes in @a src
+ * @param dst output buffer
+ * @param capacity size of @a dst, LZ4_COMPRESS_BOUND(size) is always enough
+ * @param window maximum match offset, at most LZ4_MAX_OFFSET
+ * @param out_size receives the size of the compressed block
+ * @returns ERROR_OK on success, ERROR_FAIL if @a dst is too small
+ */
+int lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity,
+		size_t window, size_t *out_size);
+
+#endif /* OPENOCD_HELPER_LZ4_H */
@@ -52,10 +52,14 @@ static volatile uint32_t *pio_base;
 
 static bb_value_t bcm2835gpio_read(void);
 static int bcm2835gpio_write(int tck, int tms, int tdi);
+static int bcm2835gpio_write_vector(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		unsigned int num_bits);
 
 static int bcm2835_swdio_read(void);
 static void bcm2835_swdio_drive(bool is_output);
 static int bcm2835gpio_swd_write(int swclk, int swdio);
+static int bcm2835gpio_swd_write_vector(const uint8_t *swdio_out, const uint8_t *swdio_dir,
+		uint8_t *swdio_in, unsigned int num_bits);
 
 static int bcm2835gpio_init(void);
 static int bcm2835gpio_quit(void);
@@ -63,9 +67,11 @@ static int bcm2835gpio_quit(void);
 static struct bitbang_interface bcm2835gpio_bitbang = {
 	.read = bcm2835gpio_read,
 	.write = bcm2835gpio_write,
+	.write_vector = bcm2835gpio_write_vector,
 	.swdio_read = bcm2835_swdio_read,
 	.swdio_drive = bcm2835_swdio_drive,
 	.swd_write = bcm2835gpio_swd_write,
+	.swd_write_vector = bcm2835gpio_swd_write_vector,
 	.blink = NULL
 };
 
@@ -92,6 +98,12 @@ static int speed_coeff = 113714;
 static int speed_offset = 28;
 static unsigned int jtag_delay;
 
+static inline void bcm2835_delay(void)
+{
+	for (unsigned int i = 0; i < jtag_delay; i++)
+		asm volatile ("");
+}
+
 static bb_value_t bcm2835gpio_read(void)
 {
 	return (GPIO_LEV & 1<<tdo_gpio) ? BB_HIGH : BB_LOW;
@@ -105,8 +117,54 @@ static int bcm2835gpio_write(int tck, int tms, int tdi)
 	GPIO_SET = set;
 	GPIO_CLR = clear;
 
-	for (unsigned int i = 0; i < jtag_delay; i++)
-		asm volatile ("");
+	bcm2835_delay();
+
+	return ERROR_OK;
+}
+
+/* Clock a whole bit vector with direct register accesses, without going
+ * through the per-edge bitbang callbacks. */
+static int bcm2835gpio_write_vector(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		unsigned int num_bits)
+{
+	uint32_t tck_mask = 1 << tck_gpio;
+	uint32_t tms_mask = 1 << tms_gpio;
+	uint32_t tdi_mask = 1 << tdi_gpio;
+	uint32_t tdo_mask = 1 << tdo_gpio;
+
+	for (unsigned int i = 0; i < num_bits; i++) {
+		unsigned int bytec = i / 8;
+		uint8_t bcval = 1 << (i % 8);
+		uint32_t set = 0;
+		uint32_t clear = tck_mask;
+
+		if (tms && (tms[bytec] & bcval))
+			set |= tms_mask;
+		else
+			clear |= tms_mask;
+
+		if (tdi && (tdi[bytec] & bcval))
+			set |= tdi_mask;
+		else
+			clear |= tdi_mask;
+
+		GPIO_SET = set;
+		GPIO_CLR = clear;
+		bcm2835_delay();
+
+		if (tdo) {
+			if (GPIO_LEV & tdo_mask)
+				tdo[bytec] |= bcval;
+			else
+				tdo[bytec] &= ~bcval;
+		}
+
+		GPIO_SET = tck_mask;
+		bcm2835_delay();
+	}
+
+	GPIO_CLR = tck_mask;
+	bcm2835_delay();
 
 	return ERROR_OK;
 }
@@ -119,8 +177,50 @@ static int bcm2835gpio_swd_write(int swclk, int swdio)
 	GPIO_SET = set;
 	GPIO_CLR = clear;
 
-	for (unsigned int i = 0; i < jtag_delay; i++)
-		asm volatile ("");
+	bcm2835_delay();
+
+	return ERROR_OK;
+}
+
+/* Replay a packed SWD bit stream with direct register accesses */
+static int bcm2835gpio_swd_write_vector(const uint8_t *swdio_out, const uint8_t *swdio_dir,
+		uint8_t *swdio_in, unsigned int num_bits)
+{
+	uint32_t swclk_mask = 1 << swclk_gpio;
+	uint32_t swdio_mask = 1 << swdio_gpio;
+	bool drive = true;
+
+	for (unsigned int i = 0; i < num_bits; i++) {
+		unsigned int bytec = i / 8;
+		uint8_t bcval = 1 << (i % 8);
+		bool bit_drive = swdio_dir[bytec] & bcval;
+
+		if (bit_drive != drive) {
+			bcm2835_swdio_drive(bit_drive);
+			drive = bit_drive;
+		}
+
+		if (bit_drive && (swdio_out[bytec] & bcval)) {
+			GPIO_SET = swdio_mask;
+			GPIO_CLR = swclk_mask;
+		} else {
+			GPIO_CLR = swclk_mask | swdio_mask;
+		}
+		bcm2835_delay();
+
+		if (!bit_drive) {
+			if (GPIO_LEV & swdio_mask)
+				swdio_in[bytec] |= bcval;
+			else
+				swdio_in[bytec] &= ~bcval;
+		}
+
+		GPIO_SET = swclk_mask;
+		bcm2835_delay();
+	}
+
+	if (!drive)
+		bcm2835_swdio_drive(true);
 
 	return ERROR_OK;
 }
@@ -402,6 +502,9 @@ static const struct command_registration bcm2835gpio_command_handlers[] = {
 		.help = "peripheral base to access GPIOs (RPi1 0x20000000, RPi2 0x3F000000).",
 		.usage = "[base]",
 	},
+	{
+		.chain = bitbang_command_handlers,
+	},
 
 	COMMAND_REGISTRATION_DONE
 };
@@ -40,10 +40,11 @@
  */
 static int bitbang_stableclocks(int num_cycles);
 
-static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk);
-
 struct bitbang_interface *bitbang_interface;
 
+/* Use the driver's vector callbacks, if it has them, see "bitbang_vector" */
+static bool bitbang_vector = true;
+
 /* DANGER!!!! clock absolutely *MUST* be 0 in idle or reset won't work!
  *
  * Set this to 1 and str912 reset halt will fail.
@@ -77,6 +78,14 @@ static int bitbang_state_move(int skip)
 	uint8_t tms_scan = tap_get_tms_path(tap_get_state(), tap_get_end_state());
 	int tms_count = tap_get_tms_path_len(tap_get_state(), tap_get_end_state());
 
+	if (bitbang_vector && bitbang_interface->write_vector && tms_count > skip) {
+		uint8_t tms_bits = tms_scan >> skip;
+		if (bitbang_interface->write_vector(&tms_bits, NULL, NULL, tms_count - skip) != ERROR_OK)
+			return ERROR_FAIL;
+		tap_set_state(tap_get_end_state());
+		return ERROR_OK;
+	}
+
 	for (i = skip; i < tms_count; i++) {
 		tms = (tms_scan >> i) & 1;
 		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
@@ -102,6 +111,9 @@ static int bitbang_execute_tms(struct jtag_command *cmd)
 
 	LOG_DEBUG_IO("TMS: %d bits", num_bits);
 
+	if (bitbang_vector && bitbang_interface->write_vector && num_bits)
+		return bitbang_interface->write_vector(bits, NULL, NULL, num_bits);
+
 	int tms = 0;
 	for (unsigned i = 0; i < num_bits; i++) {
 		tms = ((bits[i/8] >> (i % 8)) & 1);
@@ -166,14 +178,19 @@ static int bitbang_runtest(int num_cycles)
 	}
 
 	/* execute num_cycles */
-	for (i = 0; i < num_cycles; i++) {
-		if (bitbang_interface->write(0, 0, 0) != ERROR_OK)
+	if (bitbang_vector && bitbang_interface->write_vector && num_cycles > 0) {
+		if (bitbang_interface->write_vector(NULL, NULL, NULL, num_cycles) != ERROR_OK)
 			return ERROR_FAIL;
-		if (bitbang_interface->write(1, 0, 0) != ERROR_OK)
+	} else {
+		for (i = 0; i < num_cycles; i++) {
+			if (bitbang_interface->write(0, 0, 0) != ERROR_OK)
+				return ERROR_FAIL;
+			if (bitbang_interface->write(1, 0, 0) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+		if (bitbang_interface->write(CLOCK_IDLE(), 0, 0) != ERROR_OK)
 			return ERROR_FAIL;
 	}
-	if (bitbang_interface->write(CLOCK_IDLE(), 0, 0) != ERROR_OK)
-		return ERROR_FAIL;
 
 	/* finish in end_state */
 	bitbang_end_state(saved_end_state);
@@ -200,26 +217,12 @@ static int bitbang_stableclocks(int num_cycles)
 	return ERROR_OK;
 }
 
-static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
-		unsigned scan_size)
+/* Shift scan_size bits through the per-bit write() and read() callbacks. */
+static int bitbang_scan_bits(enum scan_type type, uint8_t *buffer, unsigned int scan_size)
 {
-	tap_state_t saved_end_state = tap_get_end_state();
 	unsigned bit_cnt;
-
-	if (!((!ir_scan &&
-			(tap_get_state() == TAP_DRSHIFT)) ||
-			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
-		if (ir_scan)
-			bitbang_end_state(TAP_IRSHIFT);
-		else
-			bitbang_end_state(TAP_DRSHIFT);
-
-		if (bitbang_state_move(0) != ERROR_OK)
-			return ERROR_FAIL;
-		bitbang_end_state(saved_end_state);
-	}
-
 	size_t buffered = 0;
+
 	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
 		int tdi;
@@ -278,6 +281,48 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		}
 	}
 
+	return ERROR_OK;
+}
+
+static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+		unsigned scan_size)
+{
+	tap_state_t saved_end_state = tap_get_end_state();
+
+	if (!((!ir_scan &&
+			(tap_get_state() == TAP_DRSHIFT)) ||
+			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
+		if (ir_scan)
+			bitbang_end_state(TAP_IRSHIFT);
+		else
+			bitbang_end_state(TAP_DRSHIFT);
+
+		if (bitbang_state_move(0) != ERROR_OK)
+			return ERROR_FAIL;
+		bitbang_end_state(saved_end_state);
+	}
+
+	if (bitbang_vector && bitbang_interface->write_vector && scan_size) {
+		/* The TMS pattern of a scan is all zeros except for the last bit,
+		 * which leaves the shift state: hand the whole scan to the driver. */
+		uint8_t *tms = calloc(DIV_ROUND_UP(scan_size, 8), 1);
+		if (!tms) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		buf_set_u32(tms, scan_size - 1, 1, 1);
+
+		int retval = bitbang_interface->write_vector(tms,
+				type != SCAN_IN ? buffer : NULL,
+				type != SCAN_OUT ? buffer : NULL,
+				scan_size);
+		free(tms);
+		if (retval != ERROR_OK)
+			return ERROR_FAIL;
+	} else if (bitbang_scan_bits(type, buffer, scan_size) != ERROR_OK) {
+		return ERROR_FAIL;
+	}
+
 	if (tap_get_state() != tap_get_end_state()) {
 		/* we *KNOW* the above loop transitioned out of
 		 * the shift state, so we skip the first state
@@ -383,6 +428,24 @@ int bitbang_execute_queue(void)
 
 static int queued_retval;
 
+/* Maximum number of SWD transactions packed into one bit stream */
+#define BITBANG_SWD_QUEUE_SIZE 64
+
+/* Bits of a transaction: request, turnaround, ack, data, parity, turnaround */
+#define SWD_TRANSACTION_BITS (8 + 1 + 3 + 32 + 1 + 1)
+
+static struct bitbang_swd_cmd {
+	uint8_t cmd;
+	uint32_t *dst;
+	uint32_t data;
+	uint32_t ap_delay_clk;
+	/* Position of the acknowledge in the bit stream */
+	unsigned int ack_offset;
+} swd_cmd_queue[BITBANG_SWD_QUEUE_SIZE];
+static unsigned int swd_cmd_queue_length;
+
+static int bitbang_swd_run_queue(void);
+
 static int bitbang_swd_init(void)
 {
 	LOG_DEBUG("bitbang_swd_init");
@@ -421,10 +484,65 @@ static void bitbang_swd_exchange(bool rnw, uint8_t buf[], unsigned int offset, u
 	}
 }
 
+/**
+ * Clock a precomputed SWD bit stream. Bits set in @a dir are driven by the
+ * host from @a out, the other ones are sampled into @a in. The host drives
+ * SWDIO before and after the stream.
+ */
+static int bitbang_swd_exchange_stream(const uint8_t *out, const uint8_t *dir,
+		uint8_t *in, unsigned int num_bits)
+{
+	if (bitbang_vector && bitbang_interface->swd_write_vector)
+		return bitbang_interface->swd_write_vector(out, dir, in, num_bits);
+
+	if (bitbang_interface->blink) {
+		/* FIXME: we should manage errors */
+		bitbang_interface->blink(1);
+	}
+
+	bool drive = true;
+	for (unsigned int i = 0; i < num_bits; i++) {
+		int bytec = i / 8;
+		int bcval = 1 << (i % 8);
+		bool bit_drive = dir[bytec] & bcval;
+		int swdio = bit_drive && (out[bytec] & bcval);
+
+		if (bit_drive != drive) {
+			bitbang_interface->swdio_drive(bit_drive);
+			drive = bit_drive;
+		}
+
+		bitbang_interface->swd_write(0, swdio);
+
+		if (!bit_drive) {
+			if (bitbang_interface->swdio_read())
+				in[bytec] |= bcval;
+			else
+				in[bytec] &= ~bcval;
+		}
+
+		bitbang_interface->swd_write(1, swdio);
+	}
+
+	if (!drive)
+		bitbang_interface->swdio_drive(true);
+
+	if (bitbang_interface->blink) {
+		/* FIXME: we should manage errors */
+		bitbang_interface->blink(0);
+	}
+
+	return ERROR_OK;
+}
+
 static int bitbang_swd_switch_seq(enum swd_special_seq seq)
 {
 	LOG_DEBUG("bitbang_swd_switch_seq");
 
+	/* Keep the order of the transactions on the wire */
+	if (swd_cmd_queue_length)
+		queued_retval = bitbang_swd_run_queue();
+
 	switch (seq) {
 	case LINE_RESET:
 		LOG_DEBUG("SWD line reset");
@@ -446,19 +564,22 @@ static int bitbang_swd_switch_seq(enum swd_special_seq seq)
 	return ERROR_OK;
 }
 
+static void bitbang_swd_do_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk);
+
 static void swd_clear_sticky_errors(void)
 {
-	bitbang_swd_write_reg(swd_cmd(false,  false, DP_ABORT),
+	bitbang_swd_do_write_reg(swd_cmd(false,  false, DP_ABORT),
 		STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
 }
 
-static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+/* Execute a read transaction immediately, retrying on WAIT */
+static void bitbang_swd_do_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
 {
-	LOG_DEBUG("bitbang_swd_read_reg");
+	LOG_DEBUG("bitbang_swd_do_read_reg");
 	assert(cmd & SWD_CMD_RNW);
 
 	if (queued_retval != ERROR_OK) {
-		LOG_DEBUG("Skip bitbang_swd_read_reg because queued_retval=%d", queued_retval);
+		LOG_DEBUG("Skip bitbang_swd_do_read_reg because queued_retval=%d", queued_retval);
 		return;
 	}
 
@@ -511,13 +632,14 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 	}
 }
 
-static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+/* Execute a write transaction immediately, retrying on WAIT */
+static void bitbang_swd_do_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
 {
-	LOG_DEBUG("bitbang_swd_write_reg");
+	LOG_DEBUG("bitbang_swd_do_write_reg");
 	assert(!(cmd & SWD_CMD_RNW));
 
 	if (queued_retval != ERROR_OK) {
-		LOG_DEBUG("Skip bitbang_swd_write_reg because queued_retval=%d", queued_retval);
+		LOG_DEBUG("Skip bitbang_swd_do_write_reg because queued_retval=%d", queued_retval);
 		return;
 	}
 
@@ -563,12 +685,205 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 	}
 }
 
-static int bitbang_swd_run_queue(void)
+static void bitbang_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
 {
-	LOG_DEBUG("bitbang_swd_run_queue");
+	if (swd_cmd_queue_length >= BITBANG_SWD_QUEUE_SIZE)
+		queued_retval = bitbang_swd_run_queue();
+
+	if (queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skip queueing SWD transaction because queued_retval=%d", queued_retval);
+		return;
+	}
+
+	struct bitbang_swd_cmd *q = &swd_cmd_queue[swd_cmd_queue_length++];
+	q->cmd = cmd | SWD_CMD_START | SWD_CMD_PARK;
+	q->dst = dst;
+	q->data = data;
+	q->ap_delay_clk = ap_delay_clk;
+}
+
+static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RNW);
+	bitbang_swd_queue_cmd(cmd, value, 0, ap_delay_clk);
+}
+
+static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RNW));
+	bitbang_swd_queue_cmd(cmd, NULL, value, ap_delay_clk);
+}
+
+/* Set num_bits bits of a stream, driven by the host when drive is set */
+static void swd_stream_set(uint8_t *out, uint8_t *dir, unsigned int *offset,
+		const uint8_t *value, unsigned int num_bits, bool drive)
+{
+	for (unsigned int i = 0; i < num_bits; i++) {
+		unsigned int bit = *offset + i;
+		if (value && (value[i / 8] & (1 << (i % 8))))
+			out[bit / 8] |= 1 << (bit % 8);
+		if (drive)
+			dir[bit / 8] |= 1 << (bit % 8);
+	}
+	*offset += num_bits;
+}
+
+/*
+ * After a WAIT in the middle of a stream, the transaction that got it and
+ * the ones that followed were refused by the target. Resynchronize the line
+ * and replay them one by one, with the per transaction WAIT handling. The
+ * transactions before 'first' got an OK ack and are not repeated.
+ */
+static void bitbang_swd_replay(unsigned int first)
+{
+	uint32_t dpidr;
+
+	bitbang_swd_exchange(false, (uint8_t *)swd_seq_line_reset, 0, swd_seq_line_reset_len);
+	bitbang_swd_do_read_reg(swd_cmd(true, false, DP_DPIDR), &dpidr, 0);
+	swd_clear_sticky_errors();
+
+	for (unsigned int i = first; i < swd_cmd_queue_length; i++) {
+		struct bitbang_swd_cmd *q = &swd_cmd_queue[i];
+		if (q->cmd & SWD_CMD_RNW)
+			bitbang_swd_do_read_reg(q->cmd, q->dst, q->ap_delay_clk);
+		else
+			bitbang_swd_do_write_reg(q->cmd, q->data, q->ap_delay_clk);
+	}
+
+	bitbang_swd_exchange(true, NULL, 0, 8);
+}
+
+/*
+ * Pack the whole queue into one bit stream of request, turnaround, ack, data,
+ * parity and idle cycles, clock it in one go and check the acks afterwards.
+ */
+static int bitbang_swd_flush_queue(void)
+{
+	unsigned int num_bits = 0;
+
+	for (unsigned int i = 0; i < swd_cmd_queue_length; i++) {
+		num_bits += SWD_TRANSACTION_BITS;
+		if (swd_cmd_queue[i].cmd & SWD_CMD_APNDP)
+			num_bits += swd_cmd_queue[i].ap_delay_clk;
+	}
 	/* A transaction must be followed by another transaction or at least 8 idle cycles to
 	 * ensure that data is clocked through the AP. */
-	bitbang_swd_exchange(true, NULL, 0, 8);
+	num_bits += 8;
+
+	size_t num_bytes = DIV_ROUND_UP(num_bits, 8);
+	uint8_t *out = calloc(num_bytes, 1);
+	uint8_t *dir = calloc(num_bytes, 1);
+	uint8_t *in = calloc(num_bytes, 1);
+	if (!out || !dir || !in) {
+		LOG_ERROR("Out of memory");
+		free(out);
+		free(dir);
+		free(in);
+		return ERROR_FAIL;
+	}
+
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < swd_cmd_queue_length; i++) {
+		struct bitbang_swd_cmd *q = &swd_cmd_queue[i];
+
+		swd_stream_set(out, dir, &offset, &q->cmd, 8, true);
+		swd_stream_set(out, dir, &offset, NULL, 1, false);
+		q->ack_offset = offset;
+		swd_stream_set(out, dir, &offset, NULL, 3, false);
+
+		if (q->cmd & SWD_CMD_RNW) {
+			swd_stream_set(out, dir, &offset, NULL, 32 + 1 + 1, false);
+		} else {
+			uint8_t data_parity[DIV_ROUND_UP(32 + 1, 8)];
+			buf_set_u32(data_parity, 0, 32, q->data);
+			buf_set_u32(data_parity, 32, 1, parity_u32(q->data));
+
+			swd_stream_set(out, dir, &offset, NULL, 1, false);
+			swd_stream_set(out, dir, &offset, data_parity, 32 + 1, true);
+		}
+
+		if (q->cmd & SWD_CMD_APNDP)
+			swd_stream_set(out, dir, &offset, NULL, q->ap_delay_clk, true);
+	}
+	swd_stream_set(out, dir, &offset, NULL, 8, true);
+
+	int retval = bitbang_swd_exchange_stream(out, dir, in, num_bits);
+	if (retval != ERROR_OK)
+		goto out;
+
+	for (unsigned int i = 0; i < swd_cmd_queue_length; i++) {
+		struct bitbang_swd_cmd *q = &swd_cmd_queue[i];
+		int ack = buf_get_u32(in, q->ack_offset, 3);
+		uint32_t data = buf_get_u32(q->cmd & SWD_CMD_RNW ? in : out, q->ack_offset + 3 +
+				(q->cmd & SWD_CMD_RNW ? 0 : 1), 32);
+
+		LOG_DEBUG("%s %s %s reg %X = %08"PRIx32,
+			  ack == SWD_ACK_OK ? "OK" : ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK",
+			  q->cmd & SWD_CMD_APNDP ? "AP" : "DP",
+			  q->cmd & SWD_CMD_RNW ? "read" : "write",
+			  (q->cmd & SWD_CMD_A32) >> 1,
+			  data);
+
+		switch (ack) {
+		 case SWD_ACK_OK:
+			if (q->cmd & SWD_CMD_RNW) {
+				int parity = buf_get_u32(in, q->ack_offset + 3 + 32, 1);
+				if (parity != parity_u32(data)) {
+					LOG_DEBUG("Wrong parity detected");
+					retval = ERROR_FAIL;
+					goto out;
+				}
+				if (q->dst)
+					*q->dst = data;
+			}
+			break;
+		 case SWD_ACK_WAIT:
+			LOG_DEBUG("SWD_ACK_WAIT");
+			/* With overrun detection, which the DAP setup enables, the
+			 * target refuses every transaction after a WAIT until the
+			 * sticky flag is cleared, so none of them has run yet and
+			 * replaying them all can't repeat a side effect. An OK ack
+			 * further on means this didn't hold, don't guess then. */
+			for (unsigned int j = i + 1; j < swd_cmd_queue_length; j++) {
+				if (buf_get_u32(in, swd_cmd_queue[j].ack_offset, 3) == SWD_ACK_OK) {
+					LOG_ERROR("SWD transaction %u done after a WAIT, can't replay", j);
+					retval = ERROR_FAIL;
+					goto out;
+				}
+			}
+			bitbang_swd_replay(i);
+			retval = queued_retval;
+			goto out;
+		 case SWD_ACK_FAULT:
+			LOG_DEBUG("SWD_ACK_FAULT");
+			retval = ack;
+			goto out;
+		 default:
+			LOG_DEBUG("No valid acknowledge: ack=%d", ack);
+			retval = ack;
+			goto out;
+		}
+	}
+
+out:
+	free(out);
+	free(dir);
+	free(in);
+	return retval;
+}
+
+static int bitbang_swd_run_queue(void)
+{
+	LOG_DEBUG("bitbang_swd_run_queue");
+
+	if (queued_retval == ERROR_OK && swd_cmd_queue_length) {
+		queued_retval = bitbang_swd_flush_queue();
+	} else {
+		/* A transaction must be followed by another transaction or at least 8 idle cycles to
+		 * ensure that data is clocked through the AP. */
+		bitbang_swd_exchange(true, NULL, 0, 8);
+	}
+	swd_cmd_queue_length = 0;
 
 	int retval = queued_retval;
 	queued_retval = ERROR_OK;
@@ -583,3 +898,28 @@ const struct swd_driver bitbang_swd = {
 	.write_reg = bitbang_swd_write_reg,
 	.run = bitbang_swd_run_queue,
 };
+
+COMMAND_HANDLER(bitbang_handle_vector_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], bitbang_vector);
+
+	command_print(CMD, "bitbang vector callbacks %s",
+			bitbang_vector ? "enabled" : "disabled");
+	return ERROR_OK;
+}
+
+const struct command_registration bitbang_command_handlers[] = {
+	{
+		.name = "bitbang_vector",
+		.handler = bitbang_handle_vector_command,
+		.mode = COMMAND_ANY,
+		.help = "use the vector callbacks of the driver, if it has them, "
+			"or clock bit by bit",
+		.usage = "['enable'|'disable']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
@@ -54,6 +54,17 @@ struct bitbang_interface {
 	/** Set TCK, TMS, and TDI to the given values. */
 	int (*write)(int tck, int tms, int tdi);
 
+	/** Clock a whole vector of bits (optional).
+	 *
+	 * For each of the num_bits bits, drive TMS and TDI from the matching bit
+	 * of tms and tdi with TCK low, sample TDO into the matching bit of tdo
+	 * (unless tdo is NULL) and raise TCK. TCK is left low on return.
+	 * tms and tdi may be NULL to shift out zeros, and tdo may point to the same
+	 * buffer as tdi. Drivers implementing this avoid one callback per edge;
+	 * others are driven through write() and read() bit by bit. */
+	int (*write_vector)(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+			unsigned int num_bits);
+
 	/** Blink led (optional). */
 	int (*blink)(int on);
 
@@ -65,10 +76,22 @@ struct bitbang_interface {
 
 	/** Set SWCLK and SWDIO to the given value. */
 	int (*swd_write)(int swclk, int swdio);
+
+	/** Clock a whole SWD bit stream (optional).
+	 *
+	 * For each of the num_bits bits, SWDIO is driven from the matching bit
+	 * of swdio_out when the matching bit of swdio_dir is set. Otherwise
+	 * SWDIO is released and sampled into the matching bit of swdio_in.
+	 * The host drives SWDIO before and after the stream. Drivers lacking
+	 * it are driven through swd_write(), swdio_read() and swdio_drive(). */
+	int (*swd_write_vector)(const uint8_t *swdio_out, const uint8_t *swdio_dir,
+			uint8_t *swdio_in, unsigned int num_bits);
 };
 
 extern const struct swd_driver bitbang_swd;
 
+extern const struct command_registration bitbang_command_handlers[];
+
 int bitbang_execute_queue(void);
 
 extern struct bitbang_interface *bitbang_interface;
@@ -41,6 +41,20 @@ static struct gpiod_line *gpiod_swdio;
 static struct gpiod_line *gpiod_srst;
 static struct gpiod_line *gpiod_led;
 
+/*
+ * TDI, TMS and TCK are requested together so that they can be changed with
+ * a single request. Keep the order of the JTAG_OUT_* indexes.
+ */
+enum {
+	JTAG_OUT_TDI,
+	JTAG_OUT_TMS,
+	JTAG_OUT_TCK,
+	JTAG_OUT_NUM,
+};
+
+static struct gpiod_line_bulk jtag_out_bulk;
+static int jtag_out_values[JTAG_OUT_NUM];
+
 static int last_swclk;
 static int last_swdio;
 static bool last_stored;
@@ -61,50 +75,63 @@ static bb_value_t linuxgpiod_read(void)
 }
 
 /*
- * Bitbang interface write of TCK, TMS, TDI
+ * Drive TDI, TMS and TCK with a single request on the bulk of JTAG outputs.
  *
- * Seeing as this is the only function where the outputs are changed,
- * we can cache the old value to avoid needlessly writing it.
+ * The outputs are cached to avoid needlessly writing them.
  */
+static void linuxgpiod_set_jtag_outputs(int tck, int tms, int tdi)
+{
+	int retval;
+
+	if (tck == jtag_out_values[JTAG_OUT_TCK] &&
+			tms == jtag_out_values[JTAG_OUT_TMS] &&
+			tdi == jtag_out_values[JTAG_OUT_TDI])
+		return;
+
+	jtag_out_values[JTAG_OUT_TDI] = tdi;
+	jtag_out_values[JTAG_OUT_TMS] = tms;
+	jtag_out_values[JTAG_OUT_TCK] = tck;
+
+	retval = gpiod_line_set_value_bulk(&jtag_out_bulk, jtag_out_values);
+	if (retval < 0)
+		LOG_WARNING("writing tck, tms and tdi failed");
+}
+
+/* Bitbang interface write of TCK, TMS, TDI */
 static int linuxgpiod_write(int tck, int tms, int tdi)
 {
-	static int last_tck;
-	static int last_tms;
-	static int last_tdi;
+	linuxgpiod_set_jtag_outputs(tck, tms, tdi);
 
-	static int first_time;
+	return ERROR_OK;
+}
 
-	int retval;
+/* Bitbang interface vectored write of TMS, TDI with TDO capture */
+static int linuxgpiod_write_vector(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		unsigned int num_bits)
+{
+	int tms_bit = 0;
+	int tdi_bit = 0;
 
-	if (!first_time) {
-		last_tck = !tck;
-		last_tms = !tms;
-		last_tdi = !tdi;
-		first_time = 1;
-	}
+	for (unsigned int i = 0; i < num_bits; i++) {
+		unsigned int bytec = i / 8;
+		uint8_t bcval = 1 << (i % 8);
 
-	if (tdi != last_tdi) {
-		retval = gpiod_line_set_value(gpiod_tdi, tdi);
-		if (retval < 0)
-			LOG_WARNING("writing tdi failed");
-	}
+		tms_bit = tms && (tms[bytec] & bcval);
+		tdi_bit = tdi && (tdi[bytec] & bcval);
 
-	if (tms != last_tms) {
-		retval = gpiod_line_set_value(gpiod_tms, tms);
-		if (retval < 0)
-			LOG_WARNING("writing tms failed");
-	}
+		linuxgpiod_set_jtag_outputs(0, tms_bit, tdi_bit);
 
-	/* write clk last */
-	if (tck != last_tck) {
-		retval = gpiod_line_set_value(gpiod_tck, tck);
-		if (retval < 0)
-			LOG_WARNING("writing tck failed");
+		if (tdo) {
+			if (linuxgpiod_read() == BB_HIGH)
+				tdo[bytec] |= bcval;
+			else
+				tdo[bytec] &= ~bcval;
+		}
+
+		linuxgpiod_set_jtag_outputs(1, tms_bit, tdi_bit);
 	}
 
-	last_tdi = tdi;
-	last_tms = tms;
-	last_tck = tck;
+	linuxgpiod_set_jtag_outputs(0, tms_bit, tdi_bit);
 
 	return ERROR_OK;
 }
@@ -189,6 +216,7 @@ static int linuxgpiod_blink(int on)
 static struct bitbang_interface linuxgpiod_bitbang = {
 	.read = linuxgpiod_read,
 	.write = linuxgpiod_write,
+	.write_vector = linuxgpiod_write_vector,
 	.swdio_read = linuxgpiod_swdio_read,
 	.swdio_drive = linuxgpiod_swdio_drive,
 	.swd_write = linuxgpiod_swd_write,
@@ -318,6 +346,41 @@ static struct gpiod_line *helper_get_output_line(const char *label, unsigned int
 	return line;
 }
 
+static int helper_get_jtag_output_bulk(void)
+{
+	struct gpiod_line *tdi, *tms, *tck;
+	int retval;
+
+	tdi = gpiod_chip_get_line(gpiod_chip, tdi_gpio);
+	tms = gpiod_chip_get_line(gpiod_chip, tms_gpio);
+	tck = gpiod_chip_get_line(gpiod_chip, tck_gpio);
+	if (tdi == NULL || tms == NULL || tck == NULL) {
+		LOG_ERROR("Error get lines tdi, tms and tck");
+		return ERROR_FAIL;
+	}
+
+	gpiod_line_bulk_init(&jtag_out_bulk);
+	gpiod_line_bulk_add(&jtag_out_bulk, tdi);
+	gpiod_line_bulk_add(&jtag_out_bulk, tms);
+	gpiod_line_bulk_add(&jtag_out_bulk, tck);
+
+	jtag_out_values[JTAG_OUT_TDI] = 0;
+	jtag_out_values[JTAG_OUT_TMS] = 1;
+	jtag_out_values[JTAG_OUT_TCK] = 0;
+
+	retval = gpiod_line_request_bulk_output(&jtag_out_bulk, "OpenOCD", jtag_out_values);
+	if (retval < 0) {
+		LOG_ERROR("Error request_output lines tdi, tms and tck");
+		return ERROR_FAIL;
+	}
+
+	gpiod_tdi = tdi;
+	gpiod_tms = tms;
+	gpiod_tck = tck;
+
+	return ERROR_OK;
+}
+
 static int linuxgpiod_init(void)
 {
 	LOG_INFO("Linux GPIOD JTAG/SWD bitbang driver");
@@ -346,16 +409,7 @@ static int linuxgpiod_init(void)
 		if (gpiod_tdo == NULL)
 			goto out_error;
 
-		gpiod_tdi = helper_get_output_line("tdi", tdi_gpio, 0);
-		if (gpiod_tdi == NULL)
-			goto out_error;
-
-		gpiod_tck = helper_get_output_line("tck", tck_gpio, 0);
-		if (gpiod_tck == NULL)
-			goto out_error;
-
-		gpiod_tms = helper_get_output_line("tms", tms_gpio, 1);
-		if (gpiod_tms == NULL)
+		if (helper_get_jtag_output_bulk() != ERROR_OK)
 			goto out_error;
 
 		if (is_gpio_valid(trst_gpio)) {
@@ -609,6 +663,9 @@ static const struct command_registration linuxgpiod_command_handlers[] = {
 		.help = "number of the gpiochip.",
 		.usage = "gpiochip",
 	},
+	{
+		.chain = bitbang_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -100,7 +100,9 @@ static const struct freertos_params freertos_params_list[] = {
 
 static bool freertos_detect_rtos(struct target *target);
 static int freertos_create(struct target *target);
+static void freertos_free_params(struct rtos *rtos);
 static int freertos_update_threads(struct rtos *rtos);
+static bool freertos_threads_changed(struct rtos *rtos);
 static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs);
 static int freertos_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list[]);
@@ -110,7 +112,9 @@ struct rtos_type freertos_rtos = {
 
 	.detect_rtos = freertos_detect_rtos,
 	.create = freertos_create,
+	.free_params = freertos_free_params,
 	.update_threads = freertos_update_threads,
+	.threads_changed = freertos_threads_changed,
 	.get_thread_reg_list = freertos_get_thread_reg_list,
 	.get_symbol_list_to_lookup = freertos_get_symbol_list_to_lookup,
 };
@@ -127,6 +131,7 @@ enum freertos_symbol_values {
 	FREERTOS_VAL_X_SUSPENDED_TASK_LIST = 8,
 	FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS = 9,
 	FREERTOS_VAL_UX_TOP_USED_PRIORITY = 10,
+	FREERTOS_VAL_UX_TASK_NUMBER = 11,
 };
 
 struct symbols {
@@ -146,24 +151,356 @@ static const struct symbols freertos_symbol_list[] = {
 	{ "xSuspendedTaskList", true }, /* Only if INCLUDE_vTaskSuspend */
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
+	{ "uxTaskNumber", true }, /* Counts created tasks, static */
 	{ NULL, false }
 };
 
-/* TODO: */
-/* this is not safe for little endian yet */
-/* may be problems reading if sizes are not 32 bit long integers. */
-/* test mallocs for failure */
+#define FREERTOS_THREAD_NAME_STR_SIZE (200)
+
+/* A task list item, found embedded in a TCB */
+struct freertos_list_item {
+	uint32_t address;
+	uint32_t next;		/* at list_elem_next_offset */
+	uint32_t owner;		/* at list_elem_content_offset, the TCB */
+	bool valid;			/* next and owner read on this halt */
+	bool used;			/* linked into a task list on this halt */
+};
+
+struct freertos_tcb {
+	uint32_t address;
+	char *name;
+	bool used;
+	uint32_t stack_ptr;	/* pxTopOfStack, valid for regs_generation */
+	bool stack_valid;
+};
+
+/* The list items and TCBs found on the previous halt are kept, so the next
+ * snapshot can read them all in one go together with the list heads. Tasks
+ * moving between lists keep their list item, only new items cost another
+ * round trip. TCB names are kept until a task is created, which may reuse
+ * the TCB of a deleted one. */
+struct freertos {
+	const struct freertos_params *params;
+	/* The program uxTopUsedPriority and the TCB names were read from */
+	unsigned int image_generation;
+	bool top_used_priority_read;
+	uint32_t top_used_priority;
+	struct freertos_list_item *items;
+	unsigned int num_items;
+	struct freertos_tcb *tcbs;
+	unsigned int num_tcbs;
+	/* uxCurrentNumberOfTasks, pxCurrentTCB and uxTaskNumber as read with
+	 * the current thread list */
+	uint8_t state[12];
+	bool state_valid;
+	/* uxTaskNumber when the TCB names were read */
+	uint32_t names_task_number;
+	bool names_valid;
+	/* The halt the stack pointers and FPU state were read in */
+	unsigned int regs_generation;
+	bool regs_valid;
+	bool fpu_enabled;
+};
+
+/* Set up the reads of the words telling whether the task set changed,
+ * into state. Returns the number of reads. */
+static unsigned int freertos_state_reads(struct rtos *rtos,
+		struct target_memory_read *reads, uint8_t *state)
+{
+	unsigned int num_reads = 0;
+
+	reads[num_reads].address = rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address;
+	reads[num_reads].size = 4;
+	reads[num_reads++].buffer = state;
+	reads[num_reads].address = rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address;
+	reads[num_reads].size = 4;
+	reads[num_reads++].buffer = state + 4;
+	if (rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address != 0) {
+		reads[num_reads].address = rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address;
+		reads[num_reads].size = 4;
+		reads[num_reads++].buffer = state + 8;
+	}
+
+	return num_reads;
+}
+
+/* Each created task bumps uxTaskNumber and each deleted one, once cleaned
+ * up, drops uxCurrentNumberOfTasks. With both unchanged and the same task
+ * running, the thread list only differs by order, FreeRTOS doesn't show
+ * any per thread state but the running one. */
+static bool freertos_threads_changed(struct rtos *rtos)
+{
+	struct freertos *freertos = rtos->rtos_specific_params;
+	struct target_memory_read reads[3];
+	uint8_t state[12];
+
+	if (!freertos || !freertos->state_valid || !rtos->symbols ||
+			freertos->image_generation != rtos->image_generation)
+		return true;
+
+	unsigned int num_reads = freertos_state_reads(rtos, reads, state);
+	if (target_read_buffers(rtos->target, reads, num_reads) != ERROR_OK)
+		return true;
+
+	return memcmp(state, freertos->state, sizeof(state)) != 0;
+}
+
+static struct freertos_list_item *freertos_find_item(struct freertos *freertos,
+		uint32_t address)
+{
+	for (unsigned int i = 0; i < freertos->num_items; i++)
+		if (freertos->items[i].address == address)
+			return &freertos->items[i];
+	return NULL;
+}
+
+static struct freertos_list_item *freertos_add_item(struct freertos *freertos,
+		uint32_t address)
+{
+	struct freertos_list_item *items = realloc(freertos->items,
+			(freertos->num_items + 1) * sizeof(*items));
+	if (!items)
+		return NULL;
+
+	freertos->items = items;
+	struct freertos_list_item *item = &items[freertos->num_items++];
+	memset(item, 0, sizeof(*item));
+	item->address = address;
+	return item;
+}
+
+static struct freertos_tcb *freertos_find_tcb(struct freertos *freertos,
+		uint32_t address)
+{
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++)
+		if (freertos->tcbs[i].address == address)
+			return &freertos->tcbs[i];
+	return NULL;
+}
+
+static struct freertos_tcb *freertos_add_tcb(struct freertos *freertos,
+		uint32_t address)
+{
+	struct freertos_tcb *tcbs = realloc(freertos->tcbs,
+			(freertos->num_tcbs + 1) * sizeof(*tcbs));
+	if (!tcbs)
+		return NULL;
+
+	freertos->tcbs = tcbs;
+	struct freertos_tcb *tcb = &tcbs[freertos->num_tcbs++];
+	memset(tcb, 0, sizeof(*tcb));
+	tcb->address = address;
+	return tcb;
+}
+
+/* Read the next and owner pointers of all list items not valid yet, with
+ * a single gathered read */
+static int freertos_read_items(struct rtos *rtos, struct freertos *freertos)
+{
+	const struct freertos_params *param = freertos->params;
+	unsigned int first = MIN(param->list_elem_next_offset, param->list_elem_content_offset);
+	unsigned int span = MAX(param->list_elem_next_offset, param->list_elem_content_offset)
+		+ param->pointer_width - first;
+	unsigned int num_reads = 0;
+	int retval;
+
+	for (unsigned int i = 0; i < freertos->num_items; i++)
+		if (!freertos->items[i].valid)
+			num_reads++;
+	if (num_reads == 0)
+		return ERROR_OK;
+
+	struct target_memory_read *reads = calloc(num_reads, sizeof(*reads));
+	uint8_t *data = malloc(num_reads * span);
+	if (!reads || !data) {
+		LOG_ERROR("Error allocating memory for %u FreeRTOS list items", num_reads);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < freertos->num_items; i++) {
+		if (freertos->items[i].valid)
+			continue;
+		reads[n].address = freertos->items[i].address + first;
+		reads[n].size = span;
+		reads[n].buffer = data + n * span;
+		n++;
+	}
+
+	retval = target_read_buffers(rtos->target, reads, num_reads);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread list items");
+		goto done;
+	}
+
+	n = 0;
+	for (unsigned int i = 0; i < freertos->num_items; i++) {
+		struct freertos_list_item *item = &freertos->items[i];
+		if (item->valid)
+			continue;
+		item->next = target_buffer_get_u32(rtos->target,
+				reads[n].buffer + param->list_elem_next_offset - first);
+		item->owner = target_buffer_get_u32(rtos->target,
+				reads[n].buffer + param->list_elem_content_offset - first);
+		item->valid = true;
+		n++;
+	}
+
+done:
+	free(data);
+	free(reads);
+	return retval;
+}
+
+/* Read the names of all TCBs which don't have one yet */
+static int freertos_read_names(struct rtos *rtos, struct freertos *freertos)
+{
+	const struct freertos_params *param = freertos->params;
+	unsigned int num_reads = 0;
+	int retval;
+
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++)
+		if (!freertos->tcbs[i].name)
+			num_reads++;
+	if (num_reads == 0)
+		return ERROR_OK;
+
+	struct target_memory_read *reads = calloc(num_reads, sizeof(*reads));
+	char *data = malloc(num_reads * FREERTOS_THREAD_NAME_STR_SIZE);
+	if (!reads || !data) {
+		LOG_ERROR("Error allocating memory for %u FreeRTOS thread names", num_reads);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++) {
+		if (freertos->tcbs[i].name)
+			continue;
+		reads[n].address = freertos->tcbs[i].address + param->thread_name_offset;
+		reads[n].size = FREERTOS_THREAD_NAME_STR_SIZE;
+		reads[n].buffer = (uint8_t *)data + n * FREERTOS_THREAD_NAME_STR_SIZE;
+		n++;
+	}
+
+	retval = target_read_buffers(rtos->target, reads, num_reads);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread names");
+		goto done;
+	}
+
+	n = 0;
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++) {
+		struct freertos_tcb *tcb = &freertos->tcbs[i];
+		if (tcb->name)
+			continue;
+		char *tmp_str = (char *)reads[n++].buffer;
+		tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
+		LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx32 ", value '%s'",
+				tcb->address + param->thread_name_offset, tmp_str);
+
+		if (tmp_str[0] == '\x00')
+			strcpy(tmp_str, "No Name");
+
+		tcb->name = strdup(tmp_str);
+		if (!tcb->name) {
+			retval = ERROR_FAIL;
+			break;
+		}
+	}
+
+done:
+	free(data);
+	free(reads);
+	return retval;
+}
+
+/* On the first register request of a halt, read the stack pointers of all
+ * threads, and CPACR, with one gathered read, then prefetch their stacked
+ * frames. GDB usually goes on asking for the registers of every thread. */
+static int freertos_read_stacks(struct rtos *rtos, struct freertos *freertos)
+{
+	const struct freertos_params *param = freertos->params;
+	unsigned int num_reads = 0;
+	bool check_fpu = false;
+	uint8_t cpacr[4];
+	int retval;
+
+	/* Check for armv7m with *enabled* FPU, i.e. a Cortex-M4F */
+	struct armv7m_common *armv7m_target = target_to_armv7m(rtos->target);
+	if (is_armv7m(armv7m_target) && armv7m_target->fp_feature == FPV4_SP)
+		check_fpu = true;
+
+	struct target_memory_read *reads = calloc(freertos->num_tcbs + 1, sizeof(*reads));
+	uint8_t *stack_ptrs = malloc(freertos->num_tcbs * 4 + 1);
+	int64_t *frames = calloc(freertos->num_tcbs + 1, sizeof(*frames));
+	if (!reads || !stack_ptrs || !frames) {
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++) {
+		freertos->tcbs[i].stack_valid = false;
+		reads[num_reads].address = freertos->tcbs[i].address + param->thread_stack_offset;
+		reads[num_reads].size = 4;
+		reads[num_reads].buffer = stack_ptrs + i * 4;
+		num_reads++;
+	}
+	if (check_fpu) {
+		reads[num_reads].address = FPU_CPACR;
+		reads[num_reads].size = 4;
+		reads[num_reads].buffer = cpacr;
+		num_reads++;
+	}
+
+	retval = target_read_buffers(rtos->target, reads, num_reads);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading stack pointers of FreeRTOS threads");
+		goto done;
+	}
+
+	/* Check if CP10 and CP11 are set to full access. */
+	freertos->fpu_enabled = check_fpu &&
+		(target_buffer_get_u32(rtos->target, cpacr) & 0x00F00000);
+
+	unsigned int num_frames = 0;
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++) {
+		struct freertos_tcb *tcb = &freertos->tcbs[i];
+		tcb->stack_ptr = target_buffer_get_u32(rtos->target, stack_ptrs + i * 4);
+		tcb->stack_valid = true;
+		if (tcb->address != rtos->current_thread)
+			frames[num_frames++] = tcb->stack_ptr;
+	}
+
+	freertos->regs_generation = rtos->halt_generation;
+	freertos->regs_valid = true;
+
+	/* The frame with FPU registers covers the other ones and the LR */
+	if (rtos_prefetch_stack_frames(rtos->target,
+			freertos->fpu_enabled ? param->stacking_info_cm4f_fpu : param->stacking_info_cm3,
+			frames, num_frames) != ERROR_OK)
+		LOG_DEBUG("FreeRTOS: failed to prefetch stack frames");
+
+done:
+	free(frames);
+	free(stack_ptrs);
+	free(reads);
+	return retval;
+}
 
 static int freertos_update_threads(struct rtos *rtos)
 {
 	int retval;
 	unsigned int tasks_found = 0;
+	struct freertos *freertos;
 	const struct freertos_params *param;
 
 	if (rtos->rtos_specific_params == NULL)
 		return -1;
 
-	param = (const struct freertos_params *) rtos->rtos_specific_params;
+	freertos = (struct freertos *) rtos->rtos_specific_params;
+	param = freertos->params;
 
 	if (rtos->symbols == NULL) {
 		LOG_ERROR("No symbols for FreeRTOS");
@@ -175,32 +512,104 @@ static int freertos_update_threads(struct rtos *rtos)
 		return -2;
 	}
 
-	uint32_t thread_list_size = 0;
-	retval = target_read_u32(rtos->target,
-			rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
-			&thread_list_size);
-	LOG_DEBUG("FreeRTOS: Read uxCurrentNumberOfTasks at 0x%" PRIx64 ", value %" PRIu32,
-										rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
-										thread_list_size);
+	/* After a reset or a new program, nothing read before can be trusted */
+	if (freertos->image_generation != rtos->image_generation) {
+		freertos->top_used_priority_read = false;
+		freertos->state_valid = false;
+		freertos->names_valid = false;
+		freertos->image_generation = rtos->image_generation;
+	}
+
+	/* uxTopUsedPriority is a constant, read it once per program.
+	 * It was defined as configMAX_PRIORITIES - 1
+	 * in old FreeRTOS versions (before V7.5.3)
+	 * Use contrib/rtos-helpers/FreeRTOS-openocd.c to get compatible symbol
+	 * in newer FreeRTOS versions. */
+	if (!freertos->top_used_priority_read &&
+			rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address != 0) {
+		uint32_t top_used_priority = 0;
+		retval = target_read_u32(rtos->target,
+				rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address,
+				&top_used_priority);
+		if (retval != ERROR_OK)
+			return retval;
+		LOG_DEBUG("FreeRTOS: Read uxTopUsedPriority at 0x%" PRIx64 ", value %" PRIu32,
+											rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address,
+											top_used_priority);
+		if (top_used_priority > FREERTOS_MAX_PRIORITIES) {
+			LOG_ERROR("FreeRTOS top used priority is unreasonably big, not proceeding: %" PRIu32,
+				top_used_priority);
+			return ERROR_FAIL;
+		}
+		freertos->top_used_priority = top_used_priority;
+		freertos->top_used_priority_read = true;
+	}
 
+	/* Here we restore the original configMAX_PRIORITIES value */
+	unsigned int config_max_priorities = 0;
+	if (freertos->top_used_priority_read)
+		config_max_priorities = freertos->top_used_priority + 1;
+
+	symbol_address_t list_of_lists[FREERTOS_MAX_PRIORITIES + 1 + 5];
+	unsigned int num_lists;
+	for (num_lists = 0; num_lists < config_max_priorities; num_lists++)
+		list_of_lists[num_lists] = rtos->symbols[FREERTOS_VAL_PX_READY_TASKS_LISTS].address +
+			num_lists * param->list_width;
+
+	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_DELAYED_TASK_LIST1].address;
+	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_DELAYED_TASK_LIST2].address;
+	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_PENDING_READY_LIST].address;
+	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
+	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
+
+	/* Snapshot the task count, the current TCB and all list heads, the
+	 * ready lists as one block, with the items known from the last halt */
+	uint8_t *lists = malloc(num_lists * param->list_width);
+	struct target_memory_read *reads = calloc(3 + 1 + 5, sizeof(*reads));
+	uint32_t *thread_ids = NULL;
+	if (!lists || !reads) {
+		LOG_ERROR("Error allocating memory for %u FreeRTOS lists", num_lists);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	uint8_t state[12] = { 0 };
+	unsigned int num_reads = freertos_state_reads(rtos, reads, state);
+	if (config_max_priorities > 0) {
+		reads[num_reads].address = list_of_lists[0];
+		reads[num_reads].size = config_max_priorities * param->list_width;
+		reads[num_reads++].buffer = lists;
+	}
+	for (unsigned int i = config_max_priorities; i < num_lists; i++) {
+		if (list_of_lists[i] == 0)
+			continue;
+		reads[num_reads].address = list_of_lists[i];
+		reads[num_reads].size = param->list_width;
+		reads[num_reads++].buffer = lists + i * param->list_width;
+	}
+
+	for (unsigned int i = 0; i < freertos->num_items; i++)
+		freertos->items[i].valid = false;
+	freertos->state_valid = false;
+
+	retval = target_read_buffers(rtos->target, reads, num_reads);
+	if (retval == ERROR_OK)
+		retval = freertos_read_items(rtos, freertos);
 	if (retval != ERROR_OK) {
-		LOG_ERROR("Could not read FreeRTOS thread count from target");
-		return retval;
+		LOG_ERROR("Could not read FreeRTOS thread lists from target");
+		goto done;
 	}
 
+	uint32_t thread_list_size = target_buffer_get_u32(rtos->target, state);
+	LOG_DEBUG("FreeRTOS: Read uxCurrentNumberOfTasks at 0x%" PRIx64 ", value %" PRIu32,
+										rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
+										thread_list_size);
+
 	/* wipe out previous thread details if any */
 	rtos_free_threadlist(rtos);
 
 	/* read the current thread */
-	uint32_t pointer_casts_are_bad;
-	retval = target_read_u32(rtos->target,
-			rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
-			&pointer_casts_are_bad);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Error reading current thread in FreeRTOS thread list");
-		return retval;
-	}
-	rtos->current_thread = pointer_casts_are_bad;
+	rtos->current_thread = target_buffer_get_u32(rtos->target, state + 4);
 	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx64,
 										rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
 										rtos->current_thread);
@@ -216,7 +625,8 @@ static int freertos_update_threads(struct rtos *rtos)
 				sizeof(struct thread_detail) * thread_list_size);
 		if (!rtos->thread_details) {
 			LOG_ERROR("Error allocating memory for %d threads", thread_list_size);
-			return ERROR_FAIL;
+			retval = ERROR_FAIL;
+			goto done;
 		}
 		rtos->thread_details->threadid = 1;
 		rtos->thread_details->exists = true;
@@ -226,7 +636,8 @@ static int freertos_update_threads(struct rtos *rtos)
 
 		if (thread_list_size == 1) {
 			rtos->thread_count = 1;
-			return ERROR_OK;
+			retval = ERROR_OK;
+			goto done;
 		}
 	} else {
 		/* create space for new thread details */
@@ -234,172 +645,168 @@ static int freertos_update_threads(struct rtos *rtos)
 				sizeof(struct thread_detail) * thread_list_size);
 		if (!rtos->thread_details) {
 			LOG_ERROR("Error allocating memory for %d threads", thread_list_size);
-			return ERROR_FAIL;
+			retval = ERROR_FAIL;
+			goto done;
 		}
 	}
 
 	/* Find out how many lists are needed to be read from pxReadyTasksLists, */
 	if (rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address == 0) {
 		LOG_ERROR("FreeRTOS: uxTopUsedPriority is not defined, consult the OpenOCD manual for a work-around");
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
+		goto done;
 	}
-	uint32_t top_used_priority = 0;
-	retval = target_read_u32(rtos->target,
-			rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address,
-			&top_used_priority);
-	if (retval != ERROR_OK)
-		return retval;
-	LOG_DEBUG("FreeRTOS: Read uxTopUsedPriority at 0x%" PRIx64 ", value %" PRIu32,
-										rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address,
-										top_used_priority);
-	if (top_used_priority > FREERTOS_MAX_PRIORITIES) {
-		LOG_ERROR("FreeRTOS top used priority is unreasonably big, not proceeding: %" PRIu32,
-			top_used_priority);
-		return ERROR_FAIL;
-	}
-
-	/* uxTopUsedPriority was defined as configMAX_PRIORITIES - 1
-	 * in old FreeRTOS versions (before V7.5.3)
-	 * Use contrib/rtos-helpers/FreeRTOS-openocd.c to get compatible symbol
-	 * in newer FreeRTOS versions.
-	 * Here we restore the original configMAX_PRIORITIES value */
-	unsigned int config_max_priorities = top_used_priority + 1;
 
-	symbol_address_t *list_of_lists =
-		malloc(sizeof(symbol_address_t) * (config_max_priorities + 5));
-	if (!list_of_lists) {
-		LOG_ERROR("Error allocating memory for %u priorities", config_max_priorities);
-		return ERROR_FAIL;
+	thread_ids = malloc(sizeof(uint32_t) * thread_list_size);
+	if (!thread_ids) {
+		LOG_ERROR("Error allocating memory for %d threads", thread_list_size);
+		retval = ERROR_FAIL;
+		goto done;
 	}
 
-	unsigned int num_lists;
-	for (num_lists = 0; num_lists < config_max_priorities; num_lists++)
-		list_of_lists[num_lists] = rtos->symbols[FREERTOS_VAL_PX_READY_TASKS_LISTS].address +
-			num_lists * param->list_width;
+	/* Walk the lists through the snapshot. Items not seen before are read
+	 * all together and the walk is repeated, so each round trip advances
+	 * every list with a changed linkage by at least one item. */
+	const unsigned int first_task = tasks_found;
+	for (unsigned int round = 0; ; round++) {
+		unsigned int missing = 0;
+
+		tasks_found = first_task;
+		for (unsigned int i = 0; i < freertos->num_items; i++)
+			freertos->items[i].used = false;
+
+		for (unsigned int i = 0; i < num_lists; i++) {
+			if (list_of_lists[i] == 0)
+				continue;
+
+			const uint8_t *list = lists + i * param->list_width;
+			uint32_t list_thread_count = target_buffer_get_u32(rtos->target, list);
+			if (list_thread_count == 0)
+				continue;
+
+			uint32_t prev_list_elem_ptr = -1;
+			uint32_t list_elem_ptr = target_buffer_get_u32(rtos->target,
+					list + param->list_next_offset);
+
+			while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
+					(list_elem_ptr != prev_list_elem_ptr) &&
+					(tasks_found < thread_list_size)) {
+				struct freertos_list_item *item = freertos_find_item(freertos, list_elem_ptr);
+				if (!item || !item->valid) {
+					if (!item && !freertos_add_item(freertos, list_elem_ptr)) {
+						retval = ERROR_FAIL;
+						goto done;
+					}
+					missing++;
+					break;
+				}
+
+				item->used = true;
+				thread_ids[tasks_found - first_task] = item->owner;
+				tasks_found++;
+				list_thread_count--;
+
+				prev_list_elem_ptr = list_elem_ptr;
+				list_elem_ptr = item->next;
+			}
+		}
 
-	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_DELAYED_TASK_LIST1].address;
-	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_DELAYED_TASK_LIST2].address;
-	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_PENDING_READY_LIST].address;
-	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
-	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
+		if (missing == 0)
+			break;
 
-	for (unsigned int i = 0; i < num_lists; i++) {
-		if (list_of_lists[i] == 0)
-			continue;
-
-		/* Read the number of threads in this list */
-		uint32_t list_thread_count = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i],
-				&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
+		if (round > thread_list_size) {
+			LOG_ERROR("Error walking FreeRTOS thread lists");
+			retval = ERROR_FAIL;
+			goto done;
 		}
-		LOG_DEBUG("FreeRTOS: Read thread count for list %u at 0x%" PRIx64 ", value %" PRIu32,
-										i, list_of_lists[i], list_thread_count);
 
-		if (list_thread_count == 0)
-			continue;
+		LOG_DEBUG("FreeRTOS: Reading %u new list items", missing);
+		retval = freertos_read_items(rtos, freertos);
+		if (retval != ERROR_OK)
+			goto done;
+	}
 
-		/* Read the location of first list item */
-		uint32_t prev_list_elem_ptr = -1;
-		uint32_t list_elem_ptr = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
+	/* Forget the list items and TCBs which are gone */
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < freertos->num_items; i++)
+		if (freertos->items[i].used)
+			freertos->items[n++] = freertos->items[i];
+	freertos->num_items = n;
+
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++)
+		freertos->tcbs[i].used = false;
+
+	for (unsigned int i = 0; i < tasks_found - first_task; i++) {
+		struct freertos_tcb *tcb = freertos_find_tcb(freertos, thread_ids[i]);
+		if (!tcb)
+			tcb = freertos_add_tcb(freertos, thread_ids[i]);
+		if (!tcb) {
+			retval = ERROR_FAIL;
+			goto done;
 		}
-		LOG_DEBUG("FreeRTOS: Read first item for list %u at 0x%" PRIx64 ", value 0x%" PRIx32,
-										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
-
-		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
-				(list_elem_ptr != prev_list_elem_ptr) &&
-				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
-			rtos->thread_details[tasks_found].threadid = 0;
-			retval = target_read_u32(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					&pointer_casts_are_bad);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
-			rtos->thread_details[tasks_found].threadid = pointer_casts_are_bad;
-			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx32 ", value 0x%" PRIx64,
-										list_elem_ptr + param->list_elem_content_offset,
-										rtos->thread_details[tasks_found].threadid);
-
-			/* get thread name */
-
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
-
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
-			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-										tmp_str);
-
-			if (tmp_str[0] == '\x00')
-				strcpy(tmp_str, "No Name");
-
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-			rtos->thread_details[tasks_found].exists = true;
-
-			if (rtos->thread_details[tasks_found].threadid == rtos->current_thread) {
-				char running_str[] = "State: Running";
-				rtos->thread_details[tasks_found].extra_info_str = malloc(
-						sizeof(running_str));
-				strcpy(rtos->thread_details[tasks_found].extra_info_str,
-					running_str);
-			} else
-				rtos->thread_details[tasks_found].extra_info_str = NULL;
-
-			tasks_found++;
-			list_thread_count--;
-
-			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_u32(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
-			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx32 ", value 0x%" PRIx32,
-										prev_list_elem_ptr + param->list_elem_next_offset,
-										list_elem_ptr);
+		tcb->used = true;
+	}
+
+	n = 0;
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++) {
+		if (freertos->tcbs[i].used)
+			freertos->tcbs[n++] = freertos->tcbs[i];
+		else
+			free(freertos->tcbs[i].name);
+	}
+	freertos->num_tcbs = n;
+
+	/* Without uxTaskNumber, a new task can't be told from a deleted one
+	 * whose TCB it got, so the names are read every time then */
+	uint32_t task_number = target_buffer_get_u32(rtos->target, state + 8);
+	if (!freertos->names_valid || freertos->names_task_number != task_number ||
+			rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address == 0) {
+		for (unsigned int i = 0; i < freertos->num_tcbs; i++) {
+			free(freertos->tcbs[i].name);
+			freertos->tcbs[i].name = NULL;
 		}
 	}
 
-	free(list_of_lists);
+	freertos->names_valid = false;
+	retval = freertos_read_names(rtos, freertos);
+	if (retval != ERROR_OK)
+		goto done;
+	freertos->names_task_number = task_number;
+	freertos->names_valid = true;
+
+	for (unsigned int i = first_task; i < tasks_found; i++) {
+		struct thread_detail *detail = &rtos->thread_details[i];
+		struct freertos_tcb *tcb = freertos_find_tcb(freertos, thread_ids[i - first_task]);
+
+		detail->threadid = tcb->address;
+		detail->thread_name_str = strdup(tcb->name);
+		detail->exists = true;
+
+		if (detail->threadid == rtos->current_thread) {
+			char running_str[] = "State: Running";
+			detail->extra_info_str = malloc(sizeof(running_str));
+			strcpy(detail->extra_info_str, running_str);
+		} else
+			detail->extra_info_str = NULL;
+	}
+
 	rtos->thread_count = tasks_found;
-	return 0;
+	memcpy(freertos->state, state, sizeof(state));
+	freertos->state_valid = rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address != 0;
+	retval = ERROR_OK;
+
+done:
+	free(thread_ids);
+	free(reads);
+	free(lists);
+	return retval;
 }
 
 static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs)
 {
 	int retval;
+	struct freertos *freertos;
 	const struct freertos_params *param;
 	int64_t stack_ptr = 0;
 
@@ -412,54 +819,43 @@ static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	if (rtos->rtos_specific_params == NULL)
 		return -1;
 
-	param = (const struct freertos_params *) rtos->rtos_specific_params;
+	freertos = (struct freertos *) rtos->rtos_specific_params;
+	param = freertos->params;
+
+	if (!freertos->regs_valid || freertos->regs_generation != rtos->halt_generation) {
+		retval = freertos_read_stacks(rtos, freertos);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
 	/* Read the stack pointer */
-	uint32_t pointer_casts_are_bad;
-	retval = target_read_u32(rtos->target,
-			thread_id + param->thread_stack_offset,
-			&pointer_casts_are_bad);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Error reading stack frame from FreeRTOS thread");
-		return retval;
+	struct freertos_tcb *tcb = freertos_find_tcb(freertos, thread_id);
+	if (tcb && tcb->stack_valid) {
+		stack_ptr = tcb->stack_ptr;
+	} else {
+		uint32_t pointer_casts_are_bad;
+		retval = target_read_u32(rtos->target,
+				thread_id + param->thread_stack_offset,
+				&pointer_casts_are_bad);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error reading stack frame from FreeRTOS thread");
+			return retval;
+		}
+		stack_ptr = pointer_casts_are_bad;
 	}
-	stack_ptr = pointer_casts_are_bad;
 	LOG_DEBUG("FreeRTOS: Read stack pointer at 0x%" PRIx64 ", value 0x%" PRIx64,
 										thread_id + param->thread_stack_offset,
 										stack_ptr);
 
-	/* Check for armv7m with *enabled* FPU, i.e. a Cortex-M4F */
-	int cm4_fpu_enabled = 0;
-	struct armv7m_common *armv7m_target = target_to_armv7m(rtos->target);
-	if (is_armv7m(armv7m_target)) {
-		if (armv7m_target->fp_feature == FPV4_SP) {
-			/* Found ARM v7m target which includes a FPU */
-			uint32_t cpacr;
-
-			retval = target_read_u32(rtos->target, FPU_CPACR, &cpacr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Could not read CPACR register to check FPU state");
-				return -1;
-			}
-
-			/* Check if CP10 and CP11 are set to full access. */
-			if (cpacr & 0x00F00000) {
-				/* Found target with enabled FPU */
-				cm4_fpu_enabled = 1;
-			}
-		}
-	}
-
-	if (cm4_fpu_enabled == 1) {
+	if (freertos->fpu_enabled) {
 		/* Read the LR to decide between stacking with or without FPU */
-		uint32_t lr_svc = 0;
-		retval = target_read_u32(rtos->target,
-				stack_ptr + 0x20,
-				&lr_svc);
+		uint8_t lr_buf[4];
+		retval = rtos_read_stack(rtos->target, stack_ptr + 0x20, 4, lr_buf);
 		if (retval != ERROR_OK) {
 			LOG_OUTPUT("Error reading stack frame from FreeRTOS thread");
 			return retval;
 		}
+		uint32_t lr_svc = target_buffer_get_u32(rtos->target, lr_buf);
 		if ((lr_svc & 0x10) == 0)
 			return rtos_generic_stack_read(rtos->target, param->stacking_info_cm4f_fpu, stack_ptr, reg_list, num_regs);
 		else
@@ -503,9 +899,8 @@ static int freertos_get_thread_ascii_info(struct rtos *rtos, threadid_t thread_i
 	if (rtos->rtos_specific_params == NULL)
 		return -3;
 
-	param = (const struct freertos_params *) rtos->rtos_specific_params;
+	param = ((struct freertos *) rtos->rtos_specific_params)->params;
 
-#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 	char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
 	/* Read the thread name */
@@ -543,10 +938,28 @@ static int freertos_create(struct target *target)
 {
 	for (unsigned int i = 0; i < ARRAY_SIZE(freertos_params_list); i++)
 		if (strcmp(freertos_params_list[i].target_name, target->type->name) == 0) {
-			target->rtos->rtos_specific_params = (void *)&freertos_params_list[i];
+			struct freertos *freertos = calloc(1, sizeof(struct freertos));
+			if (!freertos) {
+				LOG_ERROR("FreeRTOS: out of memory");
+				return -1;
+			}
+			freertos->params = &freertos_params_list[i];
+			target->rtos->rtos_specific_params = freertos;
 			return 0;
 		}
 
 	LOG_ERROR("Could not find target in FreeRTOS compatibility list");
 	return -1;
 }
+
+static void freertos_free_params(struct rtos *rtos)
+{
+	struct freertos *freertos = rtos->rtos_specific_params;
+
+	for (unsigned int i = 0; i < freertos->num_tcbs; i++)
+		free(freertos->tcbs[i].name);
+	free(freertos->tcbs);
+	free(freertos->items);
+	free(freertos);
+	rtos->rtos_specific_params = NULL;
+}
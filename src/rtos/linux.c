@@ -36,6 +36,23 @@
 #include "linux_header.h"
 #define PHYS
 #define MAX_THREADS 200
+
+/*  the part of task_struct holding all the fields read here */
+#define TASK_SLICE_SIZE MAX(COMM + 16, \
+		MAX(MAX(NEXT, MEM), MAX(MAX(ONCPU, PID), QAT)) + 4)
+/*  the part of thread_info holding preempt_count and cpu_context */
+#define THREAD_INFO_SLICE_SIZE MAX(PREEMPT + 4, CPU_CONT + 40)
+
+#define LINUX_PAGE_SIZE 4096
+#define LINUX_PAGE_CACHE_SIZE 256
+
+/*  virt2phys translation of a kernel page */
+struct linux_page_map {
+	uint32_t virt;
+	uint32_t phys;
+	bool valid;
+};
+
 /*  specific task  */
 struct linux_os {
 	const char *name;
@@ -51,6 +68,12 @@ struct linux_os {
 	/*  virt2phys parameter */
 	uint32_t phys_mask;
 	uint32_t phys_base;
+	/*  translations done during the current walk of the task list */
+	struct linux_page_map page_cache[LINUX_PAGE_CACHE_SIZE];
+	/*  total_forks and nr_threads when the task list was last walked */
+	uint32_t total_forks;
+	uint32_t nr_threads;
+	bool tasks_generation_valid;
 };
 
 struct current_thread {
@@ -70,6 +93,7 @@ struct threads {
 	uint32_t pid;		/* linux pid : id for identifying a thread */
 	uint32_t oncpu;		/* content cpu number in current thread */
 	uint32_t asid;		/*  filled only at creation  */
+	uint32_t next_addr;	/*  next task, filled with the task fields */
 	int64_t threadid;
 	int status;		/* dead = 1 alive = 2 current = 3 alive and current */
 	/*  value that should not change during the live of a thread ? */
@@ -110,7 +134,7 @@ static int linux_compute_virt2phys(struct target *target, target_addr_t address)
 	struct linux_os *linux_os = (struct linux_os *)
 		target->rtos->rtos_specific_params;
 	target_addr_t pa = 0;
-	int retval = target->type->virt2phys(target, address, &pa);
+	int retval = target_virt2phys(target, address, &pa);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Cannot compute linux virt2phys translation");
 		/*  fixes default address  */
@@ -124,24 +148,72 @@ static int linux_compute_virt2phys(struct target *target, target_addr_t address)
 	return ERROR_OK;
 }
 
+static void linux_flush_page_cache(struct linux_os *linux_os)
+{
+	for (unsigned int i = 0; i < LINUX_PAGE_CACHE_SIZE; i++)
+		linux_os->page_cache[i].valid = false;
+}
+
+/*  translate through the MMU once per page and walk of the task list,
+ *  falling back to the linear mapping of init_task */
+static uint32_t linux_virt2phys(struct target *target, uint32_t address)
+{
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+	uint32_t page = address & ~(LINUX_PAGE_SIZE - 1);
+	struct linux_page_map *map =
+		&linux_os->page_cache[(page / LINUX_PAGE_SIZE) % LINUX_PAGE_CACHE_SIZE];
+
+	if (!map->valid || map->virt != page) {
+		target_addr_t pa;
+
+		map->virt = page;
+		if (target_virt2phys(target, page, &pa) == ERROR_OK)
+			map->phys = pa;
+		else
+			map->phys = (page & linux_os->phys_mask) + linux_os->phys_base;
+		map->valid = true;
+	}
+
+	return map->phys + (address - page);
+}
+
 static int linux_read_memory(struct target *target,
 	uint32_t address, uint32_t size, uint32_t count,
 	uint8_t *buffer)
 {
-#ifdef PHYS
-	struct linux_os *linux_os = (struct linux_os *)
-		target->rtos->rtos_specific_params;
-	uint32_t pa = (address & linux_os->phys_mask) + linux_os->phys_base;
-#endif
 	if (address < 0xc000000) {
 		LOG_ERROR("linux awareness : address in user space");
 		return ERROR_FAIL;
 	}
 #ifdef PHYS
-	target_read_phys_memory(target, pa, size, count, buffer);
-#endif
-	target_read_memory(target, address, size, count, buffer);
+	/*  one physical read per page touched */
+	while (count > 0) {
+		uint32_t in_page = (LINUX_PAGE_SIZE - (address & (LINUX_PAGE_SIZE - 1))) / size;
+		uint32_t n = MIN(count, in_page);
+		if (n == 0) {
+			/*  element straddles a page, read it byte wise */
+			for (uint32_t i = 0; i < size; i++) {
+				int retval = target_read_phys_memory(target,
+						linux_virt2phys(target, address + i), 1, 1, buffer + i);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+			n = 1;
+		} else {
+			int retval = target_read_phys_memory(target,
+					linux_virt2phys(target, address), size, n, buffer);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		address += n * size;
+		buffer += n * size;
+		count -= n;
+	}
 	return ERROR_OK;
+#else
+	return target_read_memory(target, address, size, count, buffer);
+#endif
 }
 
 static int fill_buffer(struct target *target, uint32_t addr, uint8_t *buffer)
@@ -241,8 +313,12 @@ static bool linux_os_detect(struct target *target)
 static int linux_os_smp_init(struct target *target);
 static int linux_os_clean(struct target *target);
 #define INIT_TASK 0
+#define TOTAL_FORKS 1
+#define NR_THREADS 2
 static const char * const linux_symbol_list[] = {
 	"init_task",
+	"total_forks",	/*  optional, with nr_threads tells whether tasks changed */
+	"nr_threads",
 	NULL
 };
 
@@ -252,8 +328,10 @@ static int linux_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list
 	*symbol_list = (struct symbol_table_elem *)
 		calloc(ARRAY_SIZE(linux_symbol_list), sizeof(struct symbol_table_elem));
 
-	for (i = 0; i < ARRAY_SIZE(linux_symbol_list); i++)
+	for (i = 0; i < ARRAY_SIZE(linux_symbol_list); i++) {
 		(*symbol_list)[i].symbol_name = linux_symbol_list[i];
+		(*symbol_list)[i].optional = i != INIT_TASK;
+	}
 
 	return 0;
 }
@@ -293,58 +371,54 @@ int fill_task_pid(struct target *target, struct threads *t)
 }
 #endif
 
+static void copy_name(struct target *target, struct threads *t,
+	const uint8_t *comm)
+{
+	for (int i = 0; i < 16; i += 4) {
+		uint32_t raw_name = target_buffer_get_u32(target, comm + i);
+		t->name[i + 3] = raw_name >> 24;
+		t->name[i + 2] = raw_name >> 16;
+		t->name[i + 1] = raw_name >> 8;
+		t->name[i] = raw_name;
+	}
+	t->name[16] = 0;
+}
+
+/*  read all task_struct fields with a single translated read */
 static int fill_task(struct target *target, struct threads *t)
 {
 	int retval;
-	uint32_t pid_addr = t->base_addr + PID;
-	uint32_t mem_addr = t->base_addr + MEM;
-	uint32_t on_cpu = t->base_addr + ONCPU;
-	uint8_t *buffer = calloc(1, 4);
-	retval = fill_buffer(target, t->base_addr, buffer);
+	uint8_t task[TASK_SLICE_SIZE];
 
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->state = val;
-	} else
+	t->thread_info_addr = 0xdeadbeef;
+	retval = linux_read_memory(target, t->base_addr, 4, TASK_SLICE_SIZE / 4, task);
+	if (retval != ERROR_OK) {
 		LOG_ERROR("fill_task: unable to read memory");
+		return retval;
+	}
 
-	retval = fill_buffer(target, pid_addr, buffer);
-
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->pid = val;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
-
-	retval = fill_buffer(target, on_cpu, buffer);
-
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->oncpu = val;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
-
-	retval = fill_buffer(target, mem_addr, buffer);
+	t->state = get_buffer(target, task);
+	t->pid = get_buffer(target, task + PID);
+	t->oncpu = get_buffer(target, task + ONCPU);
+	t->thread_info_addr = get_buffer(target, task + QAT);
+	t->next_addr = get_buffer(target, task + NEXT) - NEXT;
+	copy_name(target, t, task + COMM);
 
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
+	uint32_t val = get_buffer(target, task + MEM);
 
-		if (val != 0) {
-			uint32_t asid_addr = val + MM_CTX;
-			retval = fill_buffer(target, asid_addr, buffer);
+	if (val != 0) {
+		uint8_t buffer[4];
+		uint32_t asid_addr = val + MM_CTX;
+		retval = fill_buffer(target, asid_addr, buffer);
 
-			if (retval == ERROR_OK) {
-				val = get_buffer(target, buffer);
-				t->asid = val;
-			} else
-				LOG_ERROR
-					("fill task: unable to read memory -- ASID");
+		if (retval == ERROR_OK) {
+			val = get_buffer(target, buffer);
+			t->asid = val;
 		} else
-			t->asid = 0;
+			LOG_ERROR
+				("fill task: unable to read memory -- ASID");
 	} else
-		LOG_ERROR("fill task: unable to read memory");
-
-	free(buffer);
+		t->asid = 0;
 
 	return retval;
 }
@@ -366,31 +440,7 @@ static int get_name(struct target *target, struct threads *t)
 		return ERROR_FAIL;
 	}
 
-	uint32_t raw_name = target_buffer_get_u32(target,
-			(const uint8_t *)
-			&full_name[0]);
-	t->name[3] = raw_name >> 24;
-	t->name[2] = raw_name >> 16;
-	t->name[1] = raw_name >> 8;
-	t->name[0] = raw_name;
-	raw_name =
-		target_buffer_get_u32(target, (const uint8_t *)&full_name[1]);
-	t->name[7] = raw_name >> 24;
-	t->name[6] = raw_name >> 16;
-	t->name[5] = raw_name >> 8;
-	t->name[4] = raw_name;
-	raw_name =
-		target_buffer_get_u32(target, (const uint8_t *)&full_name[2]);
-	t->name[11] = raw_name >> 24;
-	t->name[10] = raw_name >> 16;
-	t->name[9] = raw_name >> 8;
-	t->name[8] = raw_name;
-	raw_name =
-		target_buffer_get_u32(target, (const uint8_t *)&full_name[3]);
-	t->name[15] = raw_name >> 24;
-	t->name[14] = raw_name >> 16;
-	t->name[13] = raw_name >> 8;
-	t->name[12] = raw_name;
+	copy_name(target, t, (const uint8_t *)full_name);
 	return ERROR_OK;
 
 }
@@ -459,11 +509,9 @@ static int get_current(struct target *target, int create)
 					t = calloc(1, sizeof(struct threads));
 					t->base_addr = ct->TS;
 					fill_task(target, t);
-					get_name(target, t);
 					t->oncpu = cpu;
 					insert_into_threadlist(target, t);
 					t->status = 3;
-					t->thread_info_addr = 0xdeadbeef;
 					ct->threadid = t->threadid;
 					linux_os->thread_count++;
 #ifdef PID_CHECK
@@ -487,7 +535,6 @@ static struct cpu_context *cpu_context_read(struct target *target, uint32_t base
 	uint32_t *thread_info_addr_old)
 {
 	struct cpu_context *context = calloc(1, sizeof(struct cpu_context));
-	uint32_t preempt_count_addr = 0;
 	uint32_t registers[10];
 	uint8_t *buffer = calloc(1, 4);
 	uint32_t stack = base_addr + QAT;
@@ -518,11 +565,13 @@ retry:
 	} else
 		thread_info_addr = *thread_info_addr_old;
 
-	preempt_count_addr = thread_info_addr + PREEMPT;
-	retval = fill_buffer(target, preempt_count_addr, buffer);
+	/*  preempt_count and cpu_context in one read */
+	uint8_t thread_info[THREAD_INFO_SLICE_SIZE];
+	retval = linux_read_memory(target, thread_info_addr, 4,
+			THREAD_INFO_SLICE_SIZE / 4, thread_info);
 
 	if (retval == ERROR_OK)
-		context->preempt_count = get_buffer(target, buffer);
+		context->preempt_count = get_buffer(target, thread_info + PREEMPT);
 	else {
 		if (*thread_info_addr_old != 0xdeadbeef) {
 			LOG_ERROR
@@ -536,20 +585,13 @@ retry:
 			goto retry;
 		}
 
-		LOG_ERROR("cpu_context: unable to read memory");
-	}
-
-	thread_info_addr += CPU_CONT;
-
-	retval = linux_read_memory(target, thread_info_addr, 4, 10,
-			(uint8_t *) registers);
-
-	if (retval != ERROR_OK) {
 		free(buffer);
 		LOG_ERROR("cpu_context: unable to read memory\n");
 		return context;
 	}
 
+	memcpy(registers, thread_info + CPU_CONT, sizeof(registers));
+
 	context->R4 =
 		target_buffer_get_u32(target, (const uint8_t *)&registers[0]);
 	context->R5 =
@@ -683,6 +725,47 @@ static int current_base_addr(struct linux_os *linux_os, uint32_t base_addr)
 	return 0;
 }
 
+/*  Every fork bumps total_forks and every exit drops nr_threads, so
+ *  with both unchanged the task list is the same as on the last walk.
+ *  An exec changes neither, linux_task_refresh() reads the names again.
+ *  Returns true when it has to be walked again. */
+static bool linux_tasks_changed(struct target *target)
+{
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+	struct symbol_table_elem *symbols = target->rtos->symbols;
+	uint8_t buffer[4];
+	uint32_t total_forks, nr_threads;
+	bool changed;
+
+	if (!symbols || symbols[TOTAL_FORKS].address == 0 ||
+			symbols[NR_THREADS].address == 0) {
+		linux_os->tasks_generation_valid = false;
+		return true;
+	}
+
+	if (fill_buffer(target, symbols[TOTAL_FORKS].address, buffer) != ERROR_OK) {
+		linux_os->tasks_generation_valid = false;
+		return true;
+	}
+	total_forks = get_buffer(target, buffer);
+
+	if (fill_buffer(target, symbols[NR_THREADS].address, buffer) != ERROR_OK) {
+		linux_os->tasks_generation_valid = false;
+		return true;
+	}
+	nr_threads = get_buffer(target, buffer);
+
+	changed = !linux_os->tasks_generation_valid ||
+		(linux_os->total_forks != total_forks) ||
+		(linux_os->nr_threads != nr_threads);
+
+	linux_os->total_forks = total_forks;
+	linux_os->nr_threads = nr_threads;
+	linux_os->tasks_generation_valid = true;
+	return changed;
+}
+
 static int linux_get_tasks(struct target *target, int context)
 {
 	int loop = 0;
@@ -699,6 +782,9 @@ static int linux_get_tasks(struct target *target, int context)
 
 	int64_t start = timeval_ms();
 
+	linux_flush_page_cache(linux_os);
+	linux_tasks_changed(target);
+
 	struct threads *t = calloc(1, sizeof(struct threads));
 	struct threads *last = NULL;
 	t->base_addr = linux_os->init_task_addr;
@@ -708,8 +794,7 @@ static int linux_get_tasks(struct target *target, int context)
 	while (((t->base_addr != linux_os->init_task_addr) &&
 		(t->base_addr != 0)) || (loop == 0)) {
 		loop++;
-		fill_task(target, t);
-		retval = get_name(target, t);
+		retval = fill_task(target, t);
 
 		if (loop > MAX_THREADS) {
 			free(t);
@@ -739,16 +824,15 @@ static int linux_get_tasks(struct target *target, int context)
 				liste_add_task(linux_os->thread_list, t, &last);
 			/* no interest to fill the context if it is a current thread. */
 			linux_os->thread_count++;
-			t->thread_info_addr = 0xdeadbeef;
 
 			if (context)
 				t->context =
 					cpu_context_read(target, t->base_addr,
 						&t->thread_info_addr);
-			base_addr = next_task(target, t);
+			base_addr = t->next_addr;
 		} else {
 			/*LOG_INFO("thread %s is a current thread already created",t->name); */
-			base_addr = next_task(target, t);
+			base_addr = t->next_addr;
 			free(t);
 		}
 
@@ -874,9 +958,7 @@ error_handling:
 				if (fill_task(target, t) != ERROR_OK)
 					goto error_handling;
 
-				get_name(target, t);
 				insert_into_threadlist(target, t);
-				t->thread_info_addr = 0xdeadbeef;
 			}
 
 			t->status = 3;
@@ -916,6 +998,47 @@ error_handling:
 #endif
 }
 
+/*  the task list did not change since the last walk: keep it, only
+ *  identify the current threads and read the contexts again */
+static int linux_task_refresh(struct target *target, int context)
+{
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+	struct threads *thread_list;
+	int64_t start = timeval_ms();
+
+	for (thread_list = linux_os->thread_list; thread_list; thread_list = thread_list->next) {
+		if (thread_list->status)
+			thread_list->status = 1;
+
+		free(thread_list->context);
+		thread_list->context = NULL;
+	}
+
+	get_current(target, 0);
+	linux_identify_current_threads(target);
+
+	linux_os->thread_count = 0;
+	for (thread_list = linux_os->thread_list; thread_list; thread_list = thread_list->next) {
+		if (!thread_list->status)
+			continue;
+
+		/*  an exec changes comm without a fork */
+		get_name(target, thread_list);
+
+		/*  no context for current threads */
+		if (context && (thread_list->status == 1))
+			thread_list->context = cpu_context_read(target,
+					thread_list->base_addr, &thread_list->thread_info_addr);
+		linux_os->thread_count++;
+	}
+
+	LOG_INFO("task list unchanged, refresh done %" PRId64 "\n",
+		(timeval_ms() - start));
+	linux_os->threads_needs_update = 0;
+	return ERROR_OK;
+}
+
 static int linux_task_update(struct target *target, int context)
 {
 	struct linux_os *linux_os = (struct linux_os *)
@@ -923,6 +1046,12 @@ static int linux_task_update(struct target *target, int context)
 	struct threads *thread_list = linux_os->thread_list;
 	int retval;
 	int loop = 0;
+
+	linux_flush_page_cache(linux_os);
+
+	if ((linux_os->init_task_addr != 0xdeadbeef) && !linux_tasks_changed(target))
+		return linux_task_refresh(target, context);
+
 	linux_os->thread_count = 0;
 
 	/*thread_list = thread_list->next; skip init_task*/
@@ -1009,16 +1138,14 @@ static int linux_task_update(struct target *target, int context)
 		if (found == 0) {
 			uint32_t base_addr;
 			fill_task(target, t);
-			get_name(target, t);
 			retval = insert_into_threadlist(target, t);
-			t->thread_info_addr = 0xdeadbeef;
 
 			if (context)
 				t->context =
 					cpu_context_read(target, t->base_addr,
 						&t->thread_info_addr);
 
-			base_addr = next_task(target, t);
+			base_addr = t->next_addr;
 			t = calloc(1, sizeof(struct threads));
 			t->base_addr = base_addr;
 			linux_os->thread_count++;
@@ -60,6 +60,7 @@ static struct rtos_type *rtos_types[] = {
 };
 
 static int rtos_try_next(struct target *target);
+static void rtos_free_caches(struct rtos *rtos);
 
 int rtos_thread_packet(struct connection *connection, const char *packet, int packet_size);
 
@@ -79,6 +80,36 @@ static int rtos_target_for_threadid(struct connection *connection, int64_t threa
 	return ERROR_OK;
 }
 
+static int rtos_event_callback(struct target *target, enum target_event event, void *priv)
+{
+	struct target *rtos_target = priv;
+
+	if (target != rtos_target || !target->rtos)
+		return ERROR_OK;
+
+	switch (event) {
+	/* Every halt sends GDB_HALT ahead of HALTED, and GDB_HALT has the stop
+	 * reply read the thread list. This callback is registered with the
+	 * RTOS, before GDB connects, so the list is read after the bump. */
+	case TARGET_EVENT_GDB_HALT:
+	case TARGET_EVENT_RESUMED:
+	case TARGET_EVENT_DEBUG_RESUMED:
+		target->rtos->halt_generation++;
+		break;
+	case TARGET_EVENT_RESET_ASSERT:
+	case TARGET_EVENT_RESET_END:
+	case TARGET_EVENT_GDB_FLASH_ERASE_END:
+	case TARGET_EVENT_GDB_FLASH_WRITE_END:
+		target->rtos->halt_generation++;
+		target->rtos->image_generation++;
+		break;
+	default:
+		break;
+	}
+
+	return ERROR_OK;
+}
+
 static int os_alloc(struct target *target, struct rtos_type *ostype)
 {
 	struct rtos *os = target->rtos = calloc(1, sizeof(struct rtos));
@@ -96,6 +127,8 @@ static int os_alloc(struct target *target, struct rtos_type *ostype)
 	os->gdb_thread_packet = rtos_thread_packet;
 	os->gdb_target_for_threadid = rtos_target_for_threadid;
 
+	target_register_event_callback(rtos_event_callback, target);
+
 	return JIM_OK;
 }
 
@@ -104,6 +137,12 @@ static void os_free(struct target *target)
 	if (!target->rtos)
 		return;
 
+	target_unregister_event_callback(rtos_event_callback, target);
+
+	rtos_free_threadlist(target->rtos);
+	rtos_free_caches(target->rtos);
+	if (target->rtos->rtos_specific_params && target->rtos->type->free_params)
+		target->rtos->type->free_params(target->rtos);
 	free(target->rtos->symbols);
 	free(target->rtos);
 	target->rtos = NULL;
@@ -326,6 +365,17 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				return ERROR_OK;
 			}
 
+			/* GDB asks again for every "info threads", serve the
+			 * reply built the first time until the list is read again */
+			struct rtos *rtos = target->rtos;
+			if (!rtos->thread_info_cache)
+				rtos->thread_info_cache = calloc(rtos->thread_count, sizeof(char *));
+			if (rtos->thread_info_cache && rtos->thread_info_cache[found]) {
+				char *hex_str = rtos->thread_info_cache[found];
+				gdb_put_packet(connection, hex_str, strlen(hex_str));
+				return ERROR_OK;
+			}
+
 			struct thread_detail *detail = &target->rtos->thread_details[found];
 
 			int str_size = 0;
@@ -353,7 +403,10 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				strlen(tmp_str), strlen(tmp_str) * 2 + 1);
 
 			gdb_put_packet(connection, hex_str, pkt_len);
-			free(hex_str);
+			if (rtos->thread_info_cache)
+				rtos->thread_info_cache[found] = hex_str;
+			else
+				free(hex_str);
 			free(tmp_str);
 			return ERROR_OK;
 
@@ -366,7 +419,9 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
-			target->rtos->type->update_threads(target->rtos);
+			target->rtos->image_generation++;
+			rtos_invalidate_threads(target);
+			rtos_update_threads(target);
 		}
 		return ERROR_OK;
 	} else if (strncmp(packet, "qfThreadInfo", 12) == 0) {
@@ -472,6 +527,179 @@ static int rtos_put_gdb_reg_list(struct connection *connection,
 	return ERROR_OK;
 }
 
+static void rtos_free_caches(struct rtos *rtos)
+{
+	for (unsigned int i = 0; i < rtos->stack_cache_count; i++)
+		free(rtos->stack_cache[i].data);
+	free(rtos->stack_cache);
+	rtos->stack_cache = NULL;
+	rtos->stack_cache_count = 0;
+
+	for (unsigned int i = 0; i < rtos->regs_cache_count; i++)
+		free(rtos->regs_cache[i].reg_list);
+	free(rtos->regs_cache);
+	rtos->regs_cache = NULL;
+	rtos->regs_cache_count = 0;
+}
+
+/* Drop what was cached before the target last ran */
+static void rtos_check_caches(struct rtos *rtos)
+{
+	if (rtos->cache_generation != rtos->halt_generation) {
+		rtos_free_caches(rtos);
+		rtos->cache_generation = rtos->halt_generation;
+	}
+}
+
+static const struct rtos_stack_frame *rtos_find_stack(struct rtos *rtos,
+		target_addr_t address, uint32_t size)
+{
+	for (unsigned int i = 0; i < rtos->stack_cache_count; i++) {
+		const struct rtos_stack_frame *frame = &rtos->stack_cache[i];
+		if (address >= frame->address &&
+				address + size <= frame->address + frame->size)
+			return frame;
+	}
+	return NULL;
+}
+
+/* Takes over data on success */
+static int rtos_add_stack(struct rtos *rtos, target_addr_t address,
+		uint32_t size, uint8_t *data)
+{
+	struct rtos_stack_frame *stack_cache = realloc(rtos->stack_cache,
+			(rtos->stack_cache_count + 1) * sizeof(*stack_cache));
+	if (!stack_cache)
+		return ERROR_FAIL;
+
+	rtos->stack_cache = stack_cache;
+	stack_cache[rtos->stack_cache_count].address = address;
+	stack_cache[rtos->stack_cache_count].size = size;
+	stack_cache[rtos->stack_cache_count].data = data;
+	rtos->stack_cache_count++;
+	return ERROR_OK;
+}
+
+/** Read thread stack memory, served from the frames already read during
+ * this halt if they cover it. */
+int rtos_read_stack(struct target *target, target_addr_t address, uint32_t size,
+		uint8_t *buffer)
+{
+	struct rtos *rtos = target->rtos;
+	int retval;
+
+	if (rtos == NULL)
+		return target_read_buffer(target, address, size, buffer);
+
+	rtos_check_caches(rtos);
+
+	const struct rtos_stack_frame *frame = rtos_find_stack(rtos, address, size);
+	if (frame) {
+		memcpy(buffer, frame->data + (address - frame->address), size);
+		return ERROR_OK;
+	}
+
+	retval = target_read_buffer(target, address, size, buffer);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint8_t *data = malloc(size);
+	if (data) {
+		memcpy(data, buffer, size);
+		if (rtos_add_stack(rtos, address, size, data) != ERROR_OK)
+			free(data);
+	}
+	return ERROR_OK;
+}
+
+/** Read the stacked frames of many threads with one gathered read, for
+ * rtos_generic_stack_read() and rtos_read_stack() to find them later in
+ * this halt. */
+int rtos_prefetch_stack_frames(struct target *target,
+		const struct rtos_register_stacking *stacking,
+		const int64_t *stack_ptrs, unsigned int count)
+{
+	struct rtos *rtos = target->rtos;
+	uint32_t size = stacking->stack_registers_size;
+	unsigned int num_reads = 0;
+	int retval;
+
+	if ((rtos == NULL) || (count == 0))
+		return ERROR_OK;
+
+	rtos_check_caches(rtos);
+
+	struct target_memory_read *reads = calloc(count, sizeof(*reads));
+	if (!reads)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		target_addr_t address = stack_ptrs[i];
+
+		if (address == 0)
+			continue;
+		if (stacking->stack_growth_direction == 1)
+			address -= size;
+		if (rtos_find_stack(rtos, address, size))
+			continue;
+
+		reads[num_reads].buffer = malloc(size);
+		if (!reads[num_reads].buffer)
+			break;
+		reads[num_reads].address = address;
+		reads[num_reads].size = size;
+		num_reads++;
+	}
+
+	LOG_DEBUG("RTOS: prefetching %u stack frames", num_reads);
+	retval = target_read_buffers(target, reads, num_reads);
+
+	for (unsigned int i = 0; i < num_reads; i++) {
+		if ((retval != ERROR_OK) || (rtos_add_stack(rtos, reads[i].address,
+				reads[i].size, reads[i].buffer) != ERROR_OK))
+			free(reads[i].buffer);
+	}
+
+	free(reads);
+	return retval;
+}
+
+/* Registers of a thread which isn't running, read once per halt. The list
+ * stays owned by the cache. */
+static int rtos_get_thread_regs(struct rtos *rtos, int64_t threadid,
+		struct rtos_reg **reg_list, int *num_regs)
+{
+	int retval;
+
+	rtos_check_caches(rtos);
+
+	for (unsigned int i = 0; i < rtos->regs_cache_count; i++) {
+		if (rtos->regs_cache[i].threadid == threadid) {
+			*reg_list = rtos->regs_cache[i].reg_list;
+			*num_regs = rtos->regs_cache[i].num_regs;
+			return ERROR_OK;
+		}
+	}
+
+	retval = rtos->type->get_thread_reg_list(rtos, threadid, reg_list, num_regs);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct rtos_thread_regs *regs_cache = realloc(rtos->regs_cache,
+			(rtos->regs_cache_count + 1) * sizeof(*regs_cache));
+	if (!regs_cache) {
+		free(*reg_list);
+		return ERROR_FAIL;
+	}
+
+	rtos->regs_cache = regs_cache;
+	regs_cache[rtos->regs_cache_count].threadid = threadid;
+	regs_cache[rtos->regs_cache_count].reg_list = *reg_list;
+	regs_cache[rtos->regs_cache_count].num_regs = *num_regs;
+	rtos->regs_cache_count++;
+	return ERROR_OK;
+}
+
 /** Look through all registers to find this register. */
 int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 {
@@ -498,28 +726,30 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 					current_threadid, reg_num, &reg_list[0]);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("RTOS: failed to get register %d", reg_num);
+				free(reg_list);
 				return retval;
 			}
-		} else {
-			retval = target->rtos->type->get_thread_reg_list(target->rtos,
-					current_threadid,
-					&reg_list,
-					&num_regs);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("RTOS: failed to get register list");
-				return retval;
-			}
+			if (reg_list[0].number == (uint32_t)reg_num)
+				rtos_put_gdb_reg_list(connection, reg_list, 1);
+			else
+				retval = ERROR_FAIL;
+			free(reg_list);
+			return retval;
+		}
+
+		retval = rtos_get_thread_regs(target->rtos, current_threadid,
+				&reg_list, &num_regs);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("RTOS: failed to get register list");
+			return retval;
 		}
 
 		for (int i = 0; i < num_regs; ++i) {
 			if (reg_list[i].number == (uint32_t)reg_num) {
 				rtos_put_gdb_reg_list(connection, reg_list + i, 1);
-				free(reg_list);
 				return ERROR_OK;
 			}
 		}
-
-		free(reg_list);
 	}
 	return ERROR_FAIL;
 }
@@ -541,17 +771,14 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 										current_threadid,
 										target->rtos->current_thread);
 
-		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
-				current_threadid,
-				&reg_list,
-				&num_regs);
+		int retval = rtos_get_thread_regs(target->rtos, current_threadid,
+				&reg_list, &num_regs);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("RTOS: failed to get register list");
 			return retval;
 		}
 
 		rtos_put_gdb_reg_list(connection, reg_list, num_regs);
-		free(reg_list);
 
 		return ERROR_OK;
 	}
@@ -563,6 +790,7 @@ int rtos_set_reg(struct connection *connection, int reg_num,
 {
 	struct target *target = get_target_from_connection(connection);
 	int64_t current_threadid = target->rtos->current_threadid;
+	rtos_invalidate_threads(target);
 	if ((target->rtos != NULL) &&
 			(target->rtos->type->set_reg != NULL) &&
 			(current_threadid != -1) &&
@@ -590,7 +818,7 @@ int rtos_generic_stack_read(struct target *target,
 
 	if (stacking->stack_growth_direction == 1)
 		address -= stacking->stack_registers_size;
-	retval = target_read_buffer(target, address, stacking->stack_registers_size, stack_data);
+	retval = rtos_read_stack(target, address, stacking->stack_registers_size, stack_data);
 	if (retval != ERROR_OK) {
 		free(stack_data);
 		LOG_ERROR("Error reading stack frame from thread");
@@ -655,15 +883,54 @@ static int rtos_try_next(struct target *target)
 	return 1;
 }
 
+/* Read the thread list at most once per halt. GDB requests it on the stop
+ * reply, on attach and before continuing, usually without the target
+ * having run in between. */
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos != NULL) && (target->rtos->type != NULL))
-		target->rtos->type->update_threads(target->rtos);
+	struct rtos *rtos = target->rtos;
+
+	if ((rtos == NULL) || (rtos->type == NULL))
+		return ERROR_OK;
+
+	if (rtos->threads_valid) {
+		if (rtos->threads_generation == rtos->halt_generation)
+			return ERROR_OK;
+
+		if (rtos->type->threads_changed && !rtos->type->threads_changed(rtos)) {
+			LOG_DEBUG("RTOS: thread list unchanged");
+			rtos->threads_generation = rtos->halt_generation;
+			return ERROR_OK;
+		}
+	}
+
+	rtos->threads_valid = false;
+	if (rtos->type->update_threads(rtos) == ERROR_OK) {
+		rtos->threads_valid = true;
+		rtos->threads_generation = rtos->halt_generation;
+	}
 	return ERROR_OK;
 }
 
+/* Have the next rtos_update_threads() read the thread list again, and
+ * drop everything read from the target during this halt */
+void rtos_invalidate_threads(struct target *target)
+{
+	if (target->rtos) {
+		target->rtos->threads_valid = false;
+		target->rtos->halt_generation++;
+	}
+}
+
 void rtos_free_threadlist(struct rtos *rtos)
 {
+	if (rtos->thread_info_cache) {
+		for (int j = 0; j < rtos->thread_count; j++)
+			free(rtos->thread_info_cache[j]);
+		free(rtos->thread_info_cache);
+		rtos->thread_info_cache = NULL;
+	}
+
 	if (rtos->thread_details) {
 		int j;
 
@@ -691,6 +958,8 @@ int rtos_read_buffer(struct target *target, target_addr_t address,
 int rtos_write_buffer(struct target *target, target_addr_t address,
 		uint32_t size, const uint8_t *buffer)
 {
+	/* GDB may have written a task list or a stack */
+	rtos_invalidate_threads(target);
 	if (target->rtos->type->write_buffer)
 		return target->rtos->type->write_buffer(target->rtos, address, size, buffer);
 	return ERROR_NOT_IMPLEMENTED;
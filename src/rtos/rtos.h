@@ -44,6 +44,20 @@ struct thread_detail {
 	char *extra_info_str;
 };
 
+/* Stack memory read while the target is halted */
+struct rtos_stack_frame {
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *data;
+};
+
+/* Registers of a thread as returned by get_thread_reg_list */
+struct rtos_thread_regs {
+	threadid_t threadid;
+	struct rtos_reg *reg_list;
+	int num_regs;
+};
+
 struct rtos {
 	const struct rtos_type *type;
 
@@ -59,6 +73,25 @@ struct rtos {
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
+	/* Counts halts, resumes and resets of the target, and writes from GDB.
+	 * The thread list is read again only when this moved since
+	 * threads_generation. */
+	unsigned int halt_generation;
+	unsigned int threads_generation;
+	/* Counts resets, flash writes from GDB and symbol lookups, anything
+	 * that may have replaced the program. Values RTOS drivers read once,
+	 * as constant while the program runs, are read again when this moved. */
+	unsigned int image_generation;
+	bool threads_valid;
+	/* qThreadExtraInfo replies, hex encoded, per entry of thread_details */
+	char **thread_info_cache;
+	/* Stack frames and thread registers read during halt_generation
+	 * cache_generation, dropped when the target runs or memory is written */
+	unsigned int cache_generation;
+	struct rtos_stack_frame *stack_cache;
+	unsigned int stack_cache_count;
+	struct rtos_thread_regs *regs_cache;
+	unsigned int regs_cache_count;
 };
 
 struct rtos_reg {
@@ -73,6 +106,10 @@ struct rtos_type {
 	int (*create)(struct target *target);
 	int (*smp_init)(struct target *target);
 	int (*update_threads)(struct rtos *rtos);
+	/** Optional. Called once per halt before update_threads. Return false only
+	 * if the thread list read last time is known to be still accurate, to
+	 * skip reading it again. */
+	bool (*threads_changed)(struct rtos *rtos);
 	/** Return a list of general registers, with their values filled out. */
 	int (*get_thread_reg_list)(struct rtos *rtos, int64_t thread_id,
 			struct rtos_reg **reg_list, int *num_regs);
@@ -80,6 +117,9 @@ struct rtos_type {
 			uint32_t reg_num, struct rtos_reg *reg);
 	int (*get_symbol_list_to_lookup)(struct symbol_table_elem *symbol_list[]);
 	int (*clean)(struct target *target);
+	/** Optional. Frees rtos_specific_params when the RTOS is removed, for
+	 * drivers allocating it in create. */
+	void (*free_params)(struct rtos *rtos);
 	char * (*ps_command)(struct target *target);
 	int (*set_reg)(struct rtos *rtos, uint32_t reg_num, uint8_t *reg_value);
 	/* Implement these if different threads in the RTOS can see memory
@@ -126,10 +166,16 @@ int rtos_generic_stack_read(struct target *target,
 		int64_t stack_ptr,
 		struct rtos_reg **reg_list,
 		int *num_regs);
+int rtos_read_stack(struct target *target, target_addr_t address, uint32_t size,
+		uint8_t *buffer);
+int rtos_prefetch_stack_frames(struct target *target,
+		const struct rtos_register_stacking *stacking,
+		const int64_t *stack_ptrs, unsigned int count);
 int gdb_thread_packet(struct connection *connection, char const *packet, int packet_size);
 int rtos_get_gdb_reg(struct connection *connection, int reg_num);
 int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
+void rtos_invalidate_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
 int rtos_smp_init(struct target *target);
 /*  function for handling symbol access */
@@ -1019,6 +1019,7 @@ static int gdb_new_connection(struct connection *connection)
 			target->rtos->type->clean(target);
 
 		/* update threads */
+		rtos_invalidate_threads(target);
 		rtos_update_threads(target);
 	}
 
@@ -443,6 +443,9 @@ int server_loop(struct command_context *command_context)
 #endif
 
 	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
+		/* busy connections keep the loop from going idle */
+		log_flush_aged();
+
 		/* monitor sockets for activity */
 		fd_max = 0;
 		FD_ZERO(&read_fds);
@@ -477,11 +480,19 @@ int server_loop(struct command_context *command_context)
 			tv.tv_usec = 0;
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		} else {
-			/* Every 100ms, can be changed with "poll_period" command */
-			tv.tv_usec = polling_period * 1000;
+			/* Every 100ms, can be changed with "poll_period" command,
+			 * or earlier if a target timer expires */
+			int64_t timeout_ms = target_timer_next_event() - timeval_ms();
+			if (timeout_ms < 0)
+				timeout_ms = 0;
+			else if (timeout_ms > polling_period)
+				timeout_ms = polling_period;
+			tv.tv_sec = timeout_ms / 1000;
+			tv.tv_usec = (timeout_ms % 1000) * 1000;
 			/* Only while we're sleeping we'll let others run */
 			openocd_sleep_prelude();
 			kept_alive();
+			log_flush();
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 			openocd_sleep_postlude();
 		}
@@ -598,6 +609,10 @@ int server_loop(struct command_context *command_context)
 
 static void sig_handler(int sig)
 {
+	/* abort() ends the process as soon as this returns */
+	if (sig == SIGABRT)
+		log_flush();
+
 	/* store only first signal that hits us */
 	if (shutdown_openocd == CONTINUE_MAIN_LOOP) {
 		shutdown_openocd = SHUTDOWN_WITH_SIGNAL_CODE;
@@ -718,6 +733,8 @@ void server_free(void)
 
 void exit_on_signal(int sig)
 {
+	log_flush();
+
 #ifndef _WIN32
 	/* bring back default system handler and kill yourself */
 	signal(sig, SIG_DFL);
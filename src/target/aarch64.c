@@ -511,16 +511,29 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
  * Aarch64 Run control
  */
 
+static int aarch64_queue_poll(struct target *target)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+
+	return mem_ap_queue_poll_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_PRSR, &aarch64->prsr_poll);
+}
+
 static int aarch64_poll(struct target *target)
 {
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
 	enum target_state prev_target_state;
 	int retval = ERROR_OK;
+	uint32_t prsr;
 	int halted;
 
-	retval = aarch64_check_state_one(target,
-				PRSR_HALT, PRSR_HALT, &halted, NULL);
+	retval = mem_ap_poll_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_PRSR, &aarch64->prsr_poll, &prsr);
 	if (retval != ERROR_OK)
 		return retval;
+	halted = (prsr & PRSR_HALT) == PRSR_HALT;
 
 	if (halted) {
 		prev_target_state = target->state;
@@ -3169,6 +3182,7 @@ struct target_type aarch64_target = {
 	.name = "aarch64",
 
 	.poll = aarch64_poll,
+	.queue_poll = aarch64_queue_poll,
 	.arch_state = armv8_arch_state,
 
 	.halt = aarch64_halt,
@@ -56,6 +56,9 @@ struct aarch64_common {
 	uint32_t system_control_reg;
 	uint32_t system_control_reg_curr;
 
+	/* PRSR read queued ahead of the poll */
+	struct adiv5_poll prsr_poll;
+
 	/* Breakpoint register pairs */
 	int brp_num_context;
 	int brp_num;
@@ -277,6 +277,60 @@ int mem_ap_read_atomic_u32(struct adiv5_ap *ap, target_addr_t address,
 	return dap_run(ap->dap);
 }
 
+/**
+ * Queue the read of a status register ahead of a poll. Reads queued for
+ * several cores on the same DAP are all done by the first dap_run().
+ *
+ * @param ap The MEM-AP to access.
+ * @param address Address of the 32-bit word to read.
+ * @param poll Receives the value, to be passed to mem_ap_poll_u32().
+ *
+ * @return ERROR_OK for success.  Otherwise a fault code.
+ */
+int mem_ap_queue_poll_u32(struct adiv5_ap *ap, target_addr_t address,
+		struct adiv5_poll *poll)
+{
+	int retval = mem_ap_read_u32(ap, address, &poll->value);
+
+	poll->queued = (retval == ERROR_OK);
+	poll->run = ap->dap->run_count + 1;
+	return retval;
+}
+
+/**
+ * Synchronous read of a status register, using the value queued by
+ * mem_ap_queue_poll_u32() if no other run of the DAP came in between and
+ * the run fetching it succeeded. Otherwise the register is read again.
+ *
+ * @param ap The MEM-AP to access.
+ * @param address Address of the 32-bit word to read.
+ * @param poll The prefetched value, if any.
+ * @param value points to where the result will be stored.
+ *
+ * @return ERROR_OK for success; *value holds the result.
+ * Otherwise returns an error code.
+ */
+int mem_ap_poll_u32(struct adiv5_ap *ap, target_addr_t address,
+		struct adiv5_poll *poll, uint32_t *value)
+{
+	if (poll->queued) {
+		poll->queued = false;
+
+		/* still in the queue, run it along with the other cores */
+		if (ap->dap->run_count + 1 == poll->run)
+			dap_run(ap->dap);
+
+		/* a fault in any access of the run fails it as a whole, so this
+		 * core's register is read again on its own below */
+		if ((ap->dap->run_count == poll->run) && (ap->dap->run_result == ERROR_OK)) {
+			*value = poll->value;
+			return ERROR_OK;
+		}
+	}
+
+	return mem_ap_read_atomic_u32(ap, address, value);
+}
+
 /**
  * Asynchronous (queued) write of a word to memory or a system register.
  *
@@ -329,7 +383,8 @@ int mem_ap_write_atomic_u32(struct adiv5_ap *ap, target_addr_t address,
 }
 
 /**
- * Synchronous write of a block of memory, using a specific access size.
+ * Asynchronous (queued) write of a block of memory, using a specific access size.
+ * The transfers are only queued; the caller has to flush them with dap_run().
  *
  * @param ap The MEM-AP to access.
  * @param buffer The data buffer to write. No particular alignment is assumed.
@@ -340,7 +395,7 @@ int mem_ap_write_atomic_u32(struct adiv5_ap *ap, target_addr_t address,
  *  should normally be true, except when writing to e.g. a FIFO.
  * @return ERROR_OK on success, otherwise an error code.
  */
-static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+static int mem_ap_queue_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
 		target_addr_t address, bool addrinc)
 {
 	struct adiv5_dap *dap = ap->dap;
@@ -443,9 +498,28 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 			address += this_size;
 	}
 
-	/* REVISIT: Might want to have a queued version of this function that does not run. */
+	return retval;
+}
+
+/**
+ * Synchronous write of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to write. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2 or 4.
+ * @param count The number of writes to do (in size units, not bytes).
+ * @param address Address to be written; it must be writable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased for each write or not. This
+ *  should normally be true, except when writing to e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t address, bool addrinc)
+{
+	int retval = mem_ap_queue_write(ap, buffer, size, count, address, addrinc);
+
 	if (retval == ERROR_OK)
-		retval = dap_run(dap);
+		retval = dap_run(ap->dap);
 
 	if (retval != ERROR_OK) {
 		target_addr_t tar;
@@ -620,6 +694,39 @@ int mem_ap_write_buf(struct adiv5_ap *ap,
 	return mem_ap_write(ap, buffer, size, count, address, true);
 }
 
+int mem_ap_queue_read_buf_u32(struct adiv5_ap *ap,
+		uint32_t *buffer, uint32_t count, target_addr_t address)
+{
+	int retval = ERROR_OK;
+
+	while (count > 0) {
+		retval = mem_ap_setup_csw(ap, CSW_32BIT | CSW_ADDRINC_SINGLE);
+		if (retval != ERROR_OK)
+			break;
+
+		retval = mem_ap_setup_tar(ap, address);
+		if (retval != ERROR_OK)
+			break;
+
+		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, buffer++);
+		if (retval != ERROR_OK)
+			break;
+
+		address += 4;
+		count--;
+
+		mem_ap_update_tar_cache(ap);
+	}
+
+	return retval;
+}
+
+int mem_ap_queue_write_buf(struct adiv5_ap *ap,
+		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address)
+{
+	return mem_ap_queue_write(ap, buffer, size, count, address, true);
+}
+
 int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
 		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address)
 {
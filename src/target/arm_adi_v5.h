@@ -304,6 +304,22 @@ struct adiv5_dap {
 	/** Flag saying whether to ignore the syspwrupack flag in DAP. Some devices
 	 *  do not set this bit until later in the bringup sequence */
 	bool ignore_syspwrupack;
+
+	/** Number of dap_run() calls and result of the last one, tell whether
+	 *  a prefetched poll value is valid and still the latest access. */
+	unsigned int run_count;
+	int run_result;
+};
+
+/**
+ * A status register read queued ahead of a target poll, so the reads for
+ * all cores behind a DAP go out in a single dap_run().
+ */
+struct adiv5_poll {
+	uint32_t value;
+	/* value of dap->run_count after the run fetching value */
+	unsigned int run;
+	bool queued;
 };
 
 /**
@@ -496,7 +512,9 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops != NULL);
-	return dap->ops->run(dap);
+	dap->run_count++;
+	dap->run_result = dap->ops->run(dap);
+	return dap->run_result;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
@@ -555,6 +573,10 @@ int mem_ap_write_u32(struct adiv5_ap *ap,
 		target_addr_t address, uint32_t value);
 
 /* Synchronous MEM-AP memory mapped single word transfers. */
+int mem_ap_queue_poll_u32(struct adiv5_ap *ap, target_addr_t address,
+		struct adiv5_poll *poll);
+int mem_ap_poll_u32(struct adiv5_ap *ap, target_addr_t address,
+		struct adiv5_poll *poll, uint32_t *value);
 int mem_ap_read_atomic_u32(struct adiv5_ap *ap,
 		target_addr_t address, uint32_t *value);
 int mem_ap_write_atomic_u32(struct adiv5_ap *ap,
@@ -566,6 +588,14 @@ int mem_ap_read_buf(struct adiv5_ap *ap,
 int mem_ap_write_buf(struct adiv5_ap *ap,
 		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
 
+/* Queued MEM-AP memory mapped bus block transfer, flushed by dap_run(). */
+int mem_ap_queue_write_buf(struct adiv5_ap *ap,
+		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
+/* Queued read of aligned 32 bit words. @a buffer receives the raw DRW values
+ * (bus byte order) and is only valid after a successful dap_run(). */
+int mem_ap_queue_read_buf_u32(struct adiv5_ap *ap,
+		uint32_t *buffer, uint32_t count, target_addr_t address);
+
 /* Synchronous, non-incrementing buffer functions for accessing fifos. */
 int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
 		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
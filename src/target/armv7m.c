@@ -44,6 +44,7 @@
 #include "algorithm.h"
 #include "register.h"
 #include "semihosting_common.h"
+#include "image.h"
 
 #if 0
 #define _DEBUG_INSTRUCTION_EXECUTION_
@@ -873,15 +874,303 @@ int armv7m_init_arch_info(struct target *target, struct armv7m_common *armv7m)
 	return arm_init_arch_info(target, arm);
 }
 
-/** Generates a CRC32 checksum of a memory region. */
+/* Runs a CRC loader taking r0 = address in / crc out, r1 = count, r2 = param */
+static int armv7m_run_crc_algorithm(struct target *target,
+	struct working_area *crc_algorithm, uint32_t exit_offset,
+	target_addr_t address, uint32_t count, uint32_t param,
+	uint32_t size, uint32_t *checksum)
+{
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[3];
+	int retval;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+	buf_set_u32(reg_params[2].value, 0, 32, param);
+
+	int timeout = 20000 * (1 + (size / (1024 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			crc_algorithm->address, crc_algorithm->address + exit_offset,
+			timeout, &armv7m_info);
+
+	if (retval == ERROR_OK)
+		*checksum = buf_get_u32(reg_params[0].value, 0, 32);
+	else
+		LOG_ERROR("error executing cortex_m crc algorithm");
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+
+	return retval;
+}
+
+/* Checks a CRC loader once against image_calculate_checksum(), using the
+ * first @a size bytes of its own code as test data */
+static int armv7m_check_crc_algorithm(struct target *target,
+	struct working_area *crc_algorithm, uint32_t exit_offset,
+	const uint8_t *code, uint32_t size, uint32_t count, uint32_t param,
+	enum armv7m_crc_state *state, const char *name)
+{
+	uint32_t expected, checksum;
+
+	if (*state != ARMV7M_CRC_UNTESTED)
+		return ERROR_OK;
+
+	int retval = image_calculate_checksum(code, size, &expected);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = armv7m_run_crc_algorithm(target, crc_algorithm, exit_offset,
+			crc_algorithm->address, count, param, size, &checksum);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (checksum == expected) {
+		*state = ARMV7M_CRC_OK;
+	} else {
+		LOG_WARNING("%s CRC gave 0x%08" PRIx32 " instead of 0x%08" PRIx32 ", not using it",
+				name, checksum, expected);
+		*state = ARMV7M_CRC_BROKEN;
+	}
+
+	return ERROR_OK;
+}
+
+/* Continues a CRC over a few bytes on the host */
+static uint32_t armv7m_crc_update(uint32_t crc, const uint8_t *buffer, uint32_t size)
+{
+	while (size--) {
+		crc ^= (uint32_t)*buffer++ << 24;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+	}
+	return crc;
+}
+
+/* STM32 CRC unit registers, INIT and POL only on some parts */
+#define ARMV7M_CRC_DR		0x00
+#define ARMV7M_CRC_CR		0x08
+#define ARMV7M_CRC_INIT		0x10
+#define ARMV7M_CRC_POL		0x14
+#define ARMV7M_CRC_CR_RESET	1
+
+/* Saves the CRC unit state the application may be using and sets it up
+ * for the loader, which expects the reset value of INIT and POL */
+static int armv7m_crc_unit_save(struct target *target,
+	struct armv7m_crc_unit *unit, uint32_t saved[4])
+{
+	int retval = target_read_u32(target, unit->base + ARMV7M_CRC_DR, &saved[0]);
+	if (retval == ERROR_OK)
+		retval = target_read_u32(target, unit->base + ARMV7M_CRC_CR, &saved[1]);
+	if (retval != ERROR_OK || !unit->has_init_pol)
+		return retval;
+
+	retval = target_read_u32(target, unit->base + ARMV7M_CRC_INIT, &saved[2]);
+	if (retval == ERROR_OK)
+		retval = target_read_u32(target, unit->base + ARMV7M_CRC_POL, &saved[3]);
+	if (retval == ERROR_OK)
+		retval = target_write_u32(target, unit->base + ARMV7M_CRC_INIT, 0xffffffff);
+	if (retval == ERROR_OK)
+		retval = target_write_u32(target, unit->base + ARMV7M_CRC_POL, 0x04c11db7);
+	return retval;
+}
+
+static int armv7m_crc_unit_restore(struct target *target,
+	struct armv7m_crc_unit *unit, const uint32_t saved[4])
+{
+	/* DR can't be written directly: reset it and feed it the one word
+	 * which takes 0xffffffff to the saved value, by running the CRC
+	 * backwards over it */
+	uint32_t word = saved[0];
+	for (int i = 0; i < 32; i++)
+		word = (word & 1) ? ((word ^ 0x04c11db7) >> 1) | 0x80000000 : word >> 1;
+	word ^= 0xffffffff;
+
+	int retval = target_write_u32(target, unit->base + ARMV7M_CRC_CR,
+			ARMV7M_CRC_CR_RESET);
+	if (retval == ERROR_OK)
+		retval = target_write_u32(target, unit->base + ARMV7M_CRC_DR, word);
+	if (retval == ERROR_OK && unit->has_init_pol) {
+		retval = target_write_u32(target, unit->base + ARMV7M_CRC_INIT, saved[2]);
+		if (retval == ERROR_OK)
+			retval = target_write_u32(target, unit->base + ARMV7M_CRC_POL, saved[3]);
+	}
+	/* the reset bit always reads as 0, this doesn't reset DR again */
+	if (retval == ERROR_OK)
+		retval = target_write_u32(target, unit->base + ARMV7M_CRC_CR, saved[1]);
+	return retval;
+}
+
+/* CRC using the peripheral registered with armv7m_set_crc_unit() */
+static int armv7m_checksum_memory_hw(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct armv7m_crc_unit *unit = &target_to_armv7m(target)->crc_unit;
+	struct working_area *crc_algorithm;
+	uint32_t clk_enable = 0;
+	uint32_t saved[4];
+	uint8_t tail[3];
+	int retval, retval2;
+
+	static const uint8_t cortex_m_crc_hw_code[] = {
+#include "../../contrib/loaders/checksum/armv7m_crc_hw.inc"
+	};
+	const uint32_t code_size = sizeof(cortex_m_crc_hw_code);
+
+	if (unit->state == ARMV7M_CRC_BROKEN)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (target_alloc_working_area_try(target, code_size, &crc_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, crc_algorithm->address, code_size,
+			cortex_m_crc_hw_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	/* the unit may be clock gated, enable it for the duration */
+	if (unit->clk_enable_reg) {
+		retval = target_read_u32(target, unit->clk_enable_reg, &clk_enable);
+		if (retval != ERROR_OK)
+			goto cleanup;
+		if ((clk_enable & unit->clk_enable_mask) != unit->clk_enable_mask) {
+			retval = target_write_u32(target, unit->clk_enable_reg,
+					clk_enable | unit->clk_enable_mask);
+			if (retval != ERROR_OK)
+				goto cleanup;
+		}
+	}
+
+	retval = armv7m_crc_unit_save(target, unit, saved);
+	if (retval != ERROR_OK)
+		goto cleanup_clk;
+
+	retval = armv7m_check_crc_algorithm(target, crc_algorithm, code_size - 2,
+			cortex_m_crc_hw_code, code_size & ~3u, code_size / 4, unit->base,
+			&unit->state, "hardware");
+	if (retval != ERROR_OK)
+		goto cleanup_crc;
+	if (unit->state != ARMV7M_CRC_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup_crc;
+	}
+
+	retval = armv7m_run_crc_algorithm(target, crc_algorithm, code_size - 2,
+			address, count / 4, unit->base, count, checksum);
+	if (retval != ERROR_OK)
+		goto cleanup_crc;
+
+	/* the unit only takes whole words, do the rest here */
+	if (count & 3) {
+		retval = target_read_buffer(target, address + (count & ~3u), count & 3, tail);
+		if (retval == ERROR_OK)
+			*checksum = armv7m_crc_update(*checksum, tail, count & 3);
+	}
+
+cleanup_crc:
+	retval2 = armv7m_crc_unit_restore(target, unit, saved);
+	if (retval == ERROR_OK)
+		retval = retval2;
+cleanup_clk:
+	if ((clk_enable & unit->clk_enable_mask) != unit->clk_enable_mask)
+		target_write_u32(target, unit->clk_enable_reg, clk_enable);
+cleanup:
+	target_free_working_area(target, crc_algorithm);
+
+	return retval;
+}
+
+/* Table driven CRC, the 1 KiB table is built by the loader in working area */
+static int armv7m_checksum_memory_table(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct working_area *crc_algorithm;
+	struct working_area *crc_table;
+	int retval;
+
+	static const uint8_t cortex_m_crc_table_code[] = {
+#include "../../contrib/loaders/checksum/armv7m_crc_table.inc"
+	};
+	const uint32_t code_size = sizeof(cortex_m_crc_table_code);
+
+	if (armv7m->crc_table_state == ARMV7M_CRC_BROKEN)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (target_alloc_working_area_try(target, code_size, &crc_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (target_alloc_working_area_try(target, 256 * sizeof(uint32_t), &crc_table) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup1;
+	}
+
+	retval = target_write_buffer(target, crc_algorithm->address, code_size,
+			cortex_m_crc_table_code);
+	if (retval != ERROR_OK)
+		goto cleanup2;
+
+	retval = armv7m_check_crc_algorithm(target, crc_algorithm, code_size - 6,
+			cortex_m_crc_table_code, code_size, code_size, crc_table->address,
+			&armv7m->crc_table_state, "table driven");
+	if (retval != ERROR_OK)
+		goto cleanup2;
+	if (armv7m->crc_table_state != ARMV7M_CRC_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup2;
+	}
+
+	retval = armv7m_run_crc_algorithm(target, crc_algorithm, code_size - 6,
+			address, count, crc_table->address, count, checksum);
+
+cleanup2:
+	target_free_working_area(target, crc_table);
+cleanup1:
+	target_free_working_area(target, crc_algorithm);
+
+	return retval;
+}
+
+/* CRC using the CRC unit or the table driven loader, whichever works first */
+static int armv7m_checksum_memory_fast(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	int retval;
+
+	if (armv7m->crc_unit.base && !(address & 3) && count >= 4) {
+		retval = armv7m_checksum_memory_hw(target, address, count, checksum);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+	}
+
+	return armv7m_checksum_memory_table(target, address, count, checksum);
+}
+
+/**
+ * Generates a CRC32 checksum of a memory region. Uses the CRC unit if one
+ * was registered, else the table driven loader when the working area can
+ * hold its table, else the bitwise one.
+ */
 int armv7m_checksum_memory(struct target *target,
 	target_addr_t address, uint32_t count, uint32_t *checksum)
 {
 	struct working_area *crc_algorithm;
-	struct armv7m_algorithm armv7m_info;
-	struct reg_param reg_params[2];
 	int retval;
 
+	retval = armv7m_checksum_memory_fast(target, address, count, checksum);
+	if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		return retval;
+
 	static const uint8_t cortex_m_crc_code[] = {
 #include "../../contrib/loaders/checksum/armv7m_crc.inc"
 	};
@@ -892,45 +1181,174 @@ int armv7m_checksum_memory(struct target *target,
 
 	retval = target_write_buffer(target, crc_algorithm->address,
 			sizeof(cortex_m_crc_code), (uint8_t *)cortex_m_crc_code);
+	if (retval == ERROR_OK)
+		retval = armv7m_run_crc_algorithm(target, crc_algorithm,
+				sizeof(cortex_m_crc_code) - 6, address, count, 0, count, checksum);
+
+	target_free_working_area(target, crc_algorithm);
+
+	return retval;
+}
+
+/** Registers a CRC peripheral for armv7m_checksum_memory() */
+void armv7m_set_crc_unit(struct target *target, target_addr_t base,
+	target_addr_t clk_enable_reg, uint32_t clk_enable_mask, bool has_init_pol)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (armv7m->crc_unit.base == base)
+		return;
+
+	armv7m->crc_unit.base = base;
+	armv7m->crc_unit.clk_enable_reg = clk_enable_reg;
+	armv7m->crc_unit.clk_enable_mask = clk_enable_mask;
+	armv7m->crc_unit.has_init_pol = has_init_pol;
+	armv7m->crc_unit.state = ARMV7M_CRC_UNTESTED;
+}
+
+/** Calculates the CRC of each of an array of memory regions. Uses the same
+ * loaders as armv7m_checksum_memory() block by block while they work, else
+ * the bitwise one for all blocks in one algorithm run. */
+int armv7m_checksum_memory_blocks(struct target *target,
+	struct target_memory_check_block *blocks, int num_blocks)
+{
+	struct working_area *crc_algorithm;
+	struct working_area *crc_params;
+	struct reg_param reg_params[1];
+	struct armv7m_algorithm armv7m_info;
+	int retval;
+	int i;
+
+	for (i = 0; i < num_blocks && blocks[i].size; i++) {
+		retval = armv7m_checksum_memory_fast(target, blocks[i].address,
+				blocks[i].size, &blocks[i].result);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			break;
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	if (i > 0)
+		return i;	/* number of blocks really checked */
+
+	static const uint8_t crc_blocks_code[] = {
+#include "../../contrib/loaders/checksum/armv7m_crc_blocks.inc"
+	};
+
+	const uint32_t code_size = sizeof(crc_blocks_code);
+
+	if (target_alloc_working_area(target, code_size, &crc_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, crc_algorithm->address,
+			code_size, crc_blocks_code);
 	if (retval != ERROR_OK)
-		goto cleanup;
+		goto cleanup1;
+
+	/* prepare blocks array for algo, a zero size entry ends it */
+	struct algo_block {
+		union {
+			uint32_t size;
+			uint32_t crc;
+		};
+		uint32_t address;
+	};
+
+	/* room for at least one block and the terminating entry */
+	uint32_t avail = target_get_working_area_avail(target);
+	if (avail < 2 * sizeof(struct algo_block)) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup1;
+	}
+	int blocks_to_check = avail / sizeof(struct algo_block) - 1;
+	if (num_blocks < blocks_to_check)
+		blocks_to_check = num_blocks;
+
+	struct algo_block *params = malloc((blocks_to_check + 1) * sizeof(struct algo_block));
+	if (params == NULL) {
+		retval = ERROR_FAIL;
+		goto cleanup1;
+	}
+
+	uint32_t total_size = 0;
+	for (i = 0; i < blocks_to_check && blocks[i].size; i++) {
+		total_size += blocks[i].size;
+		target_buffer_set_u32(target, (uint8_t *)&(params[i].size), blocks[i].size);
+		target_buffer_set_u32(target, (uint8_t *)&(params[i].address), blocks[i].address);
+	}
+	blocks_to_check = i;
+	target_buffer_set_u32(target, (uint8_t *)&(params[blocks_to_check].size), 0);
+
+	if (blocks[0].size == 0) {
+		/* CRC of an empty block, as image_calculate_checksum() computes it */
+		blocks[0].result = 0xffffffff;
+		retval = 1;
+		goto cleanup2;
+	}
+
+	uint32_t param_size = (blocks_to_check + 1) * sizeof(struct algo_block);
+	if (target_alloc_working_area(target, param_size, &crc_params) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup2;
+	}
+
+	retval = target_write_buffer(target, crc_params->address,
+			param_size, (uint8_t *)params);
+	if (retval != ERROR_OK)
+		goto cleanup3;
+
+	LOG_DEBUG("Starting checksum of %d blocks, parameters@"
+		 TARGET_ADDR_FMT, blocks_to_check, crc_params->address);
 
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
-	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
-
-	buf_set_u32(reg_params[0].value, 0, 32, address);
-	buf_set_u32(reg_params[1].value, 0, 32, count);
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	buf_set_u32(reg_params[0].value, 0, 32, crc_params->address);
 
-	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+	int timeout = 20000 * (1 + (total_size / (1024 * 1024)));
 
-	retval = target_run_algorithm(target, 0, NULL, 2, reg_params, crc_algorithm->address,
-			crc_algorithm->address + (sizeof(cortex_m_crc_code) - 6),
+	retval = target_run_algorithm(target, 0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			crc_algorithm->address,
+			crc_algorithm->address + (code_size - 6),
 			timeout, &armv7m_info);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("error executing cortex_m crc blocks algorithm");
+		goto cleanup4;
+	}
 
-	if (retval == ERROR_OK)
-		*checksum = buf_get_u32(reg_params[0].value, 0, 32);
-	else
-		LOG_ERROR("error executing cortex_m crc algorithm");
+	retval = target_read_buffer(target, crc_params->address,
+			param_size, (uint8_t *)params);
+	if (retval != ERROR_OK)
+		goto cleanup4;
 
-	destroy_reg_param(&reg_params[0]);
-	destroy_reg_param(&reg_params[1]);
+	for (i = 0; i < blocks_to_check; i++)
+		blocks[i].result = target_buffer_get_u32(target, (uint8_t *)&(params[i].crc));
 
-cleanup:
+	retval = blocks_to_check;	/* return number of blocks really checked */
+
+cleanup4:
+	destroy_reg_param(&reg_params[0]);
+cleanup3:
+	target_free_working_area(target, crc_params);
+cleanup2:
+	free(params);
+cleanup1:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
-/** Checks an array of memory regions whether they are erased. */
+/** Checks an array of memory regions whether they are erased.
+ * All blocks which fit in the working area are checked in one run, the
+ * loader stops at the first non-erased word of a block and returns one
+ * result bit per block. */
 int armv7m_blank_check_memory(struct target *target,
 	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
 {
 	struct working_area *erase_check_algorithm;
 	struct working_area *erase_check_params;
-	struct reg_param reg_params[2];
+	struct reg_param reg_params[3];
 	struct armv7m_algorithm armv7m_info;
 	int retval;
 
@@ -954,44 +1372,62 @@ int armv7m_blank_check_memory(struct target *target,
 
 	/* prepare blocks array for algo */
 	struct algo_block {
-		union {
-			uint32_t size;
-			uint32_t result;
-		};
+		uint32_t size;
 		uint32_t address;
 	};
 
+	/* Each block takes a descriptor and a result bit. Reserve room for
+	 * the terminating descriptor, the block count and the padding of
+	 * the last bitmap word */
 	uint32_t avail = target_get_working_area_avail(target);
-	int blocks_to_check = avail / sizeof(struct algo_block) - 1;
+	int blocks_to_check = 0;
+	if (avail > 16)
+		blocks_to_check = (avail - 16) * 8 / (8 * sizeof(struct algo_block) + 1);
 	if (num_blocks < blocks_to_check)
 		blocks_to_check = num_blocks;
+	if (blocks_to_check < 1) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup1;
+	}
+
+	uint32_t blocks_size = (blocks_to_check + 1) * sizeof(struct algo_block);
+	uint32_t bitmap_size = (1 + DIV_ROUND_UP(blocks_to_check, 32)) * sizeof(uint32_t);
+	uint32_t param_size = blocks_size + bitmap_size;
 
-	struct algo_block *params = malloc((blocks_to_check+1)*sizeof(struct algo_block));
+	uint8_t *params = malloc(param_size);
 	if (params == NULL) {
 		retval = ERROR_FAIL;
 		goto cleanup1;
 	}
 
+	struct algo_block *algo_blocks = (struct algo_block *)params;
+	uint8_t *bitmap = params + blocks_size;
+
 	int i;
 	uint32_t total_size = 0;
 	for (i = 0; i < blocks_to_check; i++) {
 		total_size += blocks[i].size;
-		target_buffer_set_u32(target, (uint8_t *)&(params[i].size),
+		target_buffer_set_u32(target, (uint8_t *)&(algo_blocks[i].size),
 						blocks[i].size / sizeof(uint32_t));
-		target_buffer_set_u32(target, (uint8_t *)&(params[i].address),
+		target_buffer_set_u32(target, (uint8_t *)&(algo_blocks[i].address),
 						blocks[i].address);
 	}
-	target_buffer_set_u32(target, (uint8_t *)&(params[blocks_to_check].size), 0);
+	target_buffer_set_u32(target, (uint8_t *)&(algo_blocks[blocks_to_check].size), 0);
+	target_buffer_set_u32(target, (uint8_t *)&(algo_blocks[blocks_to_check].address), 0);
 
-	uint32_t param_size = (blocks_to_check + 1) * sizeof(struct algo_block);
 	if (target_alloc_working_area(target, param_size,
 			&erase_check_params) != ERROR_OK) {
 		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 		goto cleanup2;
 	}
 
+	/* the block count precedes the bitmap */
+	target_addr_t bitmap_address = erase_check_params->address + blocks_size;
+	target_buffer_set_u32(target, bitmap, 0);
+
+	/* only the descriptors and the block count need to be written */
 	retval = target_write_buffer(target, erase_check_params->address,
-				param_size, (uint8_t *)params);
+				blocks_size + 4, params);
 	if (retval != ERROR_OK)
 		goto cleanup3;
 
@@ -1010,6 +1446,9 @@ int armv7m_blank_check_memory(struct target *target,
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
 	buf_set_u32(reg_params[1].value, 0, 32, erased_word);
 
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	buf_set_u32(reg_params[2].value, 0, 32, bitmap_address);
+
 	/* assume CPU clk at least 1 MHz */
 	int timeout = (timed_out ? 30000 : 2000) + total_size * 3 / 1000;
 
@@ -1025,18 +1464,21 @@ int armv7m_blank_check_memory(struct target *target,
 	if (retval != ERROR_OK && !timed_out)
 		goto cleanup4;
 
-	retval = target_read_buffer(target, erase_check_params->address,
-				param_size, (uint8_t *)params);
+	retval = target_read_buffer(target, bitmap_address, bitmap_size, bitmap);
 	if (retval != ERROR_OK)
 		goto cleanup4;
 
-	for (i = 0; i < blocks_to_check; i++) {
-		uint32_t result = target_buffer_get_u32(target,
-					(uint8_t *)&(params[i].result));
-		if (result != 0 && result != 1)
-			break;
-
-		blocks[i].result = result;
+	/* the loader counts each block after storing its result */
+	uint32_t blocks_done = target_buffer_get_u32(target, bitmap);
+	if (blocks_done > (uint32_t)blocks_to_check)
+		blocks_done = blocks_to_check;
+
+	for (i = 0; i < (int)blocks_done; i++) {
+		uint32_t word = target_buffer_get_u32(target, bitmap + 4 + i / 32 * 4);
+		/* results are shifted in from the top, a partial word of m
+		 * results has the first one at bit 32 - m */
+		uint32_t in_word = MIN(blocks_done - i / 32 * 32, 32);
+		blocks[i].result = (word >> (32 - in_word + i % 32)) & 1;
 	}
 	if (i && timed_out)
 		LOG_INFO("Slow CPU clock: %d blocks checked, %d remain. Continuing...", i, num_blocks-i);
@@ -1046,6 +1488,7 @@ int armv7m_blank_check_memory(struct target *target,
 cleanup4:
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
 
 cleanup3:
 	target_free_working_area(target, erase_check_params);
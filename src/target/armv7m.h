@@ -227,6 +227,21 @@ enum {
 
 #define ARMV7M_COMMON_MAGIC 0x2A452A45
 
+enum armv7m_crc_state {
+	ARMV7M_CRC_UNTESTED = 0,
+	ARMV7M_CRC_OK,
+	ARMV7M_CRC_BROKEN,
+};
+
+/* CRC peripheral (STM32 register layout) usable by armv7m_checksum_memory() */
+struct armv7m_crc_unit {
+	target_addr_t base;				/* 0 if there is none */
+	target_addr_t clk_enable_reg;	/* 0 if always clocked */
+	uint32_t clk_enable_mask;
+	bool has_init_pol;				/* INIT and POL registers present */
+	enum armv7m_crc_state state;
+};
+
 struct armv7m_common {
 	struct arm arm;
 
@@ -244,6 +259,9 @@ struct armv7m_common {
 
 	struct armv7m_trace_config trace_config;
 
+	struct armv7m_crc_unit crc_unit;
+	enum armv7m_crc_state crc_table_state;
+
 	/* Direct processor core register read and writes */
 	int (*load_core_reg_u32)(struct target *target, uint32_t regsel, uint32_t *value);
 	int (*store_core_reg_u32)(struct target *target, uint32_t regsel, uint32_t value);
@@ -310,6 +328,10 @@ int armv7m_restore_context(struct target *target);
 
 int armv7m_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
+void armv7m_set_crc_unit(struct target *target, target_addr_t base,
+		target_addr_t clk_enable_reg, uint32_t clk_enable_mask, bool has_init_pol);
+int armv7m_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks);
 int armv7m_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
 
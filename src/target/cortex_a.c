@@ -732,8 +732,8 @@ static int cortex_a_poll(struct target *target)
 		target_call_event_callbacks(target, TARGET_EVENT_HALTED);
 		return retval;
 	}
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DSCR, &dscr);
+	retval = mem_ap_poll_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DSCR, &cortex_a->dscr_poll, &dscr);
 	if (retval != ERROR_OK)
 		return retval;
 	cortex_a->cpudbg_dscr = dscr;
@@ -770,6 +770,15 @@ static int cortex_a_poll(struct target *target)
 	return retval;
 }
 
+static int cortex_a_queue_poll(struct target *target)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+	return mem_ap_queue_poll_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DSCR, &cortex_a->dscr_poll);
+}
+
 static int cortex_a_halt(struct target *target)
 {
 	int retval;
@@ -3368,6 +3377,7 @@ struct target_type cortexa_target = {
 	.name = "cortex_a",
 
 	.poll = cortex_a_poll,
+	.queue_poll = cortex_a_queue_poll,
 	.arch_state = armv7a_arch_state,
 
 	.halt = cortex_a_halt,
@@ -3448,6 +3458,7 @@ struct target_type cortexr4_target = {
 	.name = "cortex_r4",
 
 	.poll = cortex_a_poll,
+	.queue_poll = cortex_a_queue_poll,
 	.arch_state = armv7a_arch_state,
 
 	.halt = cortex_a_halt,
@@ -83,6 +83,8 @@ struct cortex_a_common {
 
 	/* Context information */
 	uint32_t cpudbg_dscr;
+	/* DSCR read queued ahead of the poll */
+	struct adiv5_poll dscr_poll;
 
 	/* Saved cp15 registers */
 	uint32_t cp15_control_reg;
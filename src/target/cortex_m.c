@@ -1728,6 +1728,137 @@ static int cortex_m_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+static int cortex_m_write_async_fifo(struct target *target, target_addr_t address,
+	uint32_t size, const uint8_t *buffer,
+	target_addr_t wp_addr, uint32_t wp,
+	target_addr_t rp_addr, uint32_t *rp)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct adiv5_ap *ap = armv7m->debug_ap;
+	uint8_t word[4];
+	uint32_t value;
+	int retval = ERROR_OK;
+
+	if (size > 0) {
+		/* Same split as target_write_buffer(): naturally aligned accesses
+		 * only, so this also works on armv6m */
+		uint32_t access_size;
+		for (access_size = 1;
+				access_size < 4 && size >= access_size * 2 + (address & access_size);
+				access_size *= 2) {
+			if (address & access_size) {
+				retval = mem_ap_queue_write_buf(ap, buffer, access_size, 1, address);
+				if (retval != ERROR_OK)
+					return retval;
+				address += access_size;
+				size -= access_size;
+				buffer += access_size;
+			}
+		}
+
+		for (; access_size > 0; access_size /= 2) {
+			uint32_t aligned = size - size % access_size;
+			if (aligned > 0) {
+				retval = mem_ap_queue_write_buf(ap, buffer, access_size,
+						aligned / access_size, address);
+				if (retval != ERROR_OK)
+					return retval;
+				address += aligned;
+				size -= aligned;
+				buffer += aligned;
+			}
+		}
+
+		/* DRW carries the word in bus (little endian) byte order */
+		target_buffer_set_u32(target, word, wp);
+		retval = mem_ap_write_u32(ap, wp_addr, le_to_h_u32(word));
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = mem_ap_read_u32(ap, rp_addr, &value);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = dap_run(ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	h_u32_to_le(word, value);
+	*rp = target_buffer_get_u32(target, word);
+	return ERROR_OK;
+}
+
+static int cortex_m_read_buffers(struct target *target,
+	struct target_memory_read *reads, unsigned int num_reads)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct adiv5_ap *ap = armv7m->debug_ap;
+	uint32_t num_words = 0;
+	int retval = ERROR_OK;
+
+	if (ap->dap->ti_be_32_quirks) {
+		for (unsigned int i = 0; i < num_reads; i++) {
+			retval = target_read_buffer(target, reads[i].address,
+					reads[i].size, reads[i].buffer);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	/* each region is read with the aligned words covering it */
+	for (unsigned int i = 0; i < num_reads; i++) {
+		if (reads[i].size == 0)
+			continue;
+		target_addr_t first = reads[i].address & ~(target_addr_t)3;
+		target_addr_t end = (reads[i].address + reads[i].size + 3) & ~(target_addr_t)3;
+		num_words += (end - first) / 4;
+	}
+
+	uint32_t *words = malloc(num_words * sizeof(uint32_t));
+	if (words == NULL) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
+	}
+
+	uint32_t *word = words;
+	for (unsigned int i = 0; i < num_reads; i++) {
+		if (reads[i].size == 0)
+			continue;
+		target_addr_t first = reads[i].address & ~(target_addr_t)3;
+		target_addr_t end = (reads[i].address + reads[i].size + 3) & ~(target_addr_t)3;
+		retval = mem_ap_queue_read_buf_u32(ap, word, (end - first) / 4, first);
+		if (retval != ERROR_OK)
+			break;
+		word += (end - first) / 4;
+	}
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	if (retval == ERROR_OK) {
+		/* DRW carries the bytes in their bus lanes */
+		word = words;
+		for (unsigned int i = 0; i < num_reads; i++) {
+			if (reads[i].size == 0)
+				continue;
+			target_addr_t address = reads[i].address;
+			for (uint32_t j = 0; j < reads[i].size; j++, address++) {
+				reads[i].buffer[j] = *word >> 8 * (address & 3);
+				if ((address & 3) == 3)
+					word++;
+			}
+			if (address & 3)
+				word++;
+		}
+	} else
+		LOG_ERROR("Failed to read %u memory regions", num_reads);
+
+	free(words);
+	return retval;
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -2592,7 +2723,10 @@ struct target_type cortexm_target = {
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
+	.write_async_fifo = cortex_m_write_async_fifo,
+	.read_buffers = cortex_m_read_buffers,
 	.checksum_memory = armv7m_checksum_memory,
+	.checksum_memory_blocks = armv7m_checksum_memory_blocks,
 	.blank_check_memory = armv7m_blank_check_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
@@ -122,183 +122,279 @@ static int identify_image_type(struct image *image, const char *type_string, con
 	return ERROR_OK;
 }
 
+/* The text image formats are read in large blocks and split into lines
+ * in place, instead of going through fileio_fgets() line by line */
+#define IMAGE_TEXT_BLOCK_SIZE	(64 * 1024)
+
+struct image_text_reader {
+	struct fileio *fileio;
+	char *buffer;		/* IMAGE_TEXT_BLOCK_SIZE + 1 bytes */
+	size_t start;
+	size_t end;
+	bool eof;
+};
+
+static bool image_text_eof(struct image_text_reader *reader)
+{
+	return reader->eof && reader->start == reader->end;
+}
+
+/* Returns the next NUL terminated line without its line feed, or NULL at
+ * the end of the file. Lines longer than a block are returned in pieces. */
+static char *image_text_next_line(struct image_text_reader *reader)
+{
+	while (1) {
+		char *line = reader->buffer + reader->start;
+		size_t len = reader->end - reader->start;
+		char *lf = memchr(line, '\n', len);
+
+		if (lf != NULL) {
+			*lf = '\0';
+			reader->start = lf + 1 - reader->buffer;
+			return line;
+		}
+
+		if (len == IMAGE_TEXT_BLOCK_SIZE || (reader->eof && len > 0)) {
+			line[len] = '\0';
+			reader->start = reader->end;
+			return line;
+		}
+
+		if (reader->eof)
+			return NULL;
+
+		/* move the partial line to the front and read the next block */
+		memmove(reader->buffer, line, len);
+		reader->start = 0;
+		reader->end = len;
+
+		size_t size_read;
+		if (fileio_read(reader->fileio, IMAGE_TEXT_BLOCK_SIZE - len,
+				reader->buffer + len, &size_read) != ERROR_OK)
+			size_read = 0;
+		if (size_read == 0)
+			reader->eof = true;
+		reader->end += size_read;
+	}
+}
+
+/* Hex digit values, with bit 4 set for all valid digits */
+static const uint8_t image_hex_digits[256] = {
+	['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+	['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+	['a'] = 0x1a, ['b'] = 0x1b, ['c'] = 0x1c, ['d'] = 0x1d, ['e'] = 0x1e, ['f'] = 0x1f,
+	['A'] = 0x1a, ['B'] = 0x1b, ['C'] = 0x1c, ['D'] = 0x1d, ['E'] = 0x1e, ['F'] = 0x1f,
+};
+
+/* Decode hex digit pairs up to the first other character, returns the number of bytes */
+static size_t image_decode_hex(const char *text, uint8_t *record, size_t max)
+{
+	size_t count = 0;
+
+	while (count < max) {
+		uint8_t high = image_hex_digits[(uint8_t)text[0]];
+		if (!(high & 0x10))
+			break;
+		uint8_t low = image_hex_digits[(uint8_t)text[1]];
+		if (!(low & 0x10))
+			break;
+
+		record[count++] = (high << 4) | (low & 0xf);
+		text += 2;
+	}
+
+	return count;
+}
+
+/* Returns true if only blank lines and comments are left */
+static bool image_text_only_blank(struct image_text_reader *reader)
+{
+	char *line;
+
+	while ((line = image_text_next_line(reader)) != NULL)
+		if ((line[0] != '#') && (strlen(line + strspn(line, "\n\t\r ")) != 0))
+			return false;
+
+	return true;
+}
+
+/* a record holds at most 255 bytes plus its header and checksum */
+#define IMAGE_TEXT_RECORD_MAX	(255 + 5)
+
+/* Start a new section at address, unless the current section has zero size,
+ * in which case this specifies the current section's base address */
+static int image_text_new_section(struct image *image, struct imagesection *section,
+		uint8_t *data, uint32_t address, const char *format)
+{
+	if (section[image->num_sections].size != 0) {
+		image->num_sections++;
+		if (image->num_sections >= IMAGE_MAX_SECTIONS) {
+			/* too many sections */
+			LOG_ERROR("Too many sections found in %s file", format);
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+		section[image->num_sections].size = 0x0;
+		section[image->num_sections].flags = 0;
+		section[image->num_sections].private = data;
+	}
+	section[image->num_sections].base_address = address;
+
+	return ERROR_OK;
+}
+
+/* finish the current section and copy the section information */
+static int image_text_end_sections(struct image *image, struct imagesection *section)
+{
+	image->num_sections++;
+
+	free(image->sections);
+	image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
+	if (image->sections == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	memcpy(image->sections, section, sizeof(struct imagesection) * image->num_sections);
+
+	return ERROR_OK;
+}
+
+static uint8_t image_text_checksum(const uint8_t *record, size_t count)
+{
+	uint8_t sum = 0;
+
+	for (size_t i = 0; i < count; i++)
+		sum += record[i];
+
+	return sum;
+}
+
+/* we can't determine the number of sections that we'll have to create ahead of
+ * time, so we locally hold them until parsing is finished. Coalesced data records
+ * are stored back to back in one buffer, the sections point into it. */
+static int image_text_start(struct image *image, struct fileio *fileio,
+		struct image_text_reader *reader, uint8_t **buffer)
+{
+	size_t filesize;
+	int retval = fileio_size(fileio, &filesize);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* each data byte takes two characters */
+	*buffer = malloc((filesize >> 1) + 1);
+	if (*buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	reader->fileio = fileio;
+	reader->start = 0;
+	reader->end = 0;
+	reader->eof = false;
+
+	image->num_sections = 0;
+	image->sections = NULL;
+
+	return ERROR_OK;
+}
+
 static int image_ihex_buffer_complete_inner(struct image *image,
-	char *lpszLine,
+	struct image_text_reader *reader,
 	struct imagesection *section)
 {
 	struct image_ihex *ihex = image->type_private;
-	struct fileio *fileio = ihex->fileio;
+	uint8_t record[IMAGE_TEXT_RECORD_MAX];
 	uint32_t full_address;
 	uint32_t cooked_bytes;
 	bool end_rec = false;
-
-	/* we can't determine the number of sections that we'll have to create ahead of time,
-	 * so we locally hold them until parsing is finished */
-
-	size_t filesize;
+	char *line;
 	int retval;
-	retval = fileio_size(fileio, &filesize);
+
+	retval = image_text_start(image, ihex->fileio, reader, &ihex->buffer);
 	if (retval != ERROR_OK)
 		return retval;
 
-	ihex->buffer = malloc(filesize >> 1);
 	cooked_bytes = 0x0;
-	image->num_sections = 0;
 
-	while (!fileio_feof(fileio)) {
+	while (!image_text_eof(reader)) {
+		if (image->num_sections >= IMAGE_MAX_SECTIONS) {
+			/* all sections are in use after the end record, that's
+			 * fine unless more records follow */
+			if (end_rec && image_text_only_blank(reader))
+				break;
+			LOG_ERROR("Too many sections found in IHEX file");
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+
 		full_address = 0x0;
 		section[image->num_sections].private = &ihex->buffer[cooked_bytes];
 		section[image->num_sections].base_address = 0x0;
 		section[image->num_sections].size = 0x0;
 		section[image->num_sections].flags = 0;
 
-		while (fileio_fgets(fileio, 1023, lpszLine) == ERROR_OK) {
-			uint32_t count;
-			uint32_t address;
-			uint32_t record_type;
-			uint32_t checksum;
-			uint8_t cal_checksum = 0;
-			size_t bytes_read = 0;
-
+		while ((line = image_text_next_line(reader)) != NULL) {
 			/* skip comments and blank lines */
-			if ((lpszLine[0] == '#') || (strlen(lpszLine + strspn(lpszLine, "\n\t\r ")) == 0))
+			if ((line[0] == '#') || (strlen(line + strspn(line, "\n\t\r ")) == 0))
 				continue;
 
-			if (sscanf(&lpszLine[bytes_read], ":%2" SCNx32 "%4" SCNx32 "%2" SCNx32, &count,
-				&address, &record_type) != 3)
+			/* count, address, record type, data and checksum */
+			size_t len = 0;
+			if (line[0] == ':')
+				len = image_decode_hex(line + 1, record, sizeof(record));
+			if (len < 5 || len < record[0] + 5u) {
+				LOG_ERROR("malformed IHEX record: %.40s", line);
 				return ERROR_IMAGE_FORMAT_ERROR;
-			bytes_read += 9;
+			}
 
-			cal_checksum += (uint8_t)count;
-			cal_checksum += (uint8_t)(address >> 8);
-			cal_checksum += (uint8_t)address;
-			cal_checksum += (uint8_t)record_type;
+			uint32_t count = record[0];
+			uint32_t address = (record[1] << 8) | record[2];
+			uint32_t record_type = record[3];
+			const uint8_t *data = &record[4];
 
 			if (record_type == 0) {	/* Data Record */
 				if ((full_address & 0xffff) != address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-							/* too many sections */
-							LOG_ERROR("Too many sections found in IHEX file");
-							return ERROR_IMAGE_FORMAT_ERROR;
-						}
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&ihex->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address =
-						(full_address & 0xffff0000) | address;
 					full_address = (full_address & 0xffff0000) | address;
+					retval = image_text_new_section(image, section,
+							&ihex->buffer[cooked_bytes], full_address, "IHEX");
+					if (retval != ERROR_OK)
+						return retval;
 				}
 
-				while (count-- > 0) {
-					unsigned value;
-					sscanf(&lpszLine[bytes_read], "%2x", &value);
-					ihex->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
-				}
+				memcpy(&ihex->buffer[cooked_bytes], data, count);
+				cooked_bytes += count;
+				section[image->num_sections].size += count;
+				full_address += count;
 			} else if (record_type == 1) {	/* End of File Record */
-				/* finish the current section */
-				image->num_sections++;
-
-				/* copy section information */
-				image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-				for (unsigned int i = 0; i < image->num_sections; i++) {
-					image->sections[i].private = section[i].private;
-					image->sections[i].base_address = section[i].base_address;
-					image->sections[i].size = section[i].size;
-					image->sections[i].flags = section[i].flags;
-				}
+				retval = image_text_end_sections(image, section);
+				if (retval != ERROR_OK)
+					return retval;
 
 				end_rec = true;
 				break;
 			} else if (record_type == 2) {	/* Linear Address Record */
-				uint16_t upper_address;
-
-				sscanf(&lpszLine[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
-				bytes_read += 4;
+				uint16_t upper_address = be_to_h_u16(data);
 
 				if ((full_address >> 4) != upper_address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-							/* too many sections */
-							LOG_ERROR("Too many sections found in IHEX file");
-							return ERROR_IMAGE_FORMAT_ERROR;
-						}
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&ihex->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address =
-						(full_address & 0xffff) | (upper_address << 4);
 					full_address = (full_address & 0xffff) | (upper_address << 4);
+					retval = image_text_new_section(image, section,
+							&ihex->buffer[cooked_bytes], full_address, "IHEX");
+					if (retval != ERROR_OK)
+						return retval;
 				}
 			} else if (record_type == 3) {	/* Start Segment Address Record */
-				uint32_t dummy;
-
 				/* "Start Segment Address Record" will not be supported
 				 * but we must consume it, and do not create an error.  */
-				while (count-- > 0) {
-					sscanf(&lpszLine[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
-					bytes_read += 2;
-				}
 			} else if (record_type == 4) {	/* Extended Linear Address Record */
-				uint16_t upper_address;
-
-				sscanf(&lpszLine[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
-				bytes_read += 4;
+				uint16_t upper_address = be_to_h_u16(data);
 
 				if ((full_address >> 16) != upper_address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-							/* too many sections */
-							LOG_ERROR("Too many sections found in IHEX file");
-							return ERROR_IMAGE_FORMAT_ERROR;
-						}
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&ihex->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address =
-						(full_address & 0xffff) | (upper_address << 16);
 					full_address = (full_address & 0xffff) | (upper_address << 16);
+					retval = image_text_new_section(image, section,
+							&ihex->buffer[cooked_bytes], full_address, "IHEX");
+					if (retval != ERROR_OK)
+						return retval;
 				}
 			} else if (record_type == 5) {	/* Start Linear Address Record */
-				uint32_t start_address;
-
-				sscanf(&lpszLine[bytes_read], "%8" SCNx32, &start_address);
-				cal_checksum += (uint8_t)(start_address >> 24);
-				cal_checksum += (uint8_t)(start_address >> 16);
-				cal_checksum += (uint8_t)(start_address >> 8);
-				cal_checksum += (uint8_t)start_address;
-				bytes_read += 8;
+				uint32_t start_address = be_to_h_u32(data);
 
 				image->start_address_set = true;
 				image->start_address = be_to_h_u32((uint8_t *)&start_address);
@@ -307,9 +403,7 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				return ERROR_IMAGE_FORMAT_ERROR;
 			}
 
-			sscanf(&lpszLine[bytes_read], "%2" SCNx32, &checksum);
-
-			if ((uint8_t)checksum != (uint8_t)(~cal_checksum + 1)) {
+			if (image_text_checksum(record, count + 5) != 0) {
 				/* checksum failed */
 				LOG_ERROR("incorrect record checksum found in IHEX file");
 				return ERROR_IMAGE_CHECKSUM;
@@ -317,7 +411,7 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 
 			if (end_rec) {
 				end_rec = false;
-				LOG_WARNING("continuing after end-of-file record: %.40s", lpszLine);
+				LOG_WARNING("continuing after end-of-file record: %.40s", line);
 			}
 		}
 	}
@@ -336,23 +430,24 @@ static int image_ihex_buffer_complete_inner(struct image *image,
  */
 static int image_ihex_buffer_complete(struct image *image)
 {
-	char *lpszLine = malloc(1023);
-	if (lpszLine == NULL) {
+	struct image_text_reader reader;
+	reader.buffer = malloc(IMAGE_TEXT_BLOCK_SIZE + 1);
+	if (reader.buffer == NULL) {
 		LOG_ERROR("Out of memory");
 		return ERROR_FAIL;
 	}
 	struct imagesection *section = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS);
 	if (section == NULL) {
-		free(lpszLine);
+		free(reader.buffer);
 		LOG_ERROR("Out of memory");
 		return ERROR_FAIL;
 	}
 	int retval;
 
-	retval = image_ihex_buffer_complete_inner(image, lpszLine, section);
+	retval = image_ihex_buffer_complete_inner(image, &reader, section);
 
 	free(section);
-	free(lpszLine);
+	free(reader.buffer);
 
 	return retval;
 }
@@ -653,6 +748,32 @@ static int image_elf_read_headers(struct image *image)
 	}
 }
 
+/* Returns the file contents of an ELF segment in the mapped file, if they are there */
+static const uint8_t *image_elf_mapped(struct image *image, int section,
+		target_addr_t offset, uint32_t size)
+{
+	struct image_elf *elf = image->type_private;
+	uint64_t file_offset, file_size;
+
+	if (!elf->mapping)
+		return NULL;
+
+	if (elf->is_64_bit) {
+		Elf64_Phdr *segment = (Elf64_Phdr *)image->sections[section].private;
+		file_offset = field64(elf, segment->p_offset);
+		file_size = field64(elf, segment->p_filesz);
+	} else {
+		Elf32_Phdr *segment = (Elf32_Phdr *)image->sections[section].private;
+		file_offset = field32(elf, segment->p_offset);
+		file_size = field32(elf, segment->p_filesz);
+	}
+
+	if (offset + size > file_size || file_offset + file_size > elf->mapping_size)
+		return NULL;
+
+	return elf->mapping + file_offset + offset;
+}
+
 static int image_elf32_read_section(struct image *image,
 	int section,
 	target_addr_t offset,
@@ -676,15 +797,20 @@ static int image_elf32_read_section(struct image *image,
 		LOG_DEBUG("read elf: size = 0x%zx at 0x%" TARGET_PRIxADDR "", read_size,
 			field32(elf, segment->p_offset) + offset);
 		/* read initialized area of the segment */
-		retval = fileio_seek(elf->fileio, field32(elf, segment->p_offset) + offset);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("cannot find ELF segment content, seek failed");
-			return retval;
-		}
-		retval = fileio_read(elf->fileio, read_size, buffer, &really_read);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("cannot read ELF segment content, read failed");
-			return retval;
+		const uint8_t *mapped = image_elf_mapped(image, section, offset, read_size);
+		if (mapped) {
+			memcpy(buffer, mapped, read_size);
+		} else {
+			retval = fileio_seek(elf->fileio, field32(elf, segment->p_offset) + offset);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("cannot find ELF segment content, seek failed");
+				return retval;
+			}
+			retval = fileio_read(elf->fileio, read_size, buffer, &really_read);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("cannot read ELF segment content, read failed");
+				return retval;
+			}
 		}
 		size -= read_size;
 		*size_read += read_size;
@@ -719,15 +845,20 @@ static int image_elf64_read_section(struct image *image,
 		LOG_DEBUG("read elf: size = 0x%zx at 0x%" TARGET_PRIxADDR "", read_size,
 			field64(elf, segment->p_offset) + offset);
 		/* read initialized area of the segment */
-		retval = fileio_seek(elf->fileio, field64(elf, segment->p_offset) + offset);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("cannot find ELF segment content, seek failed");
-			return retval;
-		}
-		retval = fileio_read(elf->fileio, read_size, buffer, &really_read);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("cannot read ELF segment content, read failed");
-			return retval;
+		const uint8_t *mapped = image_elf_mapped(image, section, offset, read_size);
+		if (mapped) {
+			memcpy(buffer, mapped, read_size);
+		} else {
+			retval = fileio_seek(elf->fileio, field64(elf, segment->p_offset) + offset);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("cannot find ELF segment content, seek failed");
+				return retval;
+			}
+			retval = fileio_read(elf->fileio, read_size, buffer, &really_read);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("cannot read ELF segment content, read failed");
+				return retval;
+			}
 		}
 		size -= read_size;
 		*size_read += read_size;
@@ -755,148 +886,94 @@ static int image_elf_read_section(struct image *image,
 }
 
 static int image_mot_buffer_complete_inner(struct image *image,
-	char *lpszLine,
+	struct image_text_reader *reader,
 	struct imagesection *section)
 {
 	struct image_mot *mot = image->type_private;
-	struct fileio *fileio = mot->fileio;
+	uint8_t record[IMAGE_TEXT_RECORD_MAX];
 	uint32_t full_address;
 	uint32_t cooked_bytes;
 	bool end_rec = false;
-
-	/* we can't determine the number of sections that we'll have to create ahead of time,
-	 * so we locally hold them until parsing is finished */
-
+	char *line;
 	int retval;
-	size_t filesize;
-	retval = fileio_size(fileio, &filesize);
+
+	retval = image_text_start(image, mot->fileio, reader, &mot->buffer);
 	if (retval != ERROR_OK)
 		return retval;
 
-	mot->buffer = malloc(filesize >> 1);
 	cooked_bytes = 0x0;
-	image->num_sections = 0;
 
-	while (!fileio_feof(fileio)) {
+	while (!image_text_eof(reader)) {
+		if (image->num_sections >= IMAGE_MAX_SECTIONS) {
+			/* all sections are in use after the end record, that's
+			 * fine unless more records follow */
+			if (end_rec && image_text_only_blank(reader))
+				break;
+			LOG_ERROR("Too many sections found in S19 file");
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+
 		full_address = 0x0;
 		section[image->num_sections].private = &mot->buffer[cooked_bytes];
 		section[image->num_sections].base_address = 0x0;
 		section[image->num_sections].size = 0x0;
 		section[image->num_sections].flags = 0;
 
-		while (fileio_fgets(fileio, 1023, lpszLine) == ERROR_OK) {
-			uint32_t count;
-			uint32_t address;
-			uint32_t record_type;
-			uint32_t checksum;
-			uint8_t cal_checksum = 0;
-			uint32_t bytes_read = 0;
-
+		while ((line = image_text_next_line(reader)) != NULL) {
 			/* skip comments and blank lines */
-			if ((lpszLine[0] == '#') || (strlen(lpszLine + strspn(lpszLine, "\n\t\r ")) == 0))
+			if ((line[0] == '#') || (strlen(line + strspn(line, "\n\t\r ")) == 0))
 				continue;
 
-			/* get record type and record length */
-			if (sscanf(&lpszLine[bytes_read], "S%1" SCNx32 "%2" SCNx32, &record_type,
-				&count) != 2)
+			/* get record type, then record length, address, data and checksum */
+			uint8_t record_type = image_hex_digits[(uint8_t)line[1]];
+			size_t len = 0;
+			if (line[0] == 'S' && (record_type & 0x10))
+				len = image_decode_hex(line + 2, record, sizeof(record));
+			if (len < 1 || record[0] < 1 || len < record[0] + 1u) {
+				LOG_ERROR("malformed S19 record: %.40s", line);
 				return ERROR_IMAGE_FORMAT_ERROR;
-
-			bytes_read += 4;
-			cal_checksum += (uint8_t)count;
+			}
+			record_type &= 0xf;
 
 			/* skip checksum byte */
-			count -= 1;
+			uint32_t count = record[0] - 1;
+			const uint8_t *data = &record[1];
 
 			if (record_type == 0) {
 				/* S0 - starting record (optional) */
-				int iValue;
-
-				while (count-- > 0) {
-					sscanf(&lpszLine[bytes_read], "%2x", &iValue);
-					cal_checksum += (uint8_t)iValue;
-					bytes_read += 2;
-				}
 			} else if (record_type >= 1 && record_type <= 3) {
-				switch (record_type) {
-					case 1:
-						/* S1 - 16 bit address data record */
-						sscanf(&lpszLine[bytes_read], "%4" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 4;
-						count -= 2;
-						break;
-
-					case 2:
-						/* S2 - 24 bit address data record */
-						sscanf(&lpszLine[bytes_read], "%6" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 6;
-						count -= 3;
-						break;
-
-					case 3:
-						/* S3 - 32 bit address data record */
-						sscanf(&lpszLine[bytes_read], "%8" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 24);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 8;
-						count -= 4;
-						break;
+				/* S1, S2, S3 - 16, 24 and 32 bit address data records */
+				uint32_t address_bytes = record_type + 1;
+				uint32_t address = 0;
 
+				if (count < address_bytes) {
+					LOG_ERROR("malformed S19 record: %.40s", line);
+					return ERROR_IMAGE_FORMAT_ERROR;
 				}
+				for (uint32_t i = 0; i < address_bytes; i++)
+					address = (address << 8) | data[i];
+				data += address_bytes;
+				count -= address_bytes;
 
 				if (full_address != address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&mot->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address = address;
+					retval = image_text_new_section(image, section,
+							&mot->buffer[cooked_bytes], address, "S19");
+					if (retval != ERROR_OK)
+						return retval;
 					full_address = address;
 				}
 
-				while (count-- > 0) {
-					unsigned value;
-					sscanf(&lpszLine[bytes_read], "%2x", &value);
-					mot->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
-				}
+				memcpy(&mot->buffer[cooked_bytes], data, count);
+				cooked_bytes += count;
+				section[image->num_sections].size += count;
+				full_address += count;
 			} else if (record_type == 5 || record_type == 6) {
 				/* S5 and S6 are the data count records, we ignore them */
-				uint32_t dummy;
-
-				while (count-- > 0) {
-					sscanf(&lpszLine[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
-					bytes_read += 2;
-				}
 			} else if (record_type >= 7 && record_type <= 9) {
 				/* S7, S8, S9 - ending records for 32, 24 and 16bit */
-				image->num_sections++;
-
-				/* copy section information */
-				image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-				for (unsigned int i = 0; i < image->num_sections; i++) {
-					image->sections[i].private = section[i].private;
-					image->sections[i].base_address = section[i].base_address;
-					image->sections[i].size = section[i].size;
-					image->sections[i].flags = section[i].flags;
-				}
+				retval = image_text_end_sections(image, section);
+				if (retval != ERROR_OK)
+					return retval;
 
 				end_rec = true;
 				break;
@@ -906,10 +983,7 @@ static int image_mot_buffer_complete_inner(struct image *image,
 			}
 
 			/* account for checksum, will always be 0xFF */
-			sscanf(&lpszLine[bytes_read], "%2" SCNx32, &checksum);
-			cal_checksum += (uint8_t)checksum;
-
-			if (cal_checksum != 0xFF) {
+			if (image_text_checksum(record, record[0] + 1) != 0xFF) {
 				/* checksum failed */
 				LOG_ERROR("incorrect record checksum found in S19 file");
 				return ERROR_IMAGE_CHECKSUM;
@@ -917,7 +991,7 @@ static int image_mot_buffer_complete_inner(struct image *image,
 
 			if (end_rec) {
 				end_rec = false;
-				LOG_WARNING("continuing after end-of-file record: %.40s", lpszLine);
+				LOG_WARNING("continuing after end-of-file record: %.40s", line);
 			}
 		}
 	}
@@ -936,23 +1010,24 @@ static int image_mot_buffer_complete_inner(struct image *image,
  */
 static int image_mot_buffer_complete(struct image *image)
 {
-	char *lpszLine = malloc(1023);
-	if (lpszLine == NULL) {
+	struct image_text_reader reader;
+	reader.buffer = malloc(IMAGE_TEXT_BLOCK_SIZE + 1);
+	if (reader.buffer == NULL) {
 		LOG_ERROR("Out of memory");
 		return ERROR_FAIL;
 	}
 	struct imagesection *section = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS);
 	if (section == NULL) {
-		free(lpszLine);
+		free(reader.buffer);
 		LOG_ERROR("Out of memory");
 		return ERROR_FAIL;
 	}
 	int retval;
 
-	retval = image_mot_buffer_complete_inner(image, lpszLine, section);
+	retval = image_mot_buffer_complete_inner(image, &reader, section);
 
 	free(section);
-	free(lpszLine);
+	free(reader.buffer);
 
 	return retval;
 }
@@ -1010,6 +1085,10 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		if (retval != ERROR_OK)
 			return retval;
 
+		/* segments are then copied from, or used straight from the mapping */
+		image_elf->mapping = fileio_map(image_elf->fileio);
+		fileio_size(image_elf->fileio, &image_elf->mapping_size);
+
 		retval = image_elf_read_headers(image);
 		if (retval != ERROR_OK) {
 			fileio_close(image_elf->fileio);
@@ -1036,6 +1115,8 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		image_memory->target = target;
 		image_memory->cache = NULL;
 		image_memory->cache_address = 0x0;
+		image_memory->cache_size = 0;
+		image_memory->read_ahead = IMAGE_MEMORY_CACHE_SIZE;
 	} else if (image->type == IMAGE_SRECORD) {
 		struct image_mot *image_mot;
 
@@ -1073,6 +1154,94 @@ int image_open(struct image *image, const char *url, const char *type_string)
 	return retval;
 };
 
+/* Refill the cache of a target memory image at address, for a read of size
+ * bytes. Sequential reads double the amount read ahead up to
+ * IMAGE_MEMORY_CACHE_MAX_SIZE, so long runs of small reads turn into few
+ * large target reads. The cache never extends past the block of
+ * IMAGE_MEMORY_CACHE_SIZE holding the end of the read. */
+static int image_memory_fill_cache(struct image_memory *image_memory, uint32_t address,
+		uint32_t size)
+{
+	if (!image_memory->cache) {
+		image_memory->cache = malloc(IMAGE_MEMORY_CACHE_MAX_SIZE);
+		if (!image_memory->cache)
+			return ERROR_FAIL;
+		image_memory->cache_size = 0;
+	}
+
+	if (image_memory->cache_size &&
+			address == image_memory->cache_address + image_memory->cache_size)
+		image_memory->read_ahead = MIN(2 * image_memory->read_ahead, IMAGE_MEMORY_CACHE_MAX_SIZE);
+	else
+		image_memory->read_ahead = IMAGE_MEMORY_CACHE_SIZE;
+
+	uint32_t cache_address = address & ~(IMAGE_MEMORY_CACHE_SIZE - 1);
+	uint64_t needed = (uint64_t)address + size - cache_address;
+	needed = (needed + IMAGE_MEMORY_CACHE_SIZE - 1) & ~(uint64_t)(IMAGE_MEMORY_CACHE_SIZE - 1);
+	/* don't wrap around the end of the address space */
+	uint32_t cache_size = MIN(MIN(image_memory->read_ahead, needed),
+			0x100000000ULL - cache_address);
+
+	int retval = target_read_buffer(image_memory->target, cache_address,
+			cache_size, image_memory->cache);
+	if (retval != ERROR_OK && cache_size > IMAGE_MEMORY_CACHE_SIZE) {
+		/* reading ahead may have run into inaccessible memory */
+		image_memory->read_ahead = IMAGE_MEMORY_CACHE_SIZE;
+		cache_size = MIN(IMAGE_MEMORY_CACHE_SIZE, 0x100000000ULL - cache_address);
+		retval = target_read_buffer(image_memory->target, cache_address,
+				cache_size, image_memory->cache);
+	}
+	if (retval != ERROR_OK) {
+		image_memory->cache_size = 0;
+		return retval;
+	}
+
+	image_memory->cache_address = cache_address;
+	image_memory->cache_size = cache_size;
+
+	return ERROR_OK;
+}
+
+static int image_memory_read(struct image *image, uint32_t address,
+		uint32_t size, uint8_t *buffer, size_t *size_read)
+{
+	struct image_memory *image_memory = image->type_private;
+
+	*size_read = 0;
+
+	while (*size_read < size) {
+		uint32_t remaining = size - *size_read;
+
+		if (image_memory->cache_size == 0
+			|| (address < image_memory->cache_address)
+			|| (address - image_memory->cache_address >= image_memory->cache_size)) {
+			/* reads larger than the cache go straight to the caller's buffer */
+			if (remaining >= IMAGE_MEMORY_CACHE_MAX_SIZE) {
+				if (target_read_buffer(image_memory->target, address,
+						remaining, buffer + *size_read) != ERROR_OK)
+					return ERROR_IMAGE_TEMPORARILY_UNAVAILABLE;
+				*size_read += remaining;
+				return ERROR_OK;
+			}
+
+			if (image_memory_fill_cache(image_memory, address, remaining) != ERROR_OK)
+				return ERROR_IMAGE_TEMPORARILY_UNAVAILABLE;
+		}
+
+		uint32_t size_in_cache = MIN(remaining,
+				image_memory->cache_address + image_memory->cache_size - address);
+
+		memcpy(buffer + *size_read,
+			image_memory->cache + (address - image_memory->cache_address),
+			size_in_cache);
+
+		*size_read += size_in_cache;
+		address += size_in_cache;
+	}
+
+	return ERROR_OK;
+}
+
 int image_read_section(struct image *image,
 	int section,
 	target_addr_t offset,
@@ -1116,43 +1285,8 @@ int image_read_section(struct image *image,
 	} else if (image->type == IMAGE_ELF) {
 		return image_elf_read_section(image, section, offset, size, buffer, size_read);
 	} else if (image->type == IMAGE_MEMORY) {
-		struct image_memory *image_memory = image->type_private;
-		uint32_t address = image->sections[section].base_address + offset;
-
-		*size_read = 0;
-
-		while ((size - *size_read) > 0) {
-			uint32_t size_in_cache;
-
-			if (!image_memory->cache
-				|| (address < image_memory->cache_address)
-				|| (address >=
-				(image_memory->cache_address + IMAGE_MEMORY_CACHE_SIZE))) {
-				if (!image_memory->cache)
-					image_memory->cache = malloc(IMAGE_MEMORY_CACHE_SIZE);
-
-				if (target_read_buffer(image_memory->target, address &
-					~(IMAGE_MEMORY_CACHE_SIZE - 1),
-					IMAGE_MEMORY_CACHE_SIZE, image_memory->cache) != ERROR_OK) {
-					free(image_memory->cache);
-					image_memory->cache = NULL;
-					return ERROR_IMAGE_TEMPORARILY_UNAVAILABLE;
-				}
-				image_memory->cache_address = address &
-					~(IMAGE_MEMORY_CACHE_SIZE - 1);
-			}
-
-			size_in_cache =
-				(image_memory->cache_address + IMAGE_MEMORY_CACHE_SIZE) - address;
-
-			memcpy(buffer + *size_read,
-				image_memory->cache + (address - image_memory->cache_address),
-				(size_in_cache > size) ? size : size_in_cache
-				);
-
-			*size_read += (size_in_cache > size) ? size : size_in_cache;
-			address += (size_in_cache > size) ? size : size_in_cache;
-		}
+		return image_memory_read(image, image->sections[section].base_address + offset,
+				size, buffer, size_read);
 	} else if (image->type == IMAGE_SRECORD) {
 		memcpy(buffer, (uint8_t *)image->sections[section].private + offset, size);
 		*size_read = size;
@@ -1168,6 +1302,24 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+const uint8_t *image_section_data(struct image *image, int section,
+		target_addr_t offset, uint32_t size)
+{
+	if (offset + size > image->sections[section].size)
+		return NULL;
+
+	switch (image->type) {
+		case IMAGE_IHEX:
+		case IMAGE_SRECORD:
+		case IMAGE_BUILDER:
+			return (const uint8_t *)image->sections[section].private + offset;
+		case IMAGE_ELF:
+			return image_elf_mapped(image, section, offset, size);
+		default:
+			return NULL;
+	}
+}
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size, int flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -1241,6 +1393,7 @@ void image_close(struct image *image)
 
 		free(image_memory->cache);
 		image_memory->cache = NULL;
+		image_memory->cache_size = 0;
 	} else if (image->type == IMAGE_SRECORD) {
 		struct image_mot *image_mot = image->type_private;
 
@@ -39,6 +39,7 @@
 #define IMAGE_MAX_SECTIONS			(512)
 
 #define IMAGE_MEMORY_CACHE_SIZE		(2048)
+#define IMAGE_MEMORY_CACHE_MAX_SIZE	(64 * 1024)
 
 enum image_type {
 	IMAGE_BINARY,	/* plain binary */
@@ -80,10 +81,14 @@ struct image_memory {
 	struct target *target;
 	uint8_t *cache;
 	uint32_t cache_address;
+	uint32_t cache_size;	/* valid bytes in cache */
+	uint32_t read_ahead;	/* size of the next cache fill */
 };
 
 struct image_elf {
 	struct fileio *fileio;
+	const uint8_t *mapping;		/* file contents if mapped, or NULL */
+	size_t mapping_size;
 	bool is_64_bit;
 	union {
 		Elf32_Ehdr *header32;
@@ -105,6 +110,14 @@ struct image_mot {
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, target_addr_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+/**
+ * Access section data without copying it, where the image holds it in memory
+ * or in a memory mapped file. The data stays valid until the image is closed.
+ * @returns a pointer to @a size bytes at @a offset of @a section, or NULL if
+ * the data must be read with image_read_section()
+ */
+const uint8_t *image_section_data(struct image *image, int section,
+		target_addr_t offset, uint32_t size);
 void image_close(struct image *image);
 
 int image_add_section(struct image *image, target_addr_t base, uint32_t size,
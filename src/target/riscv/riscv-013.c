@@ -75,6 +75,7 @@ void write_memory_sba_simple(struct target *target, target_addr_t addr, uint32_t
 void read_memory_sba_simple(struct target *target, target_addr_t addr,
 		uint32_t *rd_buf, uint32_t read_size, uint32_t sbcs);
 static int	riscv013_test_compliance(struct target *target);
+static int riscv013_autotune(struct target *target);
 
 /**
  * Since almost everything can be accomplish by scanning the dbus register, all
@@ -1775,6 +1776,9 @@ static int examine(struct target *target)
 					target->coreid, target->smp);
 	}
 
+	if (riscv_autotune_on_examine && riscv013_autotune(target) != ERROR_OK)
+		LOG_WARNING("Autotuning the DMI batch size and idle cycles failed.");
+
 	/* Some regression suites rely on seeing 'Examined RISC-V core' to know
 	 * when they can connect with gdb/telnet.
 	 * We will need to update those suites if we want to change that text. */
@@ -2039,6 +2043,7 @@ static int init_target(struct command_context *cmd_ctx,
 	generic_info->read_memory = read_memory;
 	generic_info->test_sba_config_reg = &riscv013_test_sba_config_reg;
 	generic_info->test_compliance = &riscv013_test_compliance;
+	generic_info->autotune = &riscv013_autotune;
 	generic_info->hart_count = &riscv013_hart_count;
 	generic_info->data_bits = &riscv013_data_bits;
 	generic_info->version_specific = calloc(1, sizeof(riscv013_info_t));
@@ -2456,6 +2461,237 @@ static int read_memory_bus_v0(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+static int batch_run(const struct target *target, struct riscv_batch *batch)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	if (r->reset_delays_wait >= 0) {
+		r->reset_delays_wait -= batch->used_scans;
+		if (r->reset_delays_wait <= 0) {
+			batch->idle_count = 0;
+			info->dmi_busy_delay = 0;
+			info->ac_busy_delay = 0;
+		}
+	}
+	return riscv_batch_run(batch);
+}
+
+/* Number of DMI scans measured for every setting tried by autotune. */
+#define AUTOTUNE_SCANS			2048
+/* Largest number of idle cycles autotune tries before giving up. */
+#define AUTOTUNE_MAX_IDLE		256
+
+static const unsigned autotune_batch_sizes[] = { 16, 32, 64, 128, 256, 512 };
+
+/**
+ * Issue AUTOTUNE_SCANS harmless DMI reads of dmstatus in batches of
+ * batch_size scans separated by idle cycles, and measure the throughput.
+ * *busy is set if any of the scans found the DMI busy, in which case the
+ * DMI has been reset and the measured rate is meaningless.
+ */
+static int autotune_measure(struct target *target, unsigned batch_size,
+		unsigned idle, unsigned *scans_per_sec, bool *busy)
+{
+	struct duration bench;
+	unsigned scans = 0;
+
+	*busy = false;
+	*scans_per_sec = 0;
+
+	select_dmi(target);
+	duration_start(&bench);
+
+	while (scans < AUTOTUNE_SCANS && !*busy) {
+		struct riscv_batch *batch = riscv_batch_alloc(target, batch_size, idle);
+		if (!batch)
+			return ERROR_FAIL;
+
+		size_t reads = 0;
+		while (riscv_batch_available_scans(batch) > 0) {
+			riscv_batch_add_dmi_read(batch, DM_DMSTATUS);
+			reads++;
+		}
+
+		if (riscv_batch_run(batch) != ERROR_OK) {
+			riscv_batch_free(batch);
+			return ERROR_FAIL;
+		}
+
+		for (size_t key = 0; key < reads; key++) {
+			if (riscv_batch_get_dmi_read_op(batch, key) != DMI_STATUS_SUCCESS) {
+				*busy = true;
+				break;
+			}
+		}
+		scans += batch->used_scans;
+		riscv_batch_free(batch);
+	}
+
+	duration_measure(&bench);
+
+	if (*busy) {
+		dtmcontrol_scan(target, DTM_DTMCS_DMIRESET);
+		return ERROR_OK;
+	}
+
+	float elapsed = duration_elapsed(&bench);
+	if (elapsed > 0)
+		*scans_per_sec = scans / elapsed;
+	return ERROR_OK;
+}
+
+static int riscv013_autotune(struct target *target)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	unsigned rate;
+	bool busy;
+
+	if (autotune_measure(target, r->batch_size, info->dmi_busy_delay,
+			&rate, &busy) != ERROR_OK)
+		return ERROR_FAIL;
+	r->autotune_result.initial_scans_per_sec = busy ? 0 : rate;
+
+	/* Find the smallest number of idle cycles that keeps the DMI from
+	 * getting busy with the largest batches. Start from the current delay,
+	 * it may have been learned from busy responses the short measurements
+	 * here don't run into, so it is never lowered. */
+	unsigned largest = autotune_batch_sizes[ARRAY_SIZE(autotune_batch_sizes) - 1];
+	unsigned idle = info->dmi_busy_delay;
+	while (1) {
+		if (autotune_measure(target, largest, idle, &rate, &busy) != ERROR_OK)
+			return ERROR_FAIL;
+		if (!busy)
+			break;
+		if (idle >= AUTOTUNE_MAX_IDLE) {
+			LOG_WARNING("DMI still busy with %u idle cycles, keeping current settings.",
+					idle);
+			return ERROR_OK;
+		}
+		idle = idle ? idle * 2 : 1;
+	}
+
+	/* Narrow the idle cycles down between the last busy and the first
+	 * working value, if any was busy. */
+	unsigned low = idle / 2;
+	while (idle > info->dmi_busy_delay && idle > 1 && low + 1 < idle) {
+		unsigned mid = (low + idle) / 2;
+		unsigned mid_rate;
+		if (autotune_measure(target, largest, mid, &mid_rate, &busy) != ERROR_OK)
+			return ERROR_FAIL;
+		if (busy)
+			low = mid;
+		else
+			idle = mid;
+	}
+
+	/* Now pick the fastest batch size with these idle cycles. */
+	unsigned best_size = r->batch_size;
+	unsigned best_rate = 0;
+	for (unsigned i = 0; i < ARRAY_SIZE(autotune_batch_sizes); i++) {
+		if (autotune_measure(target, autotune_batch_sizes[i], idle,
+				&rate, &busy) != ERROR_OK)
+			return ERROR_FAIL;
+		LOG_DEBUG("batch_size=%u idle=%u: %s %u scans/s", autotune_batch_sizes[i],
+				idle, busy ? "busy," : "", rate);
+		if (!busy && rate > best_rate) {
+			best_rate = rate;
+			best_size = autotune_batch_sizes[i];
+		}
+	}
+
+	if (best_rate == 0)
+		return ERROR_OK;
+
+	r->batch_size = best_size;
+	info->dmi_busy_delay = idle;
+
+	r->autotune_result.valid = true;
+	r->autotune_result.batch_size = best_size;
+	r->autotune_result.idle = idle;
+	r->autotune_result.scans_per_sec = best_rate;
+
+	LOG_INFO("RISC-V autotune: batch_size=%u, dmi_busy_delay=%u, %u scans/s "
+			"(was %u scans/s)", best_size, idle, best_rate,
+			r->autotune_result.initial_scans_per_sec);
+
+	return ERROR_OK;
+}
+
+/**
+ * Read words [index, count - 1) of a sbreadondata burst through one batch of
+ * sbdata reads, followed by a read of sbcs to check that none of them hit a
+ * busy bus. On success, *done is set to the number of words stored into
+ * buffer. It is set to 0 when DMI or the bus was busy: the delays have then
+ * been increased, and the caller has to restart the burst at index.
+ */
+static int read_memory_bus_v1_batch(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t count, uint8_t *buffer, uint32_t index,
+		uint32_t *done)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	static int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
+	assert(size <= 16);
+	unsigned int words = (size + 3) / 4;
+
+	*done = 0;
+
+	struct riscv_batch *batch = riscv_batch_alloc(target, r->batch_size,
+			info->dmi_busy_delay + info->bus_master_read_delay);
+	if (!batch)
+		return ERROR_FAIL;
+
+	uint32_t queued = 0;
+	for (uint32_t i = index; i + 1 < count; i++) {
+		if (riscv_batch_available_scans(batch) < words + 1)
+			break;
+		for (int j = words - 1; j >= 0; j--)
+			riscv_batch_add_dmi_read(batch, sbdata[j]);
+		queued++;
+	}
+	size_t sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
+
+	int result = batch_run(target, batch);
+	if (result != ERROR_OK) {
+		riscv_batch_free(batch);
+		return result;
+	}
+
+	for (size_t key = 0; key <= sbcs_key; key++) {
+		if (riscv_batch_get_dmi_read_op(batch, key) != DMI_STATUS_SUCCESS) {
+			LOG_DEBUG("DMI busy while reading memory at 0x%" TARGET_PRIxADDR,
+					address + index * size);
+			increase_dmi_busy_delay(target);
+			riscv_batch_free(batch);
+			return ERROR_OK;
+		}
+	}
+
+	uint32_t sbcs = riscv_batch_get_dmi_read_data(batch, sbcs_key);
+	if (get_field(sbcs, DM_SBCS_SBBUSYERROR) || get_field(sbcs, DM_SBCS_SBERROR)) {
+		LOG_DEBUG("system bus error while reading memory at 0x%" TARGET_PRIxADDR
+				" (sbcs=0x%x)", address + index * size, sbcs);
+		if (get_field(sbcs, DM_SBCS_SBBUSYERROR))
+			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+		riscv_batch_free(batch);
+		return ERROR_OK;
+	}
+
+	size_t key = 0;
+	for (uint32_t i = index; i < index + queued; i++) {
+		for (int j = words - 1; j >= 0; j--) {
+			uint32_t value = riscv_batch_get_dmi_read_data(batch, key++);
+			buf_set_u32(buffer + i * size + j * 4, 0, 8 * MIN(size, 4), value);
+			log_memory_access(address + i * size + j * 4, value, MIN(size, 4), true);
+		}
+	}
+	*done = queued;
+
+	riscv_batch_free(batch);
+	return ERROR_OK;
+}
+
 /**
  * Read the requested memory using the system bus interface.
  */
@@ -2482,7 +2718,7 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 			return ERROR_FAIL;
 
 		/* This address write will trigger the first read. */
-		if (sb_write_address(target, next_address) != ERROR_OK)
+		if (sb_write_address(target, increment ? next_address : address) != ERROR_OK)
 			return ERROR_FAIL;
 
 		if (info->bus_master_read_delay) {
@@ -2494,59 +2730,41 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 
 		/* First value has been read, and is waiting for us to issue a DMI read
-		 * to get it. */
-
-		static int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
-		assert(size <= 16);
-		target_addr_t next_read = address - 1;
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			for (int j = (size - 1) / 4; j >= 0; j--) {
-				uint32_t value;
-				unsigned attempt = 0;
-				while (1) {
-					if (attempt++ > 100) {
-						LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								  next_read);
-						return ERROR_FAIL;
-					}
-					dmi_status_t status = dmi_scan(target, NULL, &value,
-												   DMI_OP_READ, sbdata[j], 0, false);
-					if (status == DMI_STATUS_BUSY)
-						increase_dmi_busy_delay(target);
-					else if (status == DMI_STATUS_SUCCESS)
-						break;
-					else
-						return ERROR_FAIL;
-				}
-				if (next_read != address - 1) {
-					buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-					log_memory_access(next_read, value, MIN(size, 4), true);
-				}
-				next_read = address + i * size + j * 4;
+		 * to get it. Every read of sbdata0 triggers the next bus read, so all
+		 * but the last word are streamed through batches. */
+		uint32_t index = (next_address - address) / size;
+		bool restart = false;
+		while (index + 1 < count) {
+			uint32_t done;
+			if (read_memory_bus_v1_batch(target, address, size, count, buffer,
+					index, &done) != ERROR_OK)
+				return ERROR_FAIL;
+			if (done == 0) {
+				/* DMI or the bus was busy. Restart the burst from the first
+				 * word we didn't get, once the bus is idle again. */
+				restart = true;
+				break;
 			}
+			index += done;
 		}
 
 		uint32_t sbcs_read = 0;
-		if (count > 1) {
-			uint32_t value;
-			unsigned attempt = 0;
-			while (1) {
-				if (attempt++ > 100) {
-					LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								next_read);
-					return ERROR_FAIL;
-				}
-				dmi_status_t status = dmi_scan(target, NULL, &value, DMI_OP_NOP, 0, 0, false);
-				if (status == DMI_STATUS_BUSY)
-					increase_dmi_busy_delay(target);
-				else if (status == DMI_STATUS_SUCCESS)
-					break;
-				else
+		if (restart) {
+			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
+				return ERROR_FAIL;
+			if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
+				if (dmi_write(target, DM_SBCS, DM_SBCS_SBBUSYERROR) != ERROR_OK)
 					return ERROR_FAIL;
 			}
-			buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-			log_memory_access(next_read, value, MIN(size, 4), true);
+			if (get_field(sbcs_read, DM_SBCS_SBERROR)) {
+				dmi_write(target, DM_SBCS, DM_SBCS_SBERROR);
+				return ERROR_FAIL;
+			}
+			next_address = address + index * size;
+			continue;
+		}
 
+		if (count > 1) {
 			/* "Writes to sbcs while sbbusy is high result in undefined behavior.
 			 * A debugger must not write to sbcs until it reads sbbusy as 0." */
 			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
@@ -2569,10 +2787,11 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 
 		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
-			/* We read while the target was busy. Slow down and try again. */
+			/* We read while the target was busy. Slow down and try again,
+			 * the earlier words have been checked by their batches. */
 			if (dmi_write(target, DM_SBCS, DM_SBCS_SBBUSYERROR) != ERROR_OK)
 				return ERROR_FAIL;
-			next_address = sb_read_address(target);
+			next_address = address + (count - 1) * size;
 			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
 			continue;
 		}
@@ -2592,19 +2811,236 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
-static int batch_run(const struct target *target, struct riscv_batch *batch)
+/*
+ * Start autoexec for data0 before a batched abstract memory access.
+ * autoexecdata is optional, so read abstractauto back; *supported is false
+ * if the bit didn't stick and the caller must use one command per word.
+ */
+static int abstract_batch_autoexec(struct target *target, bool *supported)
+{
+	uint32_t abstractauto;
+
+	if (dmi_write(target, DM_ABSTRACTAUTO,
+			1 << DM_ABSTRACTAUTO_AUTOEXECDATA_OFFSET) != ERROR_OK)
+		return ERROR_FAIL;
+	if (dmi_read(target, &abstractauto, DM_ABSTRACTAUTO) != ERROR_OK)
+		return ERROR_FAIL;
+
+	*supported = get_field(abstractauto, DM_ABSTRACTAUTO_AUTOEXECDATA) & 1;
+	if (!*supported)
+		LOG_DEBUG("autoexecdata not supported; abstractauto=0x%x", abstractauto);
+	return ERROR_OK;
+}
+
+/*
+ * Stop autoexec after a batched abstract memory access, wait for the last
+ * command to complete and clear any error it left behind.
+ */
+static int abstract_batch_cleanup(struct target *target)
+{
+	RISCV013_INFO(info);
+	uint32_t abstractcs;
+
+	if (dmi_write(target, DM_ABSTRACTAUTO, 0) != ERROR_OK)
+		return ERROR_FAIL;
+	if (wait_for_idle(target, &abstractcs) != ERROR_OK)
+		return ERROR_FAIL;
+	info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+	if (info->cmderr != CMDERR_NONE)
+		riscv013_clear_abstract_error(target);
+	return ERROR_OK;
+}
+
+/*
+ * Run a batch of autoexec'd data0 accesses, closed by a read of abstractcs,
+ * and check that neither the DMI nor the abstract command was busy and that
+ * no command failed. Returns false if the batch can't be trusted, after
+ * increasing the relevant delay.
+ */
+static bool abstract_batch_run_check(struct target *target, struct riscv_batch *batch,
+		size_t abstractcs_key)
+{
+	if (batch_run(target, batch) != ERROR_OK)
+		return false;
+
+	for (size_t key = 0; key <= abstractcs_key; key++) {
+		if (riscv_batch_get_dmi_read_op(batch, key) != DMI_STATUS_SUCCESS) {
+			increase_dmi_busy_delay(target);
+			return false;
+		}
+	}
+
+	uint32_t abstractcs = riscv_batch_get_dmi_read_data(batch, abstractcs_key);
+	unsigned cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+	if (cmderr != CMDERR_NONE) {
+		LOG_DEBUG("batched abstract memory access failed; abstractcs=0x%x",
+				abstractcs);
+		if (cmderr == CMDERR_BUSY)
+			increase_ac_busy_delay(target);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read memory by executing the first access memory command explicitly, then
+ * letting every read of data0 (with abstractauto set) return the current
+ * word and execute the command for the next one. The reads are streamed
+ * through batches and checked once per batch. *done is set to the number of
+ * words stored into buffer, which is less than count if the caller must fall
+ * back to one command per word for the rest.
+ */
+static int read_memory_abstract_batch(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t count, uint8_t *buffer, uint32_t command,
+		uint32_t *done)
 {
 	RISCV013_INFO(info);
 	RISCV_INFO(r);
-	if (r->reset_delays_wait >= 0) {
-		r->reset_delays_wait -= batch->used_scans;
-		if (r->reset_delays_wait <= 0) {
-			batch->idle_count = 0;
-			info->dmi_busy_delay = 0;
-			info->ac_busy_delay = 0;
+	unsigned width32 = (size * 8 + 31) / 32 * 32;
+
+	*done = 0;
+
+	if (write_abstract_arg(target, 1, address, riscv_xlen(target)) != ERROR_OK)
+		return ERROR_FAIL;
+	if (execute_abstract_command(target, command) != ERROR_OK)
+		return ERROR_OK;
+
+	bool autoexec;
+	if (abstract_batch_autoexec(target, &autoexec) != ERROR_OK)
+		return ERROR_FAIL;
+	if (!autoexec)
+		return ERROR_OK;
+
+	/* Word index is in arg0, waiting to be read. */
+	uint32_t index = 0;
+	while (index + 1 < count) {
+		struct riscv_batch *batch = riscv_batch_alloc(target, r->batch_size,
+				info->dmi_busy_delay + info->ac_busy_delay);
+		if (!batch)
+			return ERROR_FAIL;
+
+		uint32_t reads = 0;
+		for (uint32_t i = index; i + 1 < count; i++) {
+			if (riscv_batch_available_scans(batch) < 3)
+				break;
+			/* Reading data0 last executes the command for the next word. */
+			if (width32 > 32)
+				riscv_batch_add_dmi_read(batch, DM_DATA1);
+			riscv_batch_add_dmi_read(batch, DM_DATA0);
+			reads++;
+		}
+		size_t abstractcs_key = riscv_batch_add_dmi_read(batch, DM_ABSTRACTCS);
+
+		if (!abstract_batch_run_check(target, batch, abstractcs_key)) {
+			riscv_batch_free(batch);
+			*done = index;
+			return abstract_batch_cleanup(target);
 		}
+
+		size_t key = 0;
+		for (uint32_t i = index; i < index + reads; i++) {
+			uint64_t value = 0;
+			if (width32 > 32)
+				value = (uint64_t)riscv_batch_get_dmi_read_data(batch, key++) << 32;
+			value |= riscv_batch_get_dmi_read_data(batch, key++);
+			buf_set_u64(buffer + i * size, 0, 8 * size, value);
+			log_memory_access(address + i * size, value, size, true);
+		}
+		index += reads;
+
+		riscv_batch_free(batch);
 	}
-	return riscv_batch_run(batch);
+
+	if (abstract_batch_cleanup(target) != ERROR_OK)
+		return ERROR_FAIL;
+	if (info->cmderr != CMDERR_NONE) {
+		*done = index;
+		return ERROR_OK;
+	}
+
+	/* The last word was read by the last command, and is left in arg0. */
+	riscv_reg_t value = read_abstract_arg(target, 0, width32);
+	buf_set_u64(buffer + index * size, 0, 8 * size, value);
+	log_memory_access(address + index * size, value, size, true);
+	*done = count;
+
+	return ERROR_OK;
+}
+
+/*
+ * Write memory by executing the first access memory command explicitly, then
+ * letting every write of data0 (with abstractauto set) execute the command
+ * for the word just written. *done is set to the number of words known to be
+ * written, which is less than count if the caller must fall back to one
+ * command per word for the rest.
+ */
+static int write_memory_abstract_batch(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t count, const uint8_t *buffer, uint32_t command,
+		uint32_t *done)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	unsigned width32 = (size * 8 + 31) / 32 * 32;
+
+	*done = 0;
+
+	riscv_reg_t value = buf_get_u64(buffer, 0, 8 * size);
+	if (write_abstract_arg(target, 0, value, riscv_xlen(target)) != ERROR_OK)
+		return ERROR_FAIL;
+	if (write_abstract_arg(target, 1, address, riscv_xlen(target)) != ERROR_OK)
+		return ERROR_FAIL;
+	if (execute_abstract_command(target, command) != ERROR_OK)
+		return ERROR_OK;
+
+	/* The first word has been written either way. */
+	bool autoexec;
+	if (abstract_batch_autoexec(target, &autoexec) != ERROR_OK)
+		return ERROR_FAIL;
+	if (!autoexec) {
+		*done = 1;
+		return ERROR_OK;
+	}
+
+	uint32_t index = 1;
+	while (index < count) {
+		struct riscv_batch *batch = riscv_batch_alloc(target, r->batch_size,
+				info->dmi_busy_delay + info->ac_busy_delay);
+		if (!batch)
+			return ERROR_FAIL;
+
+		uint32_t writes = 0;
+		for (uint32_t i = index; i < count; i++) {
+			if (riscv_batch_available_scans(batch) < 3)
+				break;
+			value = buf_get_u64(buffer + i * size, 0, 8 * size);
+			/* Writing data0 last executes the command. */
+			if (width32 > 32)
+				riscv_batch_add_dmi_write(batch, DM_DATA1, value >> 32);
+			riscv_batch_add_dmi_write(batch, DM_DATA0, value);
+			log_memory_access(address + i * size, value, size, false);
+			writes++;
+		}
+		size_t abstractcs_key = riscv_batch_add_dmi_read(batch, DM_ABSTRACTCS);
+
+		if (!abstract_batch_run_check(target, batch, abstractcs_key)) {
+			riscv_batch_free(batch);
+			/* The command for the last word of the previous batch was only
+			 * checked by this one. */
+			*done = index - 1;
+			return abstract_batch_cleanup(target);
+		}
+		index += writes;
+
+		riscv_batch_free(batch);
+	}
+
+	if (abstract_batch_cleanup(target) != ERROR_OK)
+		return ERROR_FAIL;
+	/* The last command may still have failed. */
+	*done = info->cmderr == CMDERR_NONE ? count : count - 1;
+
+	return ERROR_OK;
 }
 
 /*
@@ -2639,15 +3075,26 @@ static int read_memory_abstract(struct target *target, target_addr_t address,
 	/* Create the command (physical address, postincrement, read) */
 	uint32_t command = access_memory_command(target, false, width, true, false);
 
+	/* Stream the reads, and fall back to one command per word if that fails */
+	uint32_t done = 0;
+	if (count > 1) {
+		result = read_memory_abstract_batch(target, address, size, count,
+				buffer, command, &done);
+		if (result != ERROR_OK)
+			return result;
+		if (done < count)
+			LOG_DEBUG("batched abstract read stopped after %d words", done);
+	}
+
 	/* Execute the reads */
-	uint8_t *p = buffer;
+	uint8_t *p = buffer + done * size;
 	bool updateaddr = true;
 	unsigned width32 = (width + 31) / 32 * 32;
-	for (uint32_t c = 0; c < count; c++) {
+	for (uint32_t c = done; c < count; c++) {
 		/* Only update the address initially and let postincrement update it */
 		if (updateaddr) {
 			/* Set arg1 to the address: address + c * size */
-			result = write_abstract_arg(target, 1, address, riscv_xlen(target));
+			result = write_abstract_arg(target, 1, address + c * size, riscv_xlen(target));
 			if (result != ERROR_OK) {
 				LOG_ERROR("Failed to write arg1 during read_memory_abstract().");
 				return result;
@@ -2697,10 +3144,21 @@ static int write_memory_abstract(struct target *target, target_addr_t address,
 	/* Create the command (physical address, postincrement, write) */
 	uint32_t command = access_memory_command(target, false, width, true, true);
 
+	/* Stream the writes, and fall back to one command per word if that fails */
+	uint32_t done = 0;
+	if (count > 1) {
+		result = write_memory_abstract_batch(target, address, size, count,
+				buffer, command, &done);
+		if (result != ERROR_OK)
+			return result;
+		if (done < count)
+			LOG_DEBUG("batched abstract write stopped after %d words", done);
+	}
+
 	/* Execute the writes */
-	const uint8_t *p = buffer;
+	const uint8_t *p = buffer + done * size;
 	bool updateaddr = true;
-	for (uint32_t c = 0; c < count; c++) {
+	for (uint32_t c = done; c < count; c++) {
 		/* Move data to arg0 */
 		riscv_reg_t value = buf_get_u64(p, 0, 8 * size);
 		result = write_abstract_arg(target, 0, value, riscv_xlen(target));
@@ -2712,7 +3170,7 @@ static int write_memory_abstract(struct target *target, target_addr_t address,
 		/* Only update the address initially and let postincrement update it */
 		if (updateaddr) {
 			/* Set arg1 to the address: address + c * size */
-			result = write_abstract_arg(target, 1, address, riscv_xlen(target));
+			result = write_abstract_arg(target, 1, address + c * size, riscv_xlen(target));
 			if (result != ERROR_OK) {
 				LOG_ERROR("Failed to write arg1 during write_memory_abstract().");
 				return result;
@@ -2741,6 +3199,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		uint32_t size, uint32_t count, uint8_t *buffer, uint32_t increment)
 {
 	RISCV013_INFO(info);
+	RISCV_INFO(r);
 
 	int result = ERROR_OK;
 
@@ -2792,7 +3251,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		 * dm_data0 contains[read_addr-size*2]
 		 */
 
-		struct riscv_batch *batch = riscv_batch_alloc(target, 32,
+		struct riscv_batch *batch = riscv_batch_alloc(target, r->batch_size,
 				info->dmi_busy_delay + info->ac_busy_delay);
 		if (!batch)
 			return ERROR_FAIL;
@@ -3251,6 +3710,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
 	RISCV013_INFO(info);
+	RISCV_INFO(r);
 	uint32_t sbcs = sb_sbaccess(size);
 	sbcs = set_field(sbcs, DM_SBCS_SBAUTOINCREMENT, 1);
 	dmi_write(target, DM_SBCS, sbcs);
@@ -3267,7 +3727,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
+				r->batch_size,
 				info->dmi_busy_delay + info->bus_master_write_delay);
 		if (!batch)
 			return ERROR_FAIL;
@@ -3369,6 +3829,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
 	RISCV013_INFO(info);
+	RISCV_INFO(r);
 
 	if (riscv_xlen(target) < size * 8) {
 		LOG_ERROR("XLEN (%d) is too short for %d-bit memory write.",
@@ -3440,7 +3901,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				32,
+				r->batch_size,
 				info->dmi_busy_delay + info->ac_busy_delay);
 		if (!batch)
 			goto error;
@@ -203,6 +203,7 @@ int riscv_command_timeout_sec = DEFAULT_COMMAND_TIMEOUT_SEC;
 int riscv_reset_timeout_sec = DEFAULT_RESET_TIMEOUT_SEC;
 
 bool riscv_prefer_sba;
+bool riscv_autotune_on_examine;
 bool riscv_enable_virt2phys = true;
 bool riscv_ebreakm = true;
 bool riscv_ebreaks = true;
@@ -210,6 +211,10 @@ bool riscv_ebreaku = true;
 
 bool riscv_enable_virtual;
 
+/* Batch size for targets initialized later. Settable via RISC-V Target
+ * commands, also before init. */
+static unsigned riscv_batch_size = DEFAULT_BATCH_SIZE;
+
 typedef struct {
 	uint16_t low, high;
 } range_t;
@@ -2510,6 +2515,98 @@ COMMAND_HANDLER(riscv_reset_delays)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(riscv_set_batch_size)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	riscv_info_t *r = NULL;
+
+	/* the target's own setting exists only once it's initialized */
+	if (target && target->arch_info &&
+			strcmp(target_type_name(target), "riscv") == 0)
+		r = riscv_info(target);
+
+	if (CMD_ARGC > 1) {
+		LOG_ERROR("Command takes at most one argument");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (CMD_ARGC == 1) {
+		unsigned size;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		if (size < MIN_BATCH_SIZE) {
+			LOG_ERROR("Batch size must be at least %d.", MIN_BATCH_SIZE);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		riscv_batch_size = size;
+		if (r)
+			r->batch_size = size;
+	}
+
+	command_print(CMD, "%u", r ? r->batch_size : riscv_batch_size);
+	return ERROR_OK;
+}
+
+static void riscv_print_autotune_result(struct command_invocation *cmd,
+		struct target *target)
+{
+	RISCV_INFO(r);
+
+	/* Printed as a list of key/value pairs so that it can be used as a Tcl
+	 * dict. */
+	command_print(cmd, "tuned %d batch_size %u idle %u "
+			"scans_per_sec %u initial_scans_per_sec %u",
+			r->autotune_result.valid, r->batch_size, r->autotune_result.idle,
+			r->autotune_result.scans_per_sec,
+			r->autotune_result.initial_scans_per_sec);
+}
+
+COMMAND_HANDLER(riscv_autotune)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!r->autotune) {
+		LOG_ERROR("autotune is not implemented for this target.");
+		return ERROR_FAIL;
+	}
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	int retval = r->autotune(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	riscv_print_autotune_result(CMD, target);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(riscv_autotune_stats)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	riscv_print_autotune_result(CMD, target);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(riscv_set_autotune_on_examine)
+{
+	if (CMD_ARGC != 1) {
+		LOG_ERROR("Command takes exactly 1 parameter");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], riscv_autotune_on_examine);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(riscv_set_ir)
 {
 	if (CMD_ARGC != 2) {
@@ -2734,6 +2831,39 @@ static const struct command_registration riscv_exec_command_handlers[] = {
 			"supported. Normal order is from lowest hart index to highest. "
 			"Reversed order is from highest hart index to lowest."
 	},
+	{
+		.name = "set_batch_size",
+		.handler = riscv_set_batch_size,
+		.mode = COMMAND_ANY,
+		.usage = "[scans]",
+		.help = "Set or display the number of DMI scans queued into one adapter "
+			"flush by batched memory accesses. Before init, this sets the "
+			"default for all RISC-V targets."
+	},
+	{
+		.name = "autotune",
+		.handler = riscv_autotune,
+		.mode = COMMAND_EXEC,
+		.usage = "",
+		.help = "Measure the DMI throughput across batch sizes and idle cycles, "
+			"keep the fastest setting and display it."
+	},
+	{
+		.name = "autotune_stats",
+		.handler = riscv_autotune_stats,
+		.mode = COMMAND_EXEC,
+		.usage = "",
+		.help = "Display the batch size in use, and the DMI idle cycles and "
+			"throughput found by the last autotune, as a Tcl dict."
+	},
+	{
+		.name = "set_autotune_on_examine",
+		.handler = riscv_set_autotune_on_examine,
+		.mode = COMMAND_ANY,
+		.usage = "on|off",
+		.help = "When on, run autotune every time a target is examined. "
+			"Default is off."
+	},
 	{
 		.name = "set_ir",
 		.handler = riscv_set_ir,
@@ -2889,6 +3019,7 @@ void riscv_info_init(struct target *target, riscv_info_t *r)
 	r->dtm_version = 1;
 	r->registers_initialized = false;
 	r->current_hartid = target->coreid;
+	r->batch_size = riscv_batch_size;
 
 	memset(r->trigger_unique_id, 0xff, sizeof(r->trigger_unique_id));
 
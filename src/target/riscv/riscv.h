@@ -19,6 +19,8 @@ struct riscv_program;
 
 #define DEFAULT_COMMAND_TIMEOUT_SEC		2
 #define DEFAULT_RESET_TIMEOUT_SEC		30
+#define DEFAULT_BATCH_SIZE				64
+#define MIN_BATCH_SIZE					8
 
 #define RISCV_SATP_MODE(xlen)  ((xlen) == 32 ? SATP32_MODE : SATP64_MODE)
 #define RISCV_SATP_PPN(xlen)  ((xlen) == 32 ? SATP32_PPN : SATP64_PPN)
@@ -51,6 +53,18 @@ typedef struct {
 	unsigned custom_number;
 } riscv_reg_info_t;
 
+typedef struct {
+	/* Set once a sweep completed. */
+	bool valid;
+	/* Batch size and idle cycles per DMI scan that were selected. */
+	unsigned batch_size;
+	unsigned idle;
+	/* Measured DMI throughput with the selected settings. */
+	unsigned scans_per_sec;
+	/* Throughput with the settings in use before the sweep. */
+	unsigned initial_scans_per_sec;
+} riscv_autotune_t;
+
 typedef struct {
 	unsigned dtm_version;
 
@@ -105,6 +119,13 @@ typedef struct {
 	 * delays, causing them to be relearned. Used for testing. */
 	int reset_delays_wait;
 
+	/* Number of DMI scans queued into one adapter flush by the batched
+	 * memory accesses. */
+	unsigned batch_size;
+
+	/* Outcome of the last `riscv autotune` on this target. */
+	riscv_autotune_t autotune_result;
+
 	/* This target has been prepped and is ready to step/resume. */
 	bool prepped;
 	/* This target was selected using hasel. */
@@ -154,6 +175,10 @@ typedef struct {
 
 	int (*test_compliance)(struct target *target);
 
+	/* Measure DMI throughput across batch sizes and idle cycles, and keep
+	 * the fastest setting that doesn't make the DMI busy. */
+	int (*autotune)(struct target *target);
+
 	int (*read_memory)(struct target *target, target_addr_t address,
 			uint32_t size, uint32_t count, uint8_t *buffer, uint32_t increment);
 
@@ -207,6 +232,9 @@ extern int riscv_reset_timeout_sec;
 
 extern bool riscv_prefer_sba;
 
+/* Run `riscv autotune` at the end of examine. */
+extern bool riscv_autotune_on_examine;
+
 extern bool riscv_enable_virtual;
 extern bool riscv_ebreakm;
 extern bool riscv_ebreaks;
@@ -157,6 +157,24 @@ static struct target_timer_callback *target_timer_callbacks;
 static LIST_HEAD(target_reset_callback_list);
 static LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = 100;
+/* Fastest background polling while GDB waits for a target to stop */
+static const int polling_interval_fast = 1;
+
+/* Background polling state and statistics, see the poll_stats command */
+static struct {
+	/* when GDB last resumed a target, 0 while GDB isn't waiting */
+	int64_t gdb_wait_start;
+	int interval;
+	uint64_t passes;
+	int64_t pass_us_total;
+	int64_t pass_us_max;
+	/* halts found while GDB waited, and the interval they were found with */
+	uint64_t halts;
+	int64_t halt_interval_total;
+	int halt_interval_max;
+} poll_state = {
+	.interval = 100,
+};
 
 static const struct jim_nvp nvp_assert[] = {
 	{ .name = "assert", NVP_ASSERT },
@@ -937,6 +955,32 @@ done:
 	return retval;
 }
 
+/* Write a chunk of fifo data and the new write pointer, then read back the
+ * read pointer. Targets able to queue all of it use a single round trip. */
+static int target_write_async_fifo(struct target *target, target_addr_t address,
+		uint32_t size, const uint8_t *buffer,
+		target_addr_t wp_addr, uint32_t wp,
+		target_addr_t rp_addr, uint32_t *rp)
+{
+	int retval;
+
+	if (target->type->write_async_fifo)
+		return target->type->write_async_fifo(target, address, size, buffer,
+				wp_addr, wp, rp_addr, rp);
+
+	if (size > 0) {
+		retval = target_write_buffer(target, address, size, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = target_write_u32(target, wp_addr, wp);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return target_read_u32(target, rp_addr, rp);
+}
+
 /**
  * Streams data to a circular buffer on target intended for consumption by code
  * running asynchronously on target.
@@ -988,7 +1032,6 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
 {
 	int retval;
-	int timeout = 0;
 
 	const uint8_t *buffer_orig = buffer;
 
@@ -1012,6 +1055,16 @@ int target_run_flash_async_algorithm(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* Programming rate bookkeeping, see below */
+	uint32_t fifo_size = fifo_end_addr - fifo_start_addr;
+	uint32_t min_chunk = (fifo_size / 4) & ~(uint32_t)(block_size - 1);
+	uint64_t rate_bytes = 0;
+	int64_t rate_ms = 0;
+	int64_t last_poll = timeval_ms();
+	int64_t last_progress = last_poll;
+	uint32_t level = 0;
+	uint32_t prev_rp = rp;
+
 	/* Start up algorithm on target and let it idle while writing the first chunk */
 	retval = target_start_algorithm(target, num_mem_params, mem_params,
 			num_reg_params, reg_params,
@@ -1025,27 +1078,6 @@ int target_run_flash_async_algorithm(struct target *target,
 	}
 
 	while (count > 0) {
-
-		retval = target_read_u32(target, rp_addr, &rp);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to get read pointer");
-			break;
-		}
-
-		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
-			(size_t) (buffer - buffer_orig), count, wp, rp);
-
-		if (rp == 0) {
-			LOG_ERROR("flash write algorithm aborted by target");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		}
-
-		if (((rp - fifo_start_addr) & (block_size - 1)) || rp < fifo_start_addr || rp >= fifo_end_addr) {
-			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
-			break;
-		}
-
 		/* Count the number of bytes available in the fifo without
 		 * crossing the wrap around. Make sure to not fill it completely,
 		 * because that would make wp == rp and that's the empty condition. */
@@ -1057,25 +1089,6 @@ int target_run_flash_async_algorithm(struct target *target,
 		else
 			thisrun_bytes = fifo_end_addr - wp - block_size;
 
-		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(2);
-
-			/* to stop an infinite loop on some targets check and increment a timeout
-			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 2500) {
-				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
-				return ERROR_FLASH_OPERATION_FAILED;
-			}
-			continue;
-		}
-
-		/* reset our timeout */
-		timeout = 0;
-
 		/* Limit to the amount of data we actually want to write */
 		if (thisrun_bytes > count * block_size)
 			thisrun_bytes = count * block_size;
@@ -1084,22 +1097,78 @@ int target_run_flash_async_algorithm(struct target *target,
 		if (thisrun_bytes >= 16)
 			thisrun_bytes -= (rp + thisrun_bytes) & 0x03;
 
-		/* Write data to fifo */
-		retval = target_write_buffer(target, wp, thisrun_bytes, buffer);
-		if (retval != ERROR_OK)
+		/* Once the programming rate is known, don't spend a round trip on
+		 * a small chunk while the target still has plenty to chew on. */
+		uint32_t free_bytes = (rp > wp ? rp - wp : fifo_size - (wp - rp)) - block_size;
+		bool rate_known = rate_ms >= 10 && rate_bytes > 0;
+		if (thisrun_bytes == 0 || (rate_known && free_bytes < min_chunk
+					&& thisrun_bytes < count * block_size)) {
+			/* Sleep for about as long as the target needs to free up
+			 * min_chunk bytes, or a fixed 2 ms before the rate is known. */
+			int64_t sleep_ms = 2;
+			if (rate_known) {
+				uint64_t need = free_bytes < min_chunk ? min_chunk - free_bytes : (uint32_t)block_size;
+				sleep_ms = DIV_ROUND_UP(need * rate_ms, rate_bytes);
+				if (sleep_ms > 100)
+					sleep_ms = 100;
+			}
+			alive_sleep(sleep_ms);
+
+			/* to stop an infinite loop on some targets check for a timeout
+			 * this issue was observed on a stellaris using the new ICDI interface */
+			if (timeval_ms() - last_progress > 5000) {
+				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
+				return ERROR_FLASH_OPERATION_FAILED;
+			}
+			thisrun_bytes = 0;
+		}
+
+		uint32_t next_wp = wp + thisrun_bytes;
+		if (next_wp >= fifo_end_addr)
+			next_wp = fifo_start_addr;
+
+		/* Write data to fifo, store the updated write pointer and fetch
+		 * the read pointer in one go */
+		retval = target_write_async_fifo(target, wp, thisrun_bytes, buffer,
+				wp_addr, next_wp, rp_addr, &rp);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("failed to update flash write fifo");
 			break;
+		}
 
-		/* Update counters and wrap write pointer */
+		/* Update counters */
 		buffer += thisrun_bytes;
 		count -= thisrun_bytes / block_size;
-		wp += thisrun_bytes;
-		if (wp >= fifo_end_addr)
-			wp = fifo_start_addr;
+		wp = next_wp;
 
-		/* Store updated write pointer to target */
-		retval = target_write_u32(target, wp_addr, wp);
-		if (retval != ERROR_OK)
+		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
+			(size_t) (buffer - buffer_orig), count, wp, rp);
+
+		if (rp == 0) {
+			LOG_ERROR("flash write algorithm aborted by target");
+			retval = ERROR_FLASH_OPERATION_FAILED;
+			break;
+		}
+
+		if (((rp - fifo_start_addr) & (block_size - 1)) || rp < fifo_start_addr || rp >= fifo_end_addr) {
+			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
+			retval = ERROR_FLASH_OPERATION_FAILED;
 			break;
+		}
+
+		/* Only intervals during which the fifo never ran empty tell us
+		 * how fast the target programs */
+		int64_t now = timeval_ms();
+		uint32_t consumed = rp >= prev_rp ? rp - prev_rp : fifo_size - (prev_rp - rp);
+		if (consumed < level) {
+			rate_bytes += consumed;
+			rate_ms += now - last_poll;
+		}
+		if (consumed > 0 || thisrun_bytes > 0)
+			last_progress = now;
+		level = wp >= rp ? wp - rp : fifo_size - (rp - wp);
+		last_poll = now;
+		prev_rp = rp;
 
 		/* Avoid GDB timeouts */
 		keep_alive();
@@ -1339,6 +1408,16 @@ int target_write_phys_memory(struct target *target,
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
+int target_virt2phys(struct target *target, target_addr_t virtual,
+		target_addr_t *physical)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+	return target->type->virt2phys(target, virtual, physical);
+}
+
 int target_add_breakpoint(struct target *target,
 		struct breakpoint *breakpoint)
 {
@@ -1530,6 +1609,8 @@ static void target_reset_examined(struct target *target)
 }
 
 static int handle_target(void *priv);
+static int target_polling_event_callback(struct target *target,
+		enum target_event event, void *priv);
 
 static int target_init_one(struct command_context *cmd_ctx,
 		struct target *target)
@@ -1614,6 +1695,10 @@ static int target_init(struct command_context *cmd_ctx)
 	if (ERROR_OK != retval)
 		return retval;
 
+	retval = target_register_event_callback(&target_polling_event_callback, NULL);
+	if (ERROR_OK != retval)
+		return retval;
+
 	return ERROR_OK;
 }
 
@@ -1927,6 +2012,22 @@ static int target_call_timer_callbacks_check_time(int checktime)
 	return ERROR_OK;
 }
 
+/* Time in ms, as timeval_ms(), when the next timer callback is due */
+int64_t target_timer_next_event(void)
+{
+	int64_t next_event = INT64_MAX;
+
+	for (struct target_timer_callback *c = target_timer_callbacks; c; c = c->next) {
+		if (c->removed)
+			continue;
+		int64_t when = (int64_t)c->when.tv_sec * 1000 + c->when.tv_usec / 1000;
+		if (when < next_event)
+			next_event = when;
+	}
+
+	return next_event;
+}
+
 int target_call_timer_callbacks(void)
 {
 	return target_call_timer_callbacks_check_time(1);
@@ -2470,6 +2571,30 @@ int target_read_buffer(struct target *target, target_addr_t address, uint32_t si
 	return target->type->read_buffer(target, address, size, buffer);
 }
 
+int target_read_buffers(struct target *target,
+		struct target_memory_read *reads, unsigned int num_reads)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (num_reads == 0)
+		return ERROR_OK;
+
+	if (target->type->read_buffers)
+		return target->type->read_buffers(target, reads, num_reads);
+
+	for (unsigned int i = 0; i < num_reads; i++) {
+		int retval = target_read_buffer(target, reads[i].address,
+				reads[i].size, reads[i].buffer);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 static int target_read_buffer_default(struct target *target, target_addr_t address, uint32_t count, uint8_t *buffer)
 {
 	uint32_t size;
@@ -2546,6 +2671,32 @@ int target_checksum_memory(struct target *target, target_addr_t address, uint32_
 	return retval;
 }
 
+int target_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (num_blocks <= 0)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (target->type->checksum_memory_blocks) {
+		int retval = target->type->checksum_memory_blocks(target, blocks, num_blocks);
+		if (retval > 0)
+			return retval;
+		LOG_DEBUG("multi-block checksum failed, checksumming one block at a time");
+	}
+
+	int retval = target_checksum_memory(target, blocks[0].address, blocks[0].size,
+			&blocks[0].result);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return 1;
+}
+
 int target_blank_check_memory(struct target *target,
 	struct target_memory_check_block *blocks, int num_blocks,
 	uint8_t erased_value)
@@ -2944,6 +3095,67 @@ static int sense_handler(void)
 	return ERROR_OK;
 }
 
+/* Set the period of the background polling timer, restarting it now if
+ * 'reschedule' is set */
+static void target_set_polling_interval(int interval, bool reschedule)
+{
+	poll_state.interval = interval;
+
+	for (struct target_timer_callback *c = target_timer_callbacks; c; c = c->next) {
+		if (c->callback != handle_target || c->removed)
+			continue;
+
+		c->time_ms = interval;
+		if (reschedule) {
+			gettimeofday(&c->when, NULL);
+			timeval_add_time(&c->when, 0, interval * 1000);
+		}
+	}
+}
+
+/* While GDB waits for a running target to stop, poll with an interval of
+ * a tenth of the time since it was resumed. A stop is then noticed with
+ * a delay of at most about 10% of the run time, up to the idle interval,
+ * and short runs between breakpoints are not stretched to 100ms each.
+ * A failing target has GDB halted and backs off in units of the idle
+ * interval, so polling returns to that. */
+static void target_update_polling_interval(void)
+{
+	int interval = polling_interval;
+	bool running = false;
+	bool failing = false;
+
+	for (struct target *target = all_targets; target; target = target->next) {
+		if (target_was_examined(target) && target->state == TARGET_RUNNING)
+			running = true;
+		if (target->backoff.times > 0)
+			failing = true;
+	}
+
+	if (!running || failing)
+		poll_state.gdb_wait_start = 0;
+
+	if (poll_state.gdb_wait_start) {
+		int64_t waited = timeval_ms() - poll_state.gdb_wait_start;
+		if (waited / 10 < polling_interval)
+			interval = MAX(polling_interval_fast, (int)(waited / 10));
+	}
+
+	if (interval != poll_state.interval)
+		target_set_polling_interval(interval, false);
+}
+
+static int target_polling_event_callback(struct target *target,
+		enum target_event event, void *priv)
+{
+	if (event == TARGET_EVENT_GDB_START) {
+		poll_state.gdb_wait_start = timeval_ms();
+		target_set_polling_interval(polling_interval_fast, true);
+	}
+
+	return ERROR_OK;
+}
+
 /* process target state changes */
 static int handle_target(void *priv)
 {
@@ -2999,6 +3211,27 @@ static int handle_target(void *priv)
 		recursive = 0;
 	}
 
+	struct timeval pass_start;
+	gettimeofday(&pass_start, NULL);
+
+	/* Queue the status reads of all targets which will be polled, the
+	 * first poll then fetches them for all cores behind its DAP.
+	 */
+	for (struct target *target = all_targets;
+			is_jtag_poll_safe() && target;
+			target = target->next) {
+		if (!target->type->queue_poll || powerDropout || srstAsserted)
+			continue;
+
+		if (!target_was_examined(target) || !target->tap->enabled)
+			continue;
+
+		if (target->backoff.times > target->backoff.count)
+			continue;
+
+		target->type->queue_poll(target);
+	}
+
 	/* Poll targets for state changes unless that's globally disabled.
 	 * Skip targets that are currently disabled.
 	 */
@@ -3021,8 +3254,17 @@ static int handle_target(void *priv)
 
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!powerDropout && !srstAsserted) {
+			enum target_state prev_state = target->state;
+
 			/* polling may fail silently until the target has been examined */
 			retval = target_poll(target);
+			if (poll_state.gdb_wait_start && prev_state != TARGET_HALTED &&
+					target->state == TARGET_HALTED) {
+				poll_state.halts++;
+				poll_state.halt_interval_total += poll_state.interval;
+				poll_state.halt_interval_max = MAX(poll_state.halt_interval_max,
+						poll_state.interval);
+			}
 			if (retval != ERROR_OK) {
 				/* 100ms polling interval. Increase interval between polling up to 5000ms */
 				if (target->backoff.times * polling_interval < 5000) {
@@ -3045,7 +3287,7 @@ static int handle_target(void *priv)
 					target->examined = true;
 					LOG_USER("Examination failed, GDB will be halted. Polling again in %dms",
 						 target->backoff.times * polling_interval);
-					return retval;
+					break;
 				}
 			}
 
@@ -3054,6 +3296,16 @@ static int handle_target(void *priv)
 		}
 	}
 
+	struct timeval pass_end;
+	gettimeofday(&pass_end, NULL);
+	int64_t pass_us = (int64_t)(pass_end.tv_sec - pass_start.tv_sec) * 1000000
+		+ pass_end.tv_usec - pass_start.tv_usec;
+	poll_state.passes++;
+	poll_state.pass_us_total += pass_us;
+	poll_state.pass_us_max = MAX(poll_state.pass_us_max, pass_us);
+
+	target_update_polling_interval();
+
 	return retval;
 }
 
@@ -3217,6 +3469,34 @@ COMMAND_HANDLER(handle_poll_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_poll_stats_command)
+{
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		int64_t gdb_wait_start = poll_state.gdb_wait_start;
+		int interval = poll_state.interval;
+		memset(&poll_state, 0, sizeof(poll_state));
+		poll_state.gdb_wait_start = gdb_wait_start;
+		poll_state.interval = interval;
+		return ERROR_OK;
+	} else if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print(CMD, "background polling interval: %d ms%s", poll_state.interval,
+			poll_state.gdb_wait_start ? " (GDB waiting for a halt)" : "");
+	command_print(CMD, "polling passes: %" PRIu64 ", duration mean %" PRId64
+			" us, max %" PRId64 " us", poll_state.passes,
+			poll_state.passes ? poll_state.pass_us_total / (int64_t)poll_state.passes : 0,
+			poll_state.pass_us_max);
+	command_print(CMD, "halts found while GDB waited: %" PRIu64
+			", polling interval mean %" PRId64 " ms, max %d ms", poll_state.halts,
+			poll_state.halts ? poll_state.halt_interval_total / (int64_t)poll_state.halts : 0,
+			poll_state.halt_interval_max);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_wait_halt_command)
 {
 	if (CMD_ARGC > 1)
@@ -3636,13 +3916,23 @@ COMMAND_HANDLER(handle_load_image_command)
 	target_addr_t min_address = 0;
 	target_addr_t max_address = -1;
 	struct image image;
+	struct target *target = NULL;
+	bool parse_only = false;
+
+	/* only read and decode the image, e.g. to benchmark the image parsers */
+	if (CMD_ARGC > 0 && strcmp(CMD_ARGV[0], "-parse-only") == 0) {
+		parse_only = true;
+		CMD_ARGC--;
+		CMD_ARGV++;
+	}
 
 	int retval = CALL_COMMAND_HANDLER(parse_load_image_command_CMD_ARGV,
 			&image, &min_address, &max_address);
 	if (ERROR_OK != retval)
 		return retval;
 
-	struct target *target = get_current_target(CMD_CTX);
+	if (!parse_only)
+		target = get_current_target(CMD_CTX);
 
 	struct duration bench;
 	duration_start(&bench);
@@ -3653,19 +3943,28 @@ COMMAND_HANDLER(handle_load_image_command)
 	image_size = 0x0;
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
+		/* use the section data in place if the image holds it in memory */
+		const uint8_t *section_data = image_section_data(&image, i, 0x0,
+				image.sections[i].size);
+		if (section_data) {
+			buffer = NULL;
+			buf_cnt = image.sections[i].size;
+		} else {
+			buffer = malloc(image.sections[i].size);
+			if (buffer == NULL) {
+				command_print(CMD,
+							  "error allocating buffer for section (%d bytes)",
+							  (int)(image.sections[i].size));
+				retval = ERROR_FAIL;
+				break;
+			}
 
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
+			retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				break;
+			}
+			section_data = buffer;
 		}
 
 		uint32_t offset = 0;
@@ -3685,8 +3984,14 @@ COMMAND_HANDLER(handle_load_image_command)
 			if (image.sections[i].base_address + buf_cnt > max_address)
 				length -= (image.sections[i].base_address + buf_cnt)-max_address;
 
+			if (parse_only) {
+				image_size += length;
+				free(buffer);
+				continue;
+			}
+
 			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
+					image.sections[i].base_address + offset, length, section_data + offset);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3701,9 +4006,9 @@ COMMAND_HANDLER(handle_load_image_command)
 	}
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
-		command_print(CMD, "downloaded %" PRIu32 " bytes "
-				"in %fs (%0.3f KiB/s)", image_size,
-				duration_elapsed(&bench), duration_kbps(&bench, image_size));
+		command_print(CMD, "%s %" PRIu32 " bytes "
+				"in %fs (%0.3f KiB/s)", parse_only ? "parsed" : "downloaded",
+				image_size, duration_elapsed(&bench), duration_kbps(&bench, image_size));
 	}
 
 	image_close(&image);
@@ -3823,33 +4128,74 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	image_size = 0x0;
 	int diffs = 0;
 	retval = ERROR_OK;
-	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD,
-					"error allocating buffer for section (%" PRIu32 " bytes)",
-					image.sections[i].size);
-			break;
+
+	/* Checksum all sections on the target in as few algorithm runs as possible */
+	struct target_memory_check_block *mem_checks = NULL;
+	if (verify >= IMAGE_VERIFY && image.num_sections > 0) {
+		mem_checks = calloc(image.num_sections, sizeof(*mem_checks));
+		if (mem_checks == NULL) {
+			LOG_ERROR("Out of memory");
+			retval = ERROR_FAIL;
+			goto done;
 		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
+
+		for (unsigned int i = 0; i < image.num_sections; i++) {
+			mem_checks[i].address = image.sections[i].base_address;
+			mem_checks[i].size = image.sections[i].size;
 		}
 
-		if (verify >= IMAGE_VERIFY) {
-			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
+		for (unsigned int i = 0; i < image.num_sections; ) {
+			retval = target_checksum_memory_blocks(target, &mem_checks[i],
+					image.num_sections - i);
+			if (retval < 0)
+				goto done;
+			i += retval;
+			keep_alive();
+		}
+		retval = ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < image.num_sections; i++) {
+		/* use the section data in place if the image holds it in memory */
+		const uint8_t *section_data = image_section_data(&image, i, 0x0,
+				image.sections[i].size);
+		if (section_data) {
+			buffer = NULL;
+			buf_cnt = image.sections[i].size;
+		} else {
+			buffer = malloc(image.sections[i].size);
+			if (buffer == NULL) {
+				command_print(CMD,
+						"error allocating buffer for section (%" PRIu32 " bytes)",
+						image.sections[i].size);
+				break;
+			}
+			retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
 			}
+			section_data = buffer;
+		}
 
-			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
+		if (verify >= IMAGE_VERIFY) {
+			/* calculate checksum of image */
+			retval = image_calculate_checksum(section_data, buf_cnt, &checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
 			}
+
+			if (buf_cnt == mem_checks[i].size) {
+				mem_checksum = mem_checks[i].result;
+			} else {
+				retval = target_checksum_memory(target, image.sections[i].base_address,
+						buf_cnt, &mem_checksum);
+				if (retval != ERROR_OK) {
+					free(buffer);
+					break;
+				}
+			}
 			if ((checksum != mem_checksum) && (verify == IMAGE_CHECKSUM_ONLY)) {
 				LOG_ERROR("checksum mismatch");
 				free(buffer);
@@ -3869,13 +4215,13 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				if (retval == ERROR_OK) {
 					uint32_t t;
 					for (t = 0; t < buf_cnt; t++) {
-						if (data[t] != buffer[t]) {
+						if (data[t] != section_data[t]) {
 							command_print(CMD,
 										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
 										  diffs,
 										  (unsigned)(t + image.sections[i].base_address),
 										  data[t],
-										  buffer[t]);
+										  section_data[t]);
 							if (diffs++ >= 127) {
 								command_print(CMD, "More than 128 errors, the rest are not printed.");
 								free(data);
@@ -3900,6 +4246,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	if (diffs > 0)
 		command_print(CMD, "No more differences found.");
 done:
+	free(mem_checks);
 	if (diffs > 0)
 		retval = ERROR_FAIL;
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
@@ -3913,6 +4260,64 @@ done:
 	return retval;
 }
 
+COMMAND_HANDLER(handle_checksum_blocks_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	target_addr_t address;
+	uint32_t length;
+	uint32_t block_size;
+
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], length);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], block_size);
+
+	if (length == 0 || block_size == 0) {
+		command_print(CMD, "length and block size must not be zero");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	unsigned int num_blocks = DIV_ROUND_UP(length, block_size);
+	struct target_memory_check_block *blocks = calloc(num_blocks, sizeof(*blocks));
+	if (blocks == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < num_blocks; i++) {
+		blocks[i].address = address + (target_addr_t)i * block_size;
+		blocks[i].size = MIN(block_size, length - i * block_size);
+	}
+
+	struct duration bench;
+	duration_start(&bench);
+
+	int retval = ERROR_OK;
+	for (unsigned int i = 0; i < num_blocks; ) {
+		retval = target_checksum_memory_blocks(target, &blocks[i], num_blocks - i);
+		if (retval < 0)
+			break;
+		i += retval;
+		keep_alive();
+	}
+
+	if (retval >= 0) {
+		retval = ERROR_OK;
+		for (unsigned int i = 0; i < num_blocks; i++)
+			command_print(CMD, TARGET_ADDR_FMT " 0x%08" PRIx32,
+					blocks[i].address, blocks[i].result);
+
+		if (duration_measure(&bench) == ERROR_OK)
+			LOG_INFO("checksummed %u blocks in %fs (%0.3f KiB/s)", num_blocks,
+					duration_elapsed(&bench), duration_kbps(&bench, length));
+	}
+
+	free(blocks);
+	return retval;
+}
+
 COMMAND_HANDLER(handle_verify_image_checksum_command)
 {
 	return CALL_COMMAND_HANDLER(handle_verify_image_command_internal, IMAGE_CHECKSUM_ONLY);
@@ -6519,6 +6924,13 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "poll target state; or reconfigure background polling",
 		.usage = "['on'|'off']",
 	},
+	{
+		.name = "poll_stats",
+		.handler = handle_poll_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show or reset background polling statistics",
+		.usage = "['reset']",
+	},
 	{
 		.name = "wait_halt",
 		.handler = handle_wait_halt_command,
@@ -6652,7 +7064,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "load_image",
 		.handler = handle_load_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "filename address ['bin'|'ihex'|'elf'|'s19'] "
+		.usage = "['-parse-only'] filename address ['bin'|'ihex'|'elf'|'s19'] "
 			"[min_address] [max_length]",
 	},
 	{
@@ -6661,6 +7073,13 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.mode = COMMAND_EXEC,
 		.usage = "filename address size",
 	},
+	{
+		.name = "checksum_blocks",
+		.handler = handle_checksum_blocks_command,
+		.mode = COMMAND_EXEC,
+		.help = "print the CRC of each block_size sized block of a memory region",
+		.usage = "address length block_size",
+	},
 	{
 		.name = "verify_image_checksum",
 		.handler = handle_verify_image_checksum_command,
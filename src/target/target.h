@@ -344,6 +344,13 @@ struct target_memory_check_block {
 	uint32_t result;
 };
 
+/** One region of a gathered read, see target_read_buffers() */
+struct target_memory_read {
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;
+};
+
 int target_register_commands(struct command_context *cmd_ctx);
 int target_examine(void);
 
@@ -401,6 +408,7 @@ int target_call_trace_callbacks(struct target *target, size_t len, uint8_t *data
 int target_register_timer_callback(int (*callback)(void *priv),
 		unsigned int time_ms, enum target_timer_type type, void *priv);
 int target_unregister_timer_callback(int (*callback)(void *priv), void *priv);
+int64_t target_timer_next_event(void);
 int target_call_timer_callbacks(void);
 /**
  * Invoke this to ensure that e.g. polling timer callbacks happen before
@@ -623,6 +631,15 @@ int target_write_memory(struct target *target,
 int target_write_phys_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t count, const uint8_t *buffer);
 
+/**
+ * Translate the virtual address @a virtual of @a target to a physical
+ * one. Targets without an MMU map addresses one to one.
+ *
+ * This routine is a wrapper for target->type->virt2phys.
+ */
+int target_virt2phys(struct target *target, target_addr_t virtual,
+		target_addr_t *physical);
+
 /*
  * Write to target memory using the virtual address.
  *
@@ -651,8 +668,26 @@ int target_write_buffer(struct target *target,
 		target_addr_t address, uint32_t size, const uint8_t *buffer);
 int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
+/**
+ * Read several unrelated memory regions, e.g. the kernel structures walked
+ * by the RTOS support. Targets that can queue memory reads do it in a
+ * single round trip to the adapter, others fall back to one
+ * target_read_buffer() per region. Meant for RAM, as the regions may be
+ * read with 32 bit accesses covering them.
+ */
+int target_read_buffers(struct target *target,
+		struct target_memory_read *reads, unsigned int num_reads);
 int target_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t *crc);
+/**
+ * Calculate the CRC of each of @a num_blocks memory regions into the
+ * blocks' result fields. Falls back to target_checksum_memory() of the
+ * first block when the target can't do several blocks at once.
+ *
+ * @returns the number of leading blocks done (at least one) or an error code
+ */
+int target_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks);
 int target_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks,
 		uint8_t erased_value);
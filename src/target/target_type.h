@@ -43,6 +43,10 @@ struct target_type {
 
 	/* poll current target status */
 	int (*poll)(struct target *target);
+	/* Optional. Queue, without running, the status read poll() starts
+	 * with. handle_target() calls this for all targets before polling any,
+	 * so targets sharing a DAP get their status in one transaction. */
+	int (*queue_poll)(struct target *target);
 	/* Invoked only from target_arch_state().
 	 * Issue USER() w/architecture specific status.  */
 	int (*arch_state)(struct target *target);
@@ -143,8 +147,36 @@ struct target_type {
 	int (*write_buffer)(struct target *target, target_addr_t address,
 			uint32_t size, const uint8_t *buffer);
 
+	/**
+	 * Optional. Write @a size bytes of @a buffer at @a address, store @a wp
+	 * at @a wp_addr and read the word at @a rp_addr into @a rp, flushing all
+	 * three in a single adapter transaction. The data and @a wp are skipped
+	 * when @a size is zero. Used by target_run_flash_async_algorithm() to
+	 * feed the on-target FIFO without a round trip per operation.
+	 */
+	int (*write_async_fifo)(struct target *target, target_addr_t address,
+			uint32_t size, const uint8_t *buffer,
+			target_addr_t wp_addr, uint32_t wp,
+			target_addr_t rp_addr, uint32_t *rp);
+
+	/**
+	 * Optional. Read all @a num_reads memory regions with a single adapter
+	 * transaction. Regions may be read with 32 bit accesses covering them.
+	 * Do @b not call this function directly, use target_read_buffers().
+	 */
+	int (*read_buffers)(struct target *target,
+			struct target_memory_read *reads, unsigned int num_reads);
+
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
+	/**
+	 * Optional. Calculate the CRC of each of @a num_blocks memory regions,
+	 * storing it in the block's result field, with a single algorithm run.
+	 * Returns the number of leading blocks done, which may be less than
+	 * @a num_blocks, or an error code.
+	 */
+	int (*checksum_memory_blocks)(struct target *target,
+			struct target_memory_check_block *blocks, int num_blocks);
 	int (*blank_check_memory)(struct target *target,
 			struct target_memory_check_block *blocks, int num_blocks,
 			uint8_t erased_value);
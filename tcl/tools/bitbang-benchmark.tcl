@@ -0,0 +1,40 @@
+# Measure the JTAG throughput of a bitbang adapter, in bits per second,
+# with and without the vector callbacks of its driver (bcm2835gpio and
+# linuxgpiod have them). Usage:
+#
+# openocd -f interface/<adapter>.cfg -f <target>.cfg -f tools/bitbang-benchmark.tcl \
+#	-c "init; bitbang_benchmark <tap>; shutdown"
+#
+# The TAP is put into BYPASS, the target is left alone otherwise.
+
+proc bitbang_benchmark_run { tap words loops } {
+	set fields {}
+	for {set i 0} {$i < $words} {incr i} {
+		lappend fields 32 0x55aa55aa
+	}
+
+	set start [ms]
+	for {set i 0} {$i < $loops} {incr i} {
+		drscan $tap {*}$fields
+		runtest [expr {$words * 32}]
+	}
+	set elapsed [expr {[ms] - $start}]
+	if {$elapsed == 0} {
+		set elapsed 1
+	}
+
+	# both the scans and the idle cycles clock words * 32 bits per loop
+	return [expr {$loops * $words * 64 * 1000 / $elapsed}]
+}
+
+proc bitbang_benchmark { tap {words 32} {loops 100} } {
+	irscan $tap 0xffffffffffffffff
+
+	set saved [lindex [bitbang_vector] end]
+	foreach mode {enable disable} {
+		bitbang_vector $mode
+		set rate [bitbang_benchmark_run $tap $words $loops]
+		echo [format "vector callbacks %sd: %d bits/s" $mode $rate]
+	}
+	bitbang_vector [string trimright $saved d]
+}